@@ -0,0 +1,35 @@
+% Small-call throughput versus pipeline depth.
+%
+% Submits `depth` calls back-to-back with callasync and then fetches all of them. Depth 1 corresponds to a regular
+% synchronous call. Run from the repository root after building the MEX (matfrostmake).
+%
+%   >> run benchmark/pipelining_benchmark.m
+
+addpath(fullfile(fileparts(mfilename("fullpath")), "..", "src", "matlab"));
+
+jl = matfrostjulia(project=fullfile(fileparts(mfilename("fullpath")), "..", "test", "MATFrostTest"));
+
+depths = [1 2 4 8 16 32 64];
+ncalls = 2000;
+
+% Warm up: compilation of the called function and the conversions.
+jl.fetch(jl.callasync("MATFrost.Example.multiply_f64", 2.0, 3.0));
+
+rate = zeros(size(depths));
+for d = 1:numel(depths)
+    depth = depths(d);
+    requests = zeros(1, depth, "uint64");
+    t = tic;
+    for batch = 1:ceil(ncalls/depth)
+        for k = 1:depth
+            requests(k) = jl.callasync("MATFrost.Example.multiply_f64", 2.0, double(k));
+        end
+        for k = 1:depth
+            jl.fetch(requests(k));
+        end
+    end
+    rate(d) = ceil(ncalls/depth)*depth / toc(t);
+    fprintf("depth %3d: %10.0f calls/s\n", depth, rate(d));
+end
+
+clear jl
@@ -0,0 +1,593 @@
+/**
+ * Lightweight stand-in for the subset of the MATLAB Data API (matlab::data) used by the MATFrost MEX sources.
+ *
+ * Only intended to build the serialization and transport layer outside of MATLAB, e.g. for benchmarks.
+ * Arrays are column-major and share their storage on copy, like the MATLAB Data API.
+ */
+#ifndef MATFROST_MATLABSTUB_MATLABDATAARRAY_HPP
+#define MATFROST_MATLABSTUB_MATLABDATAARRAY_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <complex>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+namespace matlab::engine {
+
+    class MATLABException : public std::exception {
+        std::string id;
+        std::string message;
+    public:
+        MATLABException() = default;
+
+        explicit MATLABException(const std::string &message) : message(message) {}
+
+        MATLABException(const std::string &id, const std::u16string &message) : id(id), message(message.begin(), message.end()) {
+            // Narrowing conversion is sufficient for diagnostics.
+            for (size_t i = 0; i < message.size(); i++) {
+                this->message[i] = static_cast<char>(message[i]);
+            }
+        }
+
+        const char* what() const noexcept override {
+            return message.c_str();
+        }
+
+        const std::string& getMessageID() const {
+            return id;
+        }
+    };
+
+    inline std::u16string convertUTF8StringToUTF16String(const std::string &str) {
+        std::u16string out;
+        out.reserve(str.size());
+        size_t i = 0;
+        while (i < str.size()) {
+            uint32_t c = static_cast<uint8_t>(str[i]);
+            size_t n = 0;
+            if (c < 0x80) { n = 0; }
+            else if ((c >> 5) == 0x6) { c &= 0x1F; n = 1; }
+            else if ((c >> 4) == 0xE) { c &= 0x0F; n = 2; }
+            else { c &= 0x07; n = 3; }
+            for (size_t k = 0; k < n && i + 1 + k < str.size(); k++) {
+                c = (c << 6) | (static_cast<uint8_t>(str[i + 1 + k]) & 0x3F);
+            }
+            i += n + 1;
+            if (c >= 0x10000) {
+                c -= 0x10000;
+                out.push_back(static_cast<char16_t>(0xD800 + (c >> 10)));
+                out.push_back(static_cast<char16_t>(0xDC00 + (c & 0x3FF)));
+            } else {
+                out.push_back(static_cast<char16_t>(c));
+            }
+        }
+        return out;
+    }
+
+    inline std::string convertUTF16StringToUTF8String(const std::u16string &str) {
+        std::string out;
+        out.reserve(str.size());
+        for (size_t i = 0; i < str.size(); i++) {
+            uint32_t c = str[i];
+            if (c >= 0xD800 && c < 0xDC00 && i + 1 < str.size()) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (str[++i] - 0xDC00);
+            }
+            if (c < 0x80) {
+                out.push_back(static_cast<char>(c));
+            } else if (c < 0x800) {
+                out.push_back(static_cast<char>(0xC0 | (c >> 6)));
+                out.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+            } else if (c < 0x10000) {
+                out.push_back(static_cast<char>(0xE0 | (c >> 12)));
+                out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+            } else {
+                out.push_back(static_cast<char>(0xF0 | (c >> 18)));
+                out.push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+            }
+        }
+        return out;
+    }
+}
+
+namespace matlab::data {
+
+    enum class ArrayType {
+        LOGICAL = 0,
+        CHAR,
+        MATLAB_STRING,
+        DOUBLE,
+        SINGLE,
+        INT8,
+        UINT8,
+        INT16,
+        UINT16,
+        INT32,
+        UINT32,
+        INT64,
+        UINT64,
+        COMPLEX_DOUBLE,
+        COMPLEX_SINGLE,
+        COMPLEX_INT8,
+        COMPLEX_UINT8,
+        COMPLEX_INT16,
+        COMPLEX_UINT16,
+        COMPLEX_INT32,
+        COMPLEX_UINT32,
+        COMPLEX_INT64,
+        COMPLEX_UINT64,
+        CELL,
+        STRUCT,
+        OBJECT,
+        VALUE_OBJECT,
+        HANDLE_OBJECT_REF,
+        ENUM,
+        SPARSE_LOGICAL,
+        SPARSE_DOUBLE,
+        SPARSE_COMPLEX_DOUBLE,
+        UNKNOWN
+    };
+
+    using ArrayDimensions = std::vector<size_t>;
+
+    class InvalidArrayTypeException : public std::runtime_error {
+    public:
+        InvalidArrayTypeException() : std::runtime_error("Invalid array type") {}
+    };
+
+    /**
+     * Optional UTF-16 string.
+     */
+    class MATLABString {
+        std::u16string value;
+        bool missing = false;
+    public:
+        MATLABString() = default;
+        MATLABString(const std::u16string &value) : value(value) {}
+        MATLABString(const char16_t *value) : value(value) {}
+
+        operator std::u16string() const {
+            return value;
+        }
+
+        operator std::string() const {
+            return matlab::engine::convertUTF16StringToUTF8String(value);
+        }
+
+        bool has_value() const {
+            return !missing;
+        }
+
+        const std::u16string& operator*() const {
+            return value;
+        }
+
+        bool operator==(const std::u16string &rhs) const {
+            return value == rhs;
+        }
+    };
+
+    class MATLABFieldIdentifier {
+        std::string name;
+    public:
+        MATLABFieldIdentifier(const std::string &name) : name(name) {}
+
+        operator std::string() const {
+            return name;
+        }
+    };
+
+    template<typename T> struct type_of;
+    template<> struct type_of<bool> { static constexpr ArrayType value = ArrayType::LOGICAL; };
+    template<> struct type_of<double> { static constexpr ArrayType value = ArrayType::DOUBLE; };
+    template<> struct type_of<float> { static constexpr ArrayType value = ArrayType::SINGLE; };
+    template<> struct type_of<int8_t> { static constexpr ArrayType value = ArrayType::INT8; };
+    template<> struct type_of<uint8_t> { static constexpr ArrayType value = ArrayType::UINT8; };
+    template<> struct type_of<int16_t> { static constexpr ArrayType value = ArrayType::INT16; };
+    template<> struct type_of<uint16_t> { static constexpr ArrayType value = ArrayType::UINT16; };
+    template<> struct type_of<int32_t> { static constexpr ArrayType value = ArrayType::INT32; };
+    template<> struct type_of<uint32_t> { static constexpr ArrayType value = ArrayType::UINT32; };
+    template<> struct type_of<int64_t> { static constexpr ArrayType value = ArrayType::INT64; };
+    template<> struct type_of<uint64_t> { static constexpr ArrayType value = ArrayType::UINT64; };
+    template<> struct type_of<std::complex<double>> { static constexpr ArrayType value = ArrayType::COMPLEX_DOUBLE; };
+    template<> struct type_of<std::complex<float>> { static constexpr ArrayType value = ArrayType::COMPLEX_SINGLE; };
+    template<> struct type_of<std::complex<int8_t>> { static constexpr ArrayType value = ArrayType::COMPLEX_INT8; };
+    template<> struct type_of<std::complex<uint8_t>> { static constexpr ArrayType value = ArrayType::COMPLEX_UINT8; };
+    template<> struct type_of<std::complex<int16_t>> { static constexpr ArrayType value = ArrayType::COMPLEX_INT16; };
+    template<> struct type_of<std::complex<uint16_t>> { static constexpr ArrayType value = ArrayType::COMPLEX_UINT16; };
+    template<> struct type_of<std::complex<int32_t>> { static constexpr ArrayType value = ArrayType::COMPLEX_INT32; };
+    template<> struct type_of<std::complex<uint32_t>> { static constexpr ArrayType value = ArrayType::COMPLEX_UINT32; };
+    template<> struct type_of<std::complex<int64_t>> { static constexpr ArrayType value = ArrayType::COMPLEX_INT64; };
+    template<> struct type_of<std::complex<uint64_t>> { static constexpr ArrayType value = ArrayType::COMPLEX_UINT64; };
+    template<> struct type_of<MATLABString> { static constexpr ArrayType value = ArrayType::MATLAB_STRING; };
+
+    class Array;
+    template<> struct type_of<Array> { static constexpr ArrayType value = ArrayType::CELL; };
+
+    template<typename T>
+    using buffer_ptr_t = std::unique_ptr<T[], void(*)(void*)>;
+
+    namespace detail {
+        struct Storage {
+            ArrayType type = ArrayType::DOUBLE;
+            ArrayDimensions dims{0, 0};
+            size_t nel = 0;
+            std::shared_ptr<void> data;                // T[nel] for numeric, string, cell; Array[nel*nfields] for struct; T[nnz] for sparse.
+            std::vector<std::string> fieldnames;        // Struct only.
+            size_t nnz = 0;                             // Sparse only: nonzeros in column-major order at (rows, cols).
+            std::shared_ptr<void> rows;
+            std::shared_ptr<void> cols;
+        };
+
+        inline size_t numel(const ArrayDimensions &dims) {
+            size_t n = 1;
+            for (auto d : dims) {
+                n *= d;
+            }
+            return n;
+        }
+
+        template<typename T>
+        std::shared_ptr<void> allocate(size_t n) {
+            return std::shared_ptr<void>(new T[n](), [](void* p) { delete[] static_cast<T*>(p); });
+        }
+    }
+
+    /**
+     * Proxy returned when iterating over arrays; assignment writes through into the array.
+     */
+    template<typename T>
+    class Reference {
+        T* p;
+    public:
+        explicit Reference(T* p) : p(p) {}
+
+        template<typename U>
+        Reference& operator=(U&& v) {
+            *p = T(std::forward<U>(v));
+            return *this;
+        }
+
+        Reference& operator=(const Reference &rhs) {
+            *p = *rhs.p;
+            return *this;
+        }
+
+        operator T() const {
+            return *p;
+        }
+
+        template<typename U, typename = std::enable_if_t<!std::is_same<U, T>::value && std::is_constructible<U, T>::value>>
+        operator U() const {
+            return U(*p);
+        }
+    };
+
+    template<typename T>
+    class TypedIterator {
+        T* p;
+    public:
+        using value_type = std::remove_const_t<T>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T*;
+        using reference = T&;
+        using iterator_category = std::random_access_iterator_tag;
+
+        explicit TypedIterator(T* p) : p(p) {}
+
+        template<typename U, typename = std::enable_if_t<std::is_same<const U, T>::value>>
+        TypedIterator(const TypedIterator<U> &rhs) : p(rhs.operator->()) {}
+
+        T* operator->() const { return p; }
+        T& operator*() const { return *p; }
+        TypedIterator& operator++() { ++p; return *this; }
+        TypedIterator operator+(std::ptrdiff_t n) const { return TypedIterator(p + n); }
+        std::ptrdiff_t operator-(const TypedIterator &rhs) const { return p - rhs.p; }
+        bool operator==(const TypedIterator &rhs) const { return p == rhs.p; }
+        bool operator!=(const TypedIterator &rhs) const { return p != rhs.p; }
+    };
+
+    /**
+     * Iterator over mutable arrays yielding write-through proxies.
+     */
+    template<typename T>
+    class ReferenceIterator {
+        T* p;
+    public:
+        explicit ReferenceIterator(T* p) : p(p) {}
+        Reference<T> operator*() const { return Reference<T>(p); }
+        T* operator->() const { return p; }
+        ReferenceIterator& operator++() { ++p; return *this; }
+        bool operator!=(const ReferenceIterator &rhs) const { return p != rhs.p; }
+        bool operator==(const ReferenceIterator &rhs) const { return p == rhs.p; }
+        operator TypedIterator<T>() const { return TypedIterator<T>(p); }
+        operator TypedIterator<const T>() const { return TypedIterator<const T>(p); }
+    };
+
+    class Array {
+    protected:
+        std::shared_ptr<detail::Storage> storage;
+
+        static const std::shared_ptr<detail::Storage>& empty() {
+            static const std::shared_ptr<detail::Storage> storage = std::make_shared<detail::Storage>();
+            return storage;
+        }
+
+    public:
+        // Empty 0x0 double. Shares a single storage: cell and struct arrays are allocated with default elements.
+        Array() : storage(empty()) {}
+
+        explicit Array(std::shared_ptr<detail::Storage> storage) : storage(std::move(storage)) {}
+
+        ArrayType getType() const {
+            return storage->type;
+        }
+
+        ArrayDimensions getDimensions() const {
+            return storage->dims;
+        }
+
+        size_t getNumberOfElements() const {
+            return storage->nel;
+        }
+
+        bool isEmpty() const {
+            return storage->nel == 0;
+        }
+
+        const std::shared_ptr<detail::Storage>& get_storage() const {
+            return storage;
+        }
+    };
+
+    template<typename T>
+    class TypedArray : public Array {
+    protected:
+        T* data() const {
+            return static_cast<T*>(storage->data.get());
+        }
+
+    public:
+        TypedArray(const Array &arr) : Array(arr) {
+            if (arr.getType() != type_of<T>::value) {
+                throw InvalidArrayTypeException();
+            }
+        }
+
+        TypedIterator<const T> begin() const { return TypedIterator<const T>(data()); }
+        TypedIterator<const T> end() const { return TypedIterator<const T>(data() + storage->nel); }
+
+        ReferenceIterator<T> begin() { return ReferenceIterator<T>(data()); }
+        ReferenceIterator<T> end() { return ReferenceIterator<T>(data() + storage->nel); }
+
+        const T& operator[](size_t i) const { return data()[i]; }
+        Reference<T> operator[](size_t i) { return Reference<T>(data() + i); }
+
+        buffer_ptr_t<T> release() {
+            throw std::runtime_error("Not supported by stand-in");
+        }
+    };
+
+    template<typename T> struct sparse_type_of;
+    template<> struct sparse_type_of<bool> { static constexpr ArrayType value = ArrayType::SPARSE_LOGICAL; };
+    template<> struct sparse_type_of<double> { static constexpr ArrayType value = ArrayType::SPARSE_DOUBLE; };
+    template<> struct sparse_type_of<std::complex<double>> { static constexpr ArrayType value = ArrayType::SPARSE_COMPLEX_DOUBLE; };
+
+    using SparseIndex = std::pair<size_t, size_t>;
+
+    /**
+     * Sparse matrix, iterating over its nonzeros in column-major order.
+     */
+    template<typename T>
+    class SparseArray : public Array {
+        const T* data() const {
+            return static_cast<const T*>(storage->data.get());
+        }
+
+    public:
+        SparseArray(const Array &arr) : Array(arr) {
+            if (arr.getType() != sparse_type_of<T>::value) {
+                throw InvalidArrayTypeException();
+            }
+        }
+
+        size_t getNumberOfNonZeroElements() const {
+            return storage->nnz;
+        }
+
+        TypedIterator<const T> begin() const { return TypedIterator<const T>(data()); }
+        TypedIterator<const T> end() const { return TypedIterator<const T>(data() + storage->nnz); }
+
+        SparseIndex getIndex(const TypedIterator<const T> &it) const {
+            const size_t i = static_cast<size_t>(it - begin());
+            return SparseIndex(static_cast<const size_t*>(storage->rows.get())[i], static_cast<const size_t*>(storage->cols.get())[i]);
+        }
+    };
+
+    using CellArray = TypedArray<Array>;
+    using StringArray = TypedArray<MATLABString>;
+
+    /**
+     * Element of a struct array.
+     */
+    class Struct {
+        std::shared_ptr<detail::Storage> storage;
+        size_t index;
+
+        Array* fields() const {
+            return static_cast<Array*>(storage->data.get()) + index * storage->fieldnames.size();
+        }
+
+        size_t field_index(const std::string &name) const {
+            auto it = std::find(storage->fieldnames.begin(), storage->fieldnames.end(), name);
+            if (it == storage->fieldnames.end()) {
+                throw matlab::engine::MATLABException("Invalid field name: " + name);
+            }
+            return static_cast<size_t>(it - storage->fieldnames.begin());
+        }
+
+    public:
+        Struct(std::shared_ptr<detail::Storage> storage, size_t index) : storage(std::move(storage)), index(index) {}
+
+        const Array operator[](const std::string &name) const {
+            return fields()[field_index(name)];
+        }
+
+        Reference<Array> operator[](const std::string &name) {
+            return Reference<Array>(fields() + field_index(name));
+        }
+
+        TypedIterator<const Array> begin() const { return TypedIterator<const Array>(fields()); }
+        TypedIterator<const Array> end() const { return TypedIterator<const Array>(fields() + storage->fieldnames.size()); }
+    };
+
+    class StructIterator {
+        std::shared_ptr<detail::Storage> storage;
+        size_t index;
+    public:
+        StructIterator(std::shared_ptr<detail::Storage> storage, size_t index) : storage(std::move(storage)), index(index) {}
+        Struct operator*() const { return Struct(storage, index); }
+        StructIterator& operator++() { ++index; return *this; }
+        bool operator!=(const StructIterator &rhs) const { return index != rhs.index; }
+        bool operator==(const StructIterator &rhs) const { return index == rhs.index; }
+    };
+
+    class StructArray : public Array {
+    public:
+        StructArray(const Array &arr) : Array(arr) {
+            if (arr.getType() != ArrayType::STRUCT) {
+                throw InvalidArrayTypeException();
+            }
+        }
+
+        size_t getNumberOfFields() const {
+            return storage->fieldnames.size();
+        }
+
+        std::vector<MATLABFieldIdentifier> getFieldNames() const {
+            return std::vector<MATLABFieldIdentifier>(storage->fieldnames.begin(), storage->fieldnames.end());
+        }
+
+        Struct operator[](size_t i) const {
+            return Struct(storage, i);
+        }
+
+        StructIterator begin() const { return StructIterator(storage, 0); }
+        StructIterator end() const { return StructIterator(storage, storage->nel); }
+    };
+
+    class ArrayFactory {
+        template<typename T>
+        static std::shared_ptr<detail::Storage> make_storage(ArrayType type, const ArrayDimensions &dims) {
+            auto s = std::make_shared<detail::Storage>();
+            s->type = type;
+            s->dims = dims;
+            s->nel = detail::numel(dims);
+            s->data = detail::allocate<T>(s->nel);
+            return s;
+        }
+
+    public:
+        template<typename T>
+        TypedArray<T> createArray(const ArrayDimensions &dims) {
+            return TypedArray<T>(Array(make_storage<T>(type_of<T>::value, dims)));
+        }
+
+        template<typename T, typename It>
+        TypedArray<T> createArray(const ArrayDimensions &dims, It begin, It end) {
+            auto s = make_storage<T>(type_of<T>::value, dims);
+            T* p = static_cast<T*>(s->data.get());
+            for (size_t i = 0; begin != end && i < s->nel; ++begin, ++i) {
+                p[i] = T(*begin);
+            }
+            return TypedArray<T>(Array(s));
+        }
+
+        template<typename T>
+        TypedArray<T> createArray(const ArrayDimensions &dims, std::initializer_list<T> values) {
+            return createArray<T>(dims, values.begin(), values.end());
+        }
+
+        template<typename T>
+        TypedArray<T> createScalar(const T &v) {
+            auto arr = createArray<T>({1, 1});
+            arr[0] = v;
+            return arr;
+        }
+
+        StringArray createScalar(const std::u16string &v) {
+            auto arr = createArray<MATLABString>({1, 1});
+            arr[0] = MATLABString(v);
+            return arr;
+        }
+
+        StringArray createScalar(const std::string &v) {
+            return createScalar(matlab::engine::convertUTF8StringToUTF16String(v));
+        }
+
+        StringArray createScalar(const char *v) {
+            return createScalar(std::string(v));
+        }
+
+        CellArray createCellArray(const ArrayDimensions &dims) {
+            return CellArray(Array(make_storage<Array>(ArrayType::CELL, dims)));
+        }
+
+        StructArray createStructArray(const ArrayDimensions &dims, const std::vector<std::string> &fieldnames) {
+            auto s = std::make_shared<detail::Storage>();
+            s->type = ArrayType::STRUCT;
+            s->dims = dims;
+            s->nel = detail::numel(dims);
+            s->fieldnames = fieldnames;
+            s->data = detail::allocate<Array>(s->nel * fieldnames.size());
+            return StructArray(Array(s));
+        }
+
+        template<typename T>
+        buffer_ptr_t<T> createBuffer(size_t n) {
+            return buffer_ptr_t<T>(new T[n](), [](void* p) { delete[] static_cast<T*>(p); });
+        }
+
+        template<typename T>
+        TypedArray<T> createArrayFromBuffer(const ArrayDimensions &dims, buffer_ptr_t<T> buffer) {
+            auto s = std::make_shared<detail::Storage>();
+            s->type = type_of<T>::value;
+            s->dims = dims;
+            s->nel = detail::numel(dims);
+            auto deleter = buffer.get_deleter();
+            s->data = std::shared_ptr<void>(buffer.release(), deleter);
+            return TypedArray<T>(Array(s));
+        }
+
+        /**
+         * Sparse matrix of nnz nonzeros data at (rows, cols), zero-based, in column-major order.
+         */
+        template<typename T>
+        SparseArray<T> createSparseArray(const ArrayDimensions &dims, const size_t nnz, buffer_ptr_t<T> data, buffer_ptr_t<size_t> rows, buffer_ptr_t<size_t> cols) {
+            auto s = std::make_shared<detail::Storage>();
+            s->type = sparse_type_of<T>::value;
+            s->dims = dims;
+            s->nel = detail::numel(dims);
+            s->nnz = nnz;
+            auto data_deleter = data.get_deleter();
+            s->data = std::shared_ptr<void>(data.release(), data_deleter);
+            auto rows_deleter = rows.get_deleter();
+            s->rows = std::shared_ptr<void>(rows.release(), rows_deleter);
+            auto cols_deleter = cols.get_deleter();
+            s->cols = std::shared_ptr<void>(cols.release(), cols_deleter);
+            return SparseArray<T>(Array(s));
+        }
+    };
+
+}
+
+#endif //MATFROST_MATLABSTUB_MATLABDATAARRAY_HPP
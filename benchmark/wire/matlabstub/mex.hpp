@@ -0,0 +1,60 @@
+/**
+ * Lightweight stand-in for the MATLAB C++ MEX API (matlab::mex, matlab::engine) used by the MATFrost MEX sources.
+ */
+#ifndef MATFROST_MATLABSTUB_MEX_HPP
+#define MATFROST_MATLABSTUB_MEX_HPP
+
+#include "MatlabDataArray.hpp"
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace matlab::engine {
+
+    /**
+     * Engine handle. `disp` prints to stdout, every other function is a no-operation.
+     */
+    class MATLABEngine {
+    public:
+        std::vector<matlab::data::Array> feval(const std::u16string &function, const int nlhs, const std::vector<matlab::data::Array> &args) {
+            if (function == u"disp" && !args.empty() && args[0].getType() == matlab::data::ArrayType::MATLAB_STRING) {
+                const matlab::data::StringArray str(args[0]);
+                std::cout << static_cast<std::string>(str[0]) << std::endl;
+            }
+            return std::vector<matlab::data::Array>(static_cast<size_t>(nlhs));
+        }
+    };
+
+}
+
+namespace matlab::mex {
+
+    class ArgumentList {
+        std::vector<matlab::data::Array>* args;
+    public:
+        explicit ArgumentList(std::vector<matlab::data::Array>* args) : args(args) {}
+
+        matlab::data::Array& operator[](const size_t i) {
+            return (*args)[i];
+        }
+
+        size_t size() const {
+            return args->size();
+        }
+    };
+
+    class Function {
+        std::shared_ptr<matlab::engine::MATLABEngine> engine = std::make_shared<matlab::engine::MATLABEngine>();
+    public:
+        virtual ~Function() = default;
+
+        std::shared_ptr<matlab::engine::MATLABEngine> getEngine() {
+            return engine;
+        }
+    };
+
+}
+
+#endif //MATFROST_MATLABSTUB_MEX_HPP
@@ -0,0 +1,9 @@
+/**
+ * Stand-in for mexAdapter.hpp. The MEX entry point is not generated; harnesses drive MexFunction directly.
+ */
+#ifndef MATFROST_MATLABSTUB_MEXADAPTER_HPP
+#define MATFROST_MATLABSTUB_MEXADAPTER_HPP
+
+#include "mex.hpp"
+
+#endif //MATFROST_MATLABSTUB_MEXADAPTER_HPP
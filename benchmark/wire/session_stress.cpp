@@ -0,0 +1,250 @@
+/**
+ * Stress test of concurrent sessions: Sessions::Registry with a session per thread, as MATLAB backgroundPool workers
+ * driving their own matfrostjulia each. Built against the matlab::data stand-in in matlabstub/.
+ *
+ * Every session is connected to a loopback echo peer, a forked process returning every message byte for byte. For
+ * 1, 2, 4, ... sessions, as many threads look up their session in the registry, lock it and perform round trips. The
+ * aggregate throughput should scale with the number of sessions, up to the number of cores: each session needs a core
+ * for its thread and one for its peer. Finally all threads share a single session, which checks that the session lock
+ * keeps the messages of concurrent round trips apart.
+ *
+ *   session_stress [--sessions N] [--seconds S] [--min-efficiency E]
+ *
+ * Fails if a response does not match its request. The efficiency is reported only, unless min-efficiency is given:
+ * then it also fails if the throughput with up to cores/2 sessions is below min-efficiency times linear scaling. Check
+ * scaling on an otherwise idle machine, e.g. with --min-efficiency 0.5. POSIX only.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "mex.hpp"
+#include "mexAdapter.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "server.hpp"
+#include "socket.hpp"
+#include "write.hpp"
+#include "read.hpp"
+#include "requests.hpp"
+#include "functions.hpp"
+#include "pool.hpp"
+#include "streams.hpp"
+#include "sessions.hpp"
+
+
+namespace {
+
+    bool read_fully(const int fd, uint8_t *data, const size_t nb) {
+        size_t received = 0;
+        while (received < nb) {
+            const ssize_t n = ::read(fd, data + received, nb - received);
+            if (n <= 0) {
+                return false;
+            }
+            received += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * Loopback echo peer: returns every message unchanged, until the socket is closed.
+     */
+    void echo_peer(const int fd) {
+        std::vector<uint8_t> message;
+        while (true) {
+            uint64_t prefix[4];
+            if (!read_fully(fd, reinterpret_cast<uint8_t *>(prefix), sizeof(prefix))) {
+                return;
+            }
+            // [request_id][nbytes][offset][advance][array]
+            message.resize(sizeof(prefix) + prefix[1]);
+            std::memcpy(message.data(), prefix, sizeof(prefix));
+            if (!read_fully(fd, message.data() + sizeof(prefix), prefix[1])) {
+                return;
+            }
+            size_t written = 0;
+            while (written < message.size()) {
+                const ssize_t n = ::write(fd, message.data() + written, message.size() - written);
+                if (n <= 0) {
+                    return;
+                }
+                written += static_cast<size_t>(n);
+            }
+        }
+    }
+
+    matlab::data::Array call_arguments() {
+        matlab::data::ArrayFactory f;
+        matlab::data::CellArray call = f.createCellArray({2, 1});
+        call[0] = f.createScalar<int64_t>(1);
+        auto values = f.createArray<double>({1024, 1});
+        double v = 0.0;
+        for (auto e : values) {
+            e = v++;
+        }
+        call[1] = values;
+        return call;
+    }
+
+    /**
+     * Round trips on the session until stop. Returns the number of round trips, or -1 on a mismatched response.
+     */
+    int64_t drive(MATFrost::Sessions::Registry &registry, const uint64_t id, const std::atomic<bool> &stop) {
+        const matlab::data::Array call = call_arguments();
+        int64_t n = 0;
+        while (!stop) {
+            // As an action of the MEX: look up, lock, use.
+            auto session = registry.find(id);
+            std::lock_guard<std::mutex> lock(session->mutex);
+            const MATFrost::Pool::Worker &worker = session->worker();
+            const uint64_t request_id = worker.requests->issue();
+            MATFrost::Write::write_message(worker.socket, request_id, call);
+            auto msg = MATFrost::Read::read_message(worker.socket);
+            if (msg.request_id != request_id || msg.value.getNumberOfElements() != call.getNumberOfElements()) {
+                return -1;
+            }
+            worker.requests->complete(msg.request_id, msg.value);
+            worker.requests->take(msg.request_id);
+            n++;
+        }
+        return n;
+    }
+
+    /**
+     * Run a thread per session ID for the duration. Returns round trips per second, or -1 on a mismatch.
+     */
+    double run(MATFrost::Sessions::Registry &registry, const std::vector<uint64_t> &ids, const double seconds) {
+        std::atomic<bool> stop{false};
+        std::vector<int64_t> counts(ids.size(), 0);
+        std::vector<std::thread> threads{};
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t t = 0; t < ids.size(); t++) {
+            threads.emplace_back([&, t] { counts[t] = drive(registry, ids[t], stop); });
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        stop = true;
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        int64_t total = 0;
+        for (const int64_t c : counts) {
+            if (c < 0) {
+                return -1.0;
+            }
+            total += c;
+        }
+        return static_cast<double>(total) / elapsed;
+    }
+
+}
+
+int main(int argc, char **argv) {
+    size_t max_sessions = std::max<size_t>(2, std::thread::hardware_concurrency());
+    double seconds = 1.0;
+    double min_efficiency = 0.0;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--sessions" && i + 1 < argc) {
+            max_sessions = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--min-efficiency" && i + 1 < argc) {
+            min_efficiency = std::strtod(argv[++i], nullptr);
+        } else {
+            std::fprintf(stderr, "usage: %s [--sessions N] [--seconds S] [--min-efficiency E]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Fork all peers before any thread is started.
+    std::vector<int> fds{};
+    std::vector<pid_t> peers{};
+    for (size_t s = 0; s < max_sessions; s++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+            std::perror("socketpair");
+            return 1;
+        }
+        const pid_t peer = fork();
+        if (peer == 0) {
+            for (const int fd : fds) {
+                close(fd);
+            }
+            close(pair[0]);
+            echo_peer(pair[1]);
+            _exit(0);
+        }
+        close(pair[1]);
+        fds.push_back(pair[0]);
+        peers.push_back(peer);
+    }
+
+    int status = 0;
+    {
+        MATFrost::Sessions::Registry registry{};
+        std::vector<uint64_t> ids{};
+        for (size_t s = 0; s < max_sessions; s++) {
+            auto socket = std::make_shared<MATFrost::Socket::BufferedUnixDomainSocket>("session_stress", fds[s], timeval{10, 0}, 10000);
+            // Read decodes responses, which are never sent by plan: the echoed messages must be sent in full.
+            socket->plans.enabled = false;
+            MATFrost::Pool::Worker worker{nullptr, socket, std::make_shared<MATFrost::Requests::PendingRequests>(),
+                std::make_shared<MATFrost::Functions::FunctionTable>()};
+            const uint64_t id = 1000 + s;
+            registry.insert(id, std::make_shared<MATFrost::Sessions::Session>(
+                std::make_shared<MATFrost::Pool::WorkerPool>(std::vector<MATFrost::Pool::Worker>{worker})));
+            ids.push_back(id);
+        }
+
+        const size_t cores = std::max<unsigned>(1, std::thread::hardware_concurrency());
+        std::printf("%-10s %14s %12s\n", "sessions", "calls/s", "efficiency");
+        double single = 0.0;
+        for (size_t n = 1; n <= max_sessions; n *= 2) {
+            const double throughput = run(registry, std::vector<uint64_t>(ids.begin(), ids.begin() + n), seconds);
+            if (throughput < 0) {
+                std::fprintf(stderr, "%zu sessions: response does not match its request\n", n);
+                status = 1;
+                break;
+            }
+            if (n == 1) {
+                single = throughput;
+            }
+            const double efficiency = throughput / (single * static_cast<double>(n));
+            std::printf("%-10zu %14.0f %12.2f\n", n, throughput, efficiency);
+            if (min_efficiency > 0.0 && 2 * n <= cores && efficiency < min_efficiency) {
+                std::fprintf(stderr, "%zu sessions: throughput does not scale\n", n);
+                status = 1;
+            }
+        }
+
+        // All threads on one session: serialized by the session lock.
+        const double shared = run(registry, std::vector<uint64_t>(max_sessions, ids[0]), seconds);
+        if (shared < 0) {
+            std::fprintf(stderr, "shared session: response does not match its request\n");
+            status = 1;
+        } else {
+            std::printf("%-10s %14.0f\n", "shared", shared);
+        }
+    }
+    // Closing the sockets stops the peers.
+    for (const pid_t peer : peers) {
+        waitpid(peer, nullptr, 0);
+    }
+    return status;
+}
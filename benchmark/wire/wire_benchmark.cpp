@@ -0,0 +1,393 @@
+/**
+ * Benchmark of the serialization and transport layer of the MEX: Write::write_message, Read::read_message and
+ * BufferedUnixDomainSocket, built against the matlab::data stand-in in matlabstub/.
+ *
+ * Every round trip writes a message to a loopback echo peer, a forked process returning every message byte for byte,
+ * and reads the echoed message back into a MATLAB array. Julia is not involved: the numbers are an upper bound of
+ * the wire path, including MATLAB array construction on the read side.
+ *
+ *   wire_benchmark [--iterations N] [--filter name] [--json file] [--buffers N,N,...] [--kernel-buffer N] [--adaptive]
+ *                  [--bit-packing N]
+ *
+ * Prints a table to stdout; --json writes the results machine-readable, for tracking regressions across releases.
+ * --buffers runs every case once per input and output buffer size, to compare throughput across sizes. --kernel-buffer
+ * sets the kernel socket buffers of the MEX side and --adaptive lets the buffers grow, see Socket::BufferSizes.
+ * --bit-packing sets the number of elements from which logical arrays are bit-packed, 0 disables it (default 65536, as
+ * matfrostjulia).
+ * POSIX only, shared memory is not used.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "mex.hpp"
+#include "mexAdapter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <complex>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "server.hpp"
+#include "socket.hpp"
+#include "write.hpp"
+#include "read.hpp"
+
+
+namespace {
+
+    struct Case {
+        std::string name;
+        std::function<matlab::data::Array()> create;
+    };
+
+    struct Result {
+        std::string name;
+        size_t buffer;
+        size_t iterations;
+        uint64_t wire_bytes;
+        double mean_us;
+        double p50_us;
+        double p99_us;
+        double roundtrip_mbps;
+    };
+
+    bool read_fully(const int fd, uint8_t *data, const size_t nb) {
+        size_t received = 0;
+        while (received < nb) {
+            const ssize_t n = ::read(fd, data + received, nb - received);
+            if (n <= 0) {
+                return false;
+            }
+            received += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * Loopback echo peer: returns every message unchanged, until the socket is closed.
+     */
+    void echo_peer(const int fd) {
+        std::vector<uint8_t> message;
+        while (true) {
+            uint64_t prefix[4];
+            if (!read_fully(fd, reinterpret_cast<uint8_t *>(prefix), sizeof(prefix))) {
+                return;
+            }
+            // [request_id][nbytes][offset][advance][array]
+            message.resize(sizeof(prefix) + prefix[1]);
+            std::memcpy(message.data(), prefix, sizeof(prefix));
+            if (!read_fully(fd, message.data() + sizeof(prefix), prefix[1])) {
+                return;
+            }
+            size_t written = 0;
+            while (written < message.size()) {
+                const ssize_t n = ::write(fd, message.data() + written, message.size() - written);
+                if (n <= 0) {
+                    return;
+                }
+                written += static_cast<size_t>(n);
+            }
+        }
+    }
+
+    std::vector<Case> cases() {
+        std::vector<Case> cs{};
+
+        cs.push_back({"scalar_double", [] {
+            matlab::data::ArrayFactory f;
+            return f.createScalar<double>(3.0);
+        }});
+
+        cs.push_back({"dense_double_1000x1000", [] {
+            matlab::data::ArrayFactory f;
+            auto arr = f.createArray<double>({1000, 1000});
+            double v = 0.0;
+            for (auto e : arr) {
+                e = v++;
+            }
+            return arr;
+        }});
+
+        cs.push_back({"complex_double_256x256", [] {
+            matlab::data::ArrayFactory f;
+            auto arr = f.createArray<std::complex<double>>({256, 256});
+            double v = 0.0;
+            for (auto e : arr) {
+                e = std::complex<double>(v, -v);
+                v++;
+            }
+            return arr;
+        }});
+
+        cs.push_back({"cell_1x64_vectors_4096", [] {
+            matlab::data::ArrayFactory f;
+            auto arr = f.createCellArray({1, 64});
+            for (size_t i = 0; i < 64; i++) {
+                auto v = f.createArray<double>({4096, 1});
+                double x = static_cast<double>(i);
+                for (auto e : v) {
+                    e = x++;
+                }
+                arr[i] = v;
+            }
+            return arr;
+        }});
+
+        cs.push_back({"logical_4000x2000", [] {
+            matlab::data::ArrayFactory f;
+            auto arr = f.createArray<bool>({4000, 2000});
+            size_t i = 0;
+            for (auto e : arr) {
+                e = (i++ % 3) == 0;
+            }
+            return arr;
+        }});
+
+        cs.push_back({"string_1x10000", [] {
+            matlab::data::ArrayFactory f;
+            auto arr = f.createArray<matlab::data::MATLABString>({1, 10000});
+            size_t i = 0;
+            for (auto e : arr) {
+                e = matlab::engine::convertUTF8StringToUTF16String("item_" + std::to_string(i++));
+            }
+            return arr;
+        }});
+
+        cs.push_back({"string_1x10000_mixed", [] {
+            matlab::data::ArrayFactory f;
+            auto arr = f.createArray<matlab::data::MATLABString>({1, 10000});
+            size_t i = 0;
+            for (auto e : arr) {
+                e = matlab::engine::convertUTF8StringToUTF16String("Stra\xc3\x9f" "e_\xe6\x9d\xb1\xe4\xba\xac_" +
+                    std::to_string(i++) + "_\xf0\x9f\x98\x80");
+            }
+            return arr;
+        }});
+
+        cs.push_back({"deep_cell_depth64", [] {
+            matlab::data::ArrayFactory f;
+            matlab::data::Array inner = f.createScalar<double>(0.0);
+            for (int d = 1; d <= 64; d++) {
+                auto cell = f.createCellArray({2, 1});
+                cell[0] = f.createScalar<double>(d);
+                cell[1] = inner;
+                inner = cell;
+            }
+            return inner;
+        }});
+
+        cs.push_back({"cell_1x1000_vectors", [] {
+            matlab::data::ArrayFactory f;
+            auto cell = f.createCellArray({1, 1000});
+            size_t i = 0;
+            for (auto e : cell) {
+                e = f.createArray<double>({3, 1}, {double(i), 2.0*i, 3.0*i});
+                i++;
+            }
+            return cell;
+        }});
+
+        cs.push_back({"struct_1x1000_32_fields", [] {
+            matlab::data::ArrayFactory f;
+            std::vector<std::string> fns{};
+            for (int k = 0; k < 32; k++) {
+                fns.push_back("field" + std::to_string(k));
+            }
+            auto s = f.createStructArray({1, 1000}, fns);
+            for (size_t i = 0; i < 1000; i++) {
+                for (int k = 0; k < 32; k++) {
+                    s[i][fns[k]] = f.createScalar<double>(i + k);
+                }
+            }
+            return s;
+        }});
+
+        cs.push_back({"struct_1x1000_mixed", [] {
+            matlab::data::ArrayFactory f;
+            auto s = f.createStructArray({1, 1000}, {"name", "population", "area", "coordinates"});
+            for (size_t i = 0; i < 1000; i++) {
+                s[i]["name"] = f.createScalar("City" + std::to_string(i));
+                s[i]["population"] = f.createScalar<int64_t>(i);
+                s[i]["area"] = f.createScalar<double>(1.5*i);
+                s[i]["coordinates"] = f.createArray<double>({1, 2}, {double(i), -double(i)});
+            }
+            return s;
+        }});
+
+        cs.push_back({"sparse_double_100000x100000", [] {
+            // Tridiagonal: 3e5 nonzeros, 80 GB dense.
+            matlab::data::ArrayFactory f;
+            const size_t n = 100000;
+            const size_t nnz = 3*n - 2;
+            auto data = f.createBuffer<double>(nnz);
+            auto rows = f.createBuffer<size_t>(nnz);
+            auto cols = f.createBuffer<size_t>(nnz);
+            size_t k = 0;
+            for (size_t c = 0; c < n; c++) {
+                for (size_t r = (c > 0 ? c - 1 : 0); r <= std::min(c + 1, n - 1); r++) {
+                    data[k] = r == c ? 2.0 : -1.0;
+                    rows[k] = r;
+                    cols[k] = c;
+                    k++;
+                }
+            }
+            return f.createSparseArray<double>({n, n}, nnz, std::move(data), std::move(rows), std::move(cols));
+        }});
+
+        return cs;
+    }
+
+    double percentile(std::vector<double> sorted, const double p) {
+        const size_t k = std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())));
+        return sorted[k];
+    }
+
+    Result run(const std::shared_ptr<MATFrost::Socket::BufferedUnixDomainSocket> socket, const Case &c, const size_t iterations) {
+        const matlab::data::Array arr = c.create();
+
+        const MATFrost::Write::Layout layout = MATFrost::Write::measure(arr);
+        const uint64_t wire_bytes = MATFrost::Write::socket_nbytes(layout, MATFrost::Write::cache_modes(layout, socket->cache), false, 0, socket->bit_packing);
+
+        auto roundtrip = [&](const uint64_t request_id) {
+            MATFrost::Write::write_message(socket, request_id, arr);
+            socket->flush();
+            auto msg = MATFrost::Read::read_message(socket);
+            if (msg.request_id != request_id || msg.value.getType() != arr.getType() || msg.value.getNumberOfElements() != arr.getNumberOfElements()) {
+                std::fprintf(stderr, "%s: echoed message does not match\n", c.name.c_str());
+                std::exit(1);
+            }
+        };
+
+        // Warm up caches and the allocator.
+        for (size_t i = 0; i < std::max<size_t>(1, iterations / 10); i++) {
+            roundtrip(i);
+        }
+
+        std::vector<double> latencies_us(iterations);
+        for (size_t i = 0; i < iterations; i++) {
+            const auto start = std::chrono::steady_clock::now();
+            roundtrip(i);
+            latencies_us[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        double total_us = 0.0;
+        for (const double l : latencies_us) {
+            total_us += l;
+        }
+        const double mean_us = total_us / static_cast<double>(iterations);
+        std::sort(latencies_us.begin(), latencies_us.end());
+
+        return Result{c.name, socket->buffer_sizes().nbytes, iterations, wire_bytes, mean_us, percentile(latencies_us, 0.5), percentile(latencies_us, 0.99),
+            2.0 * static_cast<double>(wire_bytes) / mean_us};
+    }
+
+    void write_json(const std::string &path, const std::vector<Result> &results) {
+        std::ofstream out(path);
+        out << "{\n  \"benchmark\": \"wire\",\n  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result &r = results[i];
+            out << "    {\"name\": \"" << r.name << "\", \"buffer\": " << r.buffer << ", \"iterations\": " << r.iterations
+                << ", \"wire_bytes\": " << r.wire_bytes << ", \"mean_us\": " << r.mean_us
+                << ", \"p50_us\": " << r.p50_us << ", \"p99_us\": " << r.p99_us
+                << ", \"roundtrip_mbps\": " << r.roundtrip_mbps << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+}
+
+int main(int argc, char **argv) {
+    size_t iterations = 200;
+    std::string filter{};
+    std::string json{};
+    std::vector<size_t> buffers{};
+    MATFrost::Socket::BufferSizes sizes{};
+    uint64_t bit_packing = 65536;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            json = argv[++i];
+        } else if (arg == "--buffers" && i + 1 < argc) {
+            const std::string list = argv[++i];
+            for (size_t start = 0; start <= list.size(); ) {
+                const size_t comma = std::min(list.find(',', start), list.size());
+                buffers.push_back(std::strtoull(list.substr(start, comma - start).c_str(), nullptr, 10));
+                start = comma + 1;
+            }
+        } else if (arg == "--kernel-buffer" && i + 1 < argc) {
+            sizes.kernel_nbytes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--adaptive") {
+            sizes.adaptive = true;
+        } else if (arg == "--bit-packing" && i + 1 < argc) {
+            bit_packing = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::fprintf(stderr, "usage: %s [--iterations N] [--filter name] [--json file] [--buffers N,N,...] [--kernel-buffer N] [--adaptive] [--bit-packing N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        std::perror("socketpair");
+        return 1;
+    }
+
+    const pid_t peer = fork();
+    if (peer == 0) {
+        close(fds[0]);
+        echo_peer(fds[1]);
+        _exit(0);
+    }
+    close(fds[1]);
+
+    std::vector<Result> results{};
+    {
+        auto socket = std::make_shared<MATFrost::Socket::BufferedUnixDomainSocket>("wire_benchmark", fds[0], timeval{10, 0}, 10000);
+        // Read decodes responses, which are never sent by plan: the echoed messages must be sent in full.
+        socket->plans.enabled = false;
+        socket->bit_packing = bit_packing;
+
+        if (buffers.empty()) {
+            buffers.push_back(sizes.nbytes);
+        }
+
+        std::printf("%-28s %10s %12s %12s %12s %12s %12s\n", "case", "buffer", "wire bytes", "mean us", "p50 us", "p99 us", "MB/s");
+        for (const size_t buffer : buffers) {
+            for (const auto &c : cases()) {
+                if (!filter.empty() && c.name.find(filter) == std::string::npos) {
+                    continue;
+                }
+                // Every case starts from the configured sizes, also with adaptive sizes.
+                sizes.nbytes = buffer;
+                socket->configure_buffers(sizes);
+                const Result r = run(socket, c, iterations);
+                std::printf("%-28s %10zu %12llu %12.2f %12.2f %12.2f %12.1f\n", r.name.c_str(), r.buffer,
+                    static_cast<unsigned long long>(r.wire_bytes), r.mean_us, r.p50_us, r.p99_us, r.roundtrip_mbps);
+                results.push_back(r);
+            }
+        }
+    }
+    // Closing the socket stops the peer.
+    waitpid(peer, nullptr, 0);
+
+    if (!json.empty()) {
+        write_json(json, results);
+    }
+    return 0;
+}
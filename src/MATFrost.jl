@@ -14,6 +14,11 @@ function matfrostserve end
 include("types.jl")
 include("constants.jl")
 
+include("sharedmemory.jl")
+include("schemas.jl")
+include("cache.jl")
+include("plans.jl")
+include("bits.jl")
 include("stream.jl")
 
 include("read.jl")
@@ -23,6 +28,9 @@ include("write.jl")
 
 include("server.jl")
 
+# Argument type of functions consuming an upload, see matfrostjulia.openstream in MATLAB.
+const UploadStream = _Server.UploadStream
+
 include("example.jl")
 
 include("install.jl")
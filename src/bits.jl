@@ -0,0 +1,68 @@
+module _Bits
+
+"""
+Bit packing of logical arrays. Julia side of `Bits` in `bits.hpp`: 8 elements per byte, element i in bit i%8 of byte
+i÷8, the layout of the chunks of a `BitArray`.
+
+The MEX announces a threshold in the handshake, see `negotiate_bit_packing!`. Both sides send logical arrays of at
+least threshold elements over the socket tagged `ENCODING_BIT_PACKED`. Arrays placed in shared memory or cached keep
+one byte per element. A threshold of 0 disables bit packing.
+"""
+mutable struct BitPacking
+    threshold::Int64
+end
+
+BitPacking() = BitPacking(0)
+
+packs(bits::BitPacking, nel::Int64) = bits.threshold > 0 && nel >= bits.threshold
+
+packed_nbytes(nel::Int64) = (nel + 7) >> 3
+
+"""
+Pack `values` into `packed_nbytes(length(values))` bytes, 8 elements at a time in a 64-bit word.
+"""
+function pack_bits(values::Vector{Bool}) :: Vector{UInt8}
+    nel = length(values)
+    packed = Vector{UInt8}(undef, packed_nbytes(nel))
+    nwords = nel >> 3
+    GC.@preserve values packed begin
+        src = reinterpret(Ptr{UInt64}, pointer(values))
+        dst = pointer(packed)
+        @inbounds for i in 1:nwords
+            # Gathers the low bit of byte k into bit 56+k, without carries between the partial products.
+            word = unsafe_load(src, i)
+            unsafe_store!(dst, ((word * 0x0102040810204080) >> 56) % UInt8, i)
+        end
+    end
+    if nel & 7 != 0
+        byte = 0x00
+        for k in 0:(nel & 7)-1
+            byte |= UInt8(values[8*nwords + k + 1]) << k
+        end
+        packed[end] = byte
+    end
+    packed
+end
+
+"""
+Unpack `length(values)` elements from `packed` into `values`, 8 elements at a time in a 64-bit word.
+"""
+function unpack_bits!(values::Vector{Bool}, packed::Vector{UInt8}) :: Vector{Bool}
+    nel = length(values)
+    nwords = nel >> 3
+    GC.@preserve values packed begin
+        src = pointer(packed)
+        dst = reinterpret(Ptr{UInt64}, pointer(values))
+        @inbounds for i in 1:nwords
+            # Byte k keeps bit k of the packed byte, adding 0x7f carries it into bit 7 of the same byte.
+            spread = (UInt64(unsafe_load(src, i)) * 0x0101010101010101) & 0x8040201008040201
+            unsafe_store!(dst, ((spread + 0x7f7f7f7f7f7f7f7f) >> 7) & 0x0101010101010101, i)
+        end
+    end
+    for k in 0:(nel & 7)-1
+        values[8*nwords + k + 1] = (packed[end] >> k) & 0x01 != 0
+    end
+    values
+end
+
+end
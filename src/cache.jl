@@ -0,0 +1,65 @@
+module _Cache
+
+"""
+Cache of large primitive arguments, keyed by the digest of their payload. Julia side of `Cache::ArgumentCache` in
+`cache.hpp`: the MEX mirrors this cache, such that it sends an array Julia holds as a reference to its digest.
+
+Both sides record the digests used in every message, sent in full (`ENCODING_CACHED`) or referenced
+(`ENCODING_CACHE_REFERENCE`). After every message the least recently used payloads are evicted until the cache fits
+the budget, entries used in the same message in order of digest. A budget of 0 disables the cache.
+"""
+mutable struct CacheEntry
+    values::Vector
+    used::Int64
+end
+
+mutable struct ArgumentCache
+    budget::Int64
+    entries::Dict{UInt64, CacheEntry}
+    total::Int64
+    message::Int64
+end
+
+ArgumentCache() = ArgumentCache(0, Dict{UInt64, CacheEntry}(), 0, 0)
+
+"""
+Keep the payload of an array sent with `ENCODING_CACHED`. The cache holds a copy: the values handed out are converted
+to the arguments of the call, which may modify them.
+"""
+function cache_store!(cache::ArgumentCache, digest::UInt64, values::Vector{T}) where {T<:Number}
+    entry = get(cache.entries, digest, nothing)
+    if entry === nothing
+        cache.entries[digest] = CacheEntry(copy(values), cache.message)
+        cache.total += sizeof(values)
+    else
+        entry.used = cache.message
+    end
+    nothing
+end
+
+"""
+Payload of an array sent with `ENCODING_CACHE_REFERENCE`, a copy of the cached values.
+"""
+function cache_lookup!(cache::ArgumentCache, digest::UInt64, ::Type{T}, nel::Int64)::Vector{T} where {T<:Number}
+    entry = get(cache.entries, digest, nothing)
+    if entry === nothing || !(entry.values isa Vector{T}) || length(entry.values) != nel
+        error("Unrecoverable crash - MATFrost argument cache out of sync")
+    end
+    entry.used = cache.message
+    copy(entry.values::Vector{T})
+end
+
+"""
+Evict after reading a message, as `ArgumentCache::end_message` does after writing it.
+"""
+function end_message!(cache::ArgumentCache)
+    while cache.total > cache.budget && !isempty(cache.entries)
+        (_, digest) = minimum((entry.used, digest) for (digest, entry) in cache.entries)
+        cache.total -= sizeof(cache.entries[digest].values)
+        delete!(cache.entries, digest)
+    end
+    cache.message += 1
+    nothing
+end
+
+end
@@ -3,7 +3,10 @@ module _Constants
 
 export matlab_type, matlab_type_name, matlab_type_nospecialize
 
-export sizeof_matlab_primitive
+export sizeof_matlab_primitive, is_sparse
+
+export TYPE_MASK, ENCODING_SHARED_MEMORY, ENCODING_SCHEMA_REFERENCE, ENCODING_COLUMNAR, ENCODING_CACHED, ENCODING_CACHE_REFERENCE,
+    ENCODING_PLAN, ENCODING_PLAN_REFERENCE, ENCODING_PACKED, PACKED_MIN_STRINGS, ENCODING_BIT_PACKED
 
 export LOGICAL, CHAR, MATLAB_STRING,
     DOUBLE, SINGLE,
@@ -15,6 +18,8 @@ export LOGICAL, CHAR, MATLAB_STRING,
     OBJECT, VALUE_OBJECT, HANDLE_OBJECT_REF, ENUM, 
     SPARSE_LOGICAL, SPARSE_DOUBLE, SPARSE_COMPLEX_DOUBLE
 
+using SparseArrays: SparseMatrixCSC
+
 using .._Types
 
 const LOGICAL = Int32(0)
@@ -59,12 +64,44 @@ const SPARSE_LOGICAL = Int32(29)
 const SPARSE_DOUBLE = Int32(30)
 const SPARSE_COMPLEX_DOUBLE = Int32(31)
 
+is_sparse(type::Int32) = type == SPARSE_LOGICAL || type == SPARSE_DOUBLE || type == SPARSE_COMPLEX_DOUBLE
+
+
+# Wire encoding flags. The lower 16 bits of a type tag hold the MATLAB array type.
+const TYPE_MASK = Int32(0xFFFF)
+
+const ENCODING_SHARED_MEMORY = Int32(0x10000)
+
+# Struct field names given by the index of an earlier struct in the message, see `_Schemas`.
+const ENCODING_SCHEMA_REFERENCE = Int32(0x20000)
+
+# Cell array of primitive arrays of equal type and dimensions, or struct array, sent column by column. See
+# `write_matfrostarray_column!`.
+const ENCODING_COLUMNAR = Int32(0x40000)
+
+# Primitive array cached by Julia, the header is followed by the digest of the payload. See `_Cache`.
+const ENCODING_CACHED = Int32(0x80000)
+const ENCODING_CACHE_REFERENCE = Int32(0x100000)
+
+# Message sent by serialization plan, see `_Plans`.
+const ENCODING_PLAN = Int32(0x200000)
+const ENCODING_PLAN_REFERENCE = Int32(0x400000)
+
+# String array sent as an offsets table followed by all strings back to back, see `write_matfrostarray_string!`.
+const ENCODING_PACKED = Int32(0x800000)
+
+# String arrays of at least this many elements are sent packed.
+const PACKED_MIN_STRINGS = 2
+
+# Logical array sent 8 elements per byte, see `_Bits`.
+const ENCODING_BIT_PACKED = Int32(0x1000000)
+
 
 
 matlab_type(::Type{T}) where {T} = STRUCT
 
 matlab_type(::Type{T}) where {T<:Tuple} = CELL
-matlab_type(::Type{T}) where {T<:Array{<:Union{Array,Tuple}}} = CELL
+matlab_type(::Type{T}) where {T<:Array{<:Union{Array,Tuple,SparseMatrixCSC}}} = CELL
 
 
 matlab_type(::Type{Bool}) = LOGICAL
@@ -97,11 +134,18 @@ matlab_type(::Type{Complex{Int64}})    = COMPLEX_INT64
 
 matlab_type(::Type{Array{T, N}}) where {T <: Union{Number, String}, N} = matlab_type(T)
 
+matlab_type(::Type{SparseMatrixCSC{Bool, Ti}}) where {Ti} = SPARSE_LOGICAL
+matlab_type(::Type{SparseMatrixCSC{Tv, Ti}}) where {Tv <: Real, Ti} = SPARSE_DOUBLE
+matlab_type(::Type{SparseMatrixCSC{Tv, Ti}}) where {Tv <: Complex, Ti} = SPARSE_COMPLEX_DOUBLE
+
 matlab_type(::MATFrostArrayEmpty) = DOUBLE
 matlab_type(::MATFrostArrayStruct) = STRUCT
 matlab_type(::MATFrostArrayCell) = CELL
 matlab_type(::MATFrostArrayString) = matlab_type(String)
 matlab_type(::MATFrostArrayPrimitive{T}) where {T} = matlab_type(T)
+matlab_type(::MATFrostArraySparse{Bool}) = SPARSE_LOGICAL
+matlab_type(::MATFrostArraySparse{Float64}) = SPARSE_DOUBLE
+matlab_type(::MATFrostArraySparse{Complex{Float64}}) = SPARSE_COMPLEX_DOUBLE
 
 
 @noinline function matlab_type_nospecialize(@nospecialize(marr::MATFrostArrayAbstract))::Int32
@@ -115,6 +159,13 @@ matlab_type(::MATFrostArrayPrimitive{T}) where {T} = matlab_type(T)
     elseif marr isa MATFrostArrayCell
         matlab_type(marr)
 
+    elseif marr isa MATFrostArraySparse{Bool}
+        matlab_type(marr)
+    elseif marr isa MATFrostArraySparse{Float64}
+        matlab_type(marr)
+    elseif marr isa MATFrostArraySparse{Complex{Float64}}
+        matlab_type(marr)
+
     elseif marr isa MATFrostArrayPrimitive{Bool}
         matlab_type(marr)
 
@@ -1,5 +1,7 @@
 module _ConvertToJulia
 
+using SparseArrays: SparseMatrixCSC, spzeros
+
 using .._Types
 using .._Constants
 
@@ -76,6 +78,24 @@ Convert to Arrays of Strings
 end
 
 
+"""
+Convert to sparse matrices. MATLAB sparse matrices are logical, double or complex double, their indices convert to
+Int64 without copying.
+"""
+@noinline function convert_matfrostarray(::Type{SparseMatrixCSC{Tv,Int64}}, @nospecialize(marr::MATFrostArrayAbstract))::SparseMatrixCSC{Tv,Int64} where {Tv<:Union{Bool,Float64,Complex{Float64}}}
+    if marr isa MATFrostArraySparse{Tv}
+        SparseMatrixCSC{Tv,Int64}(marr.dims[1], marr.dims[2], marr.colptr, marr.rowval, marr.nzval)
+    elseif marr isa MATFrostArrayEmpty
+        spzeros(Tv, Int64, 0, 0)
+    else
+        throw(incompatible_datatypes_exception(SparseMatrixCSC{Tv,Int64}, marr))
+    end
+end
+
+@noinline function convert_matfrostarray(::Type{SparseMatrixCSC{Tv,Ti}}, @nospecialize(marr::MATFrostArrayAbstract))::SparseMatrixCSC{Tv,Ti} where {Tv,Ti}
+    throw(unsupported_datatype_exception(SparseMatrixCSC{Tv,Ti}))
+end
+
 """
 Convert to 0-size Tuples
 """
@@ -188,9 +208,9 @@ end
 
 
 """
-Convert to arrays of arrays/tuples
+Convert to arrays of arrays/tuples/sparse matrices
 """
-@generated function convert_matfrostarray(::Type{Array{T,N}}, @nospecialize(marr::MATFrostArrayAbstract))::Array{T,N} where {T<:Union{Array, Tuple},N}
+@generated function convert_matfrostarray(::Type{Array{T,N}}, @nospecialize(marr::MATFrostArrayAbstract))::Array{T,N} where {T<:Union{Array, Tuple, SparseMatrixCSC},N}
     quote
         if marr isa MATFrostArrayCell
             validate_array_dimensions(Array{T,N}, marr)
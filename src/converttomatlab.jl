@@ -1,6 +1,8 @@
 
 module _ConvertToMATLAB
 
+using SparseArrays: SparseMatrixCSC, nnz
+
 using .._Types
 using .._Constants
 
@@ -40,6 +42,29 @@ end
 end
 
 
+sparse_eltype(::Type{Bool}) = Bool
+sparse_eltype(::Type{T}) where {T<:Real} = Float64
+sparse_eltype(::Type{T}) where {T<:Complex} = Complex{Float64}
+
+"""
+Leading n elements of a vector of a sparse matrix as Vector{T}, without copying if possible.
+"""
+function sparse_values(::Type{T}, v::Vector, n::Int) where {T}
+    convert(Vector{T}, length(v) == n ? v : v[1:n])
+end
+
+"""
+Sparse matrices are sent in compressed-column form. MATLAB only has logical, double and complex double sparse
+matrices, other element types are converted to double or complex double.
+"""
+@noinline function convert_matfrostarray(arr::SparseMatrixCSC{Tv}) where {Tv <: Number}
+    T = sparse_eltype(Tv)
+    n = nnz(arr)
+    MATFrostArraySparse{T}(Int64[size(arr)...],
+        sparse_values(Int64, arr.colptr, length(arr.colptr)),
+        sparse_values(Int64, arr.rowval, n),
+        sparse_values(T, arr.nzval, n))
+end
 @generated function convert_matfrostarray(structval::T) where {T}
     quote
         
@@ -95,7 +120,7 @@ end
 
 end
 
-@generated function convert_matfrostarray(arr::Array{T,N}) where {T<:Union{Array, Tuple}, N}
+@generated function convert_matfrostarray(arr::Array{T,N}) where {T<:Union{Array, Tuple, SparseMatrixCSC}, N}
     quote
         if length(arr) == 0
             return MATFrostArrayEmpty()
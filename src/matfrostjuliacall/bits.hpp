@@ -0,0 +1,93 @@
+/**
+ * Bit packing of logical arrays: 8 elements per byte, element i in bit i%8 of byte i/8. This is the layout of the
+ * chunks of a Julia BitArray.
+ *
+ * Logical arrays of at least the negotiated threshold of elements are sent packed, see
+ * BufferedUnixDomainSocket::negotiate_bit_packing. Smaller ones keep one byte per element. With SSE2 (see simd.hpp),
+ * blocks of 16 elements are packed and unpacked at a time. Otherwise 8 elements are handled in a 64-bit word.
+ * Elements are expected to be 0 or 1, as MATLAB logicals and Julia Bools are. Free of MATLAB dependencies.
+ */
+#ifndef MATFROST_JL_BITS_HPP
+#define MATFROST_JL_BITS_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "simd.hpp"
+
+namespace MATFrost::Bits {
+
+    // Elements packed and unpacked at a time when streaming from or to the socket.
+    constexpr size_t BLOCK_ELEMENTS = 1 << 16;
+
+    inline size_t packed_nbytes(const size_t nel) {
+        return (nel + 7) / 8;
+    }
+
+    /**
+     * Whether a logical array of nel elements is sent packed. A threshold of 0 disables bit packing.
+     */
+    inline bool packs(const uint64_t threshold, const size_t nel) {
+        return threshold > 0 && nel >= threshold;
+    }
+
+    /**
+     * Pack nel elements of src into packed_nbytes(nel) bytes of dst. Unused bits of the last byte are zero.
+     */
+    inline void pack(const bool *src, const size_t nel, uint8_t *dst) {
+        const auto *s = reinterpret_cast<const uint8_t *>(src);
+        size_t i = 0;
+#ifdef MATFROST_JL_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= nel; i += 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            const uint32_t mask = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)));
+            dst[i / 8] = static_cast<uint8_t>(mask);
+            dst[i / 8 + 1] = static_cast<uint8_t>(mask >> 8);
+        }
+#endif
+        for (; i + 8 <= nel; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, s + i, sizeof(uint64_t));
+            // Gathers the low bit of byte k into bit 56+k, without carries between the partial products.
+            dst[i / 8] = static_cast<uint8_t>((word * 0x0102040810204080ULL) >> 56);
+        }
+        if (i < nel) {
+            uint8_t byte = 0;
+            for (size_t k = 0; i + k < nel; k++) {
+                byte |= static_cast<uint8_t>((s[i + k] != 0) << k);
+            }
+            dst[i / 8] = byte;
+        }
+    }
+
+    /**
+     * Unpack nel elements from packed_nbytes(nel) bytes of src into dst.
+     */
+    inline void unpack(const uint8_t *src, const size_t nel, bool *dst) {
+        auto *d = reinterpret_cast<uint8_t *>(dst);
+        size_t i = 0;
+#ifdef MATFROST_JL_SSE2
+        const __m128i select = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+        const __m128i one = _mm_set1_epi8(1);
+        for (; i + 16 <= nel; i += 16) {
+            const __m128i bytes = _mm_unpacklo_epi64(_mm_set1_epi8(static_cast<char>(src[i / 8])),
+                _mm_set1_epi8(static_cast<char>(src[i / 8 + 1])));
+            const __m128i bits = _mm_cmpeq_epi8(_mm_and_si128(bytes, select), select);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(d + i), _mm_and_si128(bits, one));
+        }
+#endif
+        for (; i + 8 <= nel; i += 8) {
+            // Byte k keeps bit k of the packed byte, adding 0x7F carries it into bit 7 of the same byte.
+            const uint64_t spread = (src[i / 8] * 0x0101010101010101ULL) & 0x8040201008040201ULL;
+            const uint64_t word = ((spread + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+            std::memcpy(d + i, &word, sizeof(uint64_t));
+        }
+        for (size_t k = 0; i + k < nel; k++) {
+            d[i + k] = static_cast<uint8_t>((src[i / 8] >> k) & 1);
+        }
+    }
+
+}
+
+#endif //MATFROST_JL_BITS_HPP
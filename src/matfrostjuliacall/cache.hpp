@@ -0,0 +1,205 @@
+/**
+ * Content-addressed cache of large primitive arguments, opt-in per connection.
+ *
+ * Julia keeps the payloads of recently sent large primitive arrays, keyed by a 64-bit digest of their bytes. An array
+ * Julia already holds is sent as a reference to its digest instead of in full. ArgumentCache mirrors the Julia cache,
+ * such that the MEX knows which digests Julia holds without asking:
+ *
+ * - every message, both sides record the digests used in the message: sent in full or referenced;
+ * - after every message, both sides evict the least recently used payloads until the cache fits the budget. Entries
+ *   used in the same message are evicted in order of digest.
+ *
+ * Decisions only depend on the cache state at the start of the message, such that the sizing passes over a message and
+ * the write itself agree. See Write::write_primitive.
+ */
+#ifndef MATFROST_JL_CACHE_HPP
+#define MATFROST_JL_CACHE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <set>
+#include <utility>
+
+namespace MATFrost::Cache {
+
+    /**
+     * XXH64 of the bytes, seed 0. Non-cryptographic, processes 32 bytes per iteration.
+     */
+    inline uint64_t hash(const uint8_t* data, const size_t nb) {
+        constexpr uint64_t P1 = 11400714785074694791ULL;
+        constexpr uint64_t P2 = 14029467366897019727ULL;
+        constexpr uint64_t P3 = 1609587929392839161ULL;
+        constexpr uint64_t P4 = 9650029242287828579ULL;
+        constexpr uint64_t P5 = 2870177450012600261ULL;
+
+        auto rotl = [](const uint64_t x, const int r) { return (x << r) | (x >> (64 - r)); };
+        auto read64 = [](const uint8_t* p) { uint64_t v; std::memcpy(&v, p, sizeof(v)); return v; };
+        auto read32 = [](const uint8_t* p) { uint32_t v; std::memcpy(&v, p, sizeof(v)); return v; };
+        auto round = [&](uint64_t acc, const uint64_t input) {
+            acc += input * P2;
+            acc = rotl(acc, 31);
+            return acc * P1;
+        };
+        auto merge = [&](uint64_t acc, const uint64_t val) {
+            acc ^= round(0, val);
+            return acc * P1 + P4;
+        };
+
+        const uint8_t* p = data;
+        const uint8_t* const end = data + nb;
+        uint64_t h;
+
+        if (nb >= 32) {
+            uint64_t v1 = P1 + P2;
+            uint64_t v2 = P2;
+            uint64_t v3 = 0;
+            uint64_t v4 = 0 - P1;
+            const uint8_t* const limit = end - 32;
+            do {
+                v1 = round(v1, read64(p));
+                v2 = round(v2, read64(p + 8));
+                v3 = round(v3, read64(p + 16));
+                v4 = round(v4, read64(p + 24));
+                p += 32;
+            } while (p <= limit);
+
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = merge(h, v1);
+            h = merge(h, v2);
+            h = merge(h, v3);
+            h = merge(h, v4);
+        } else {
+            h = P5;
+        }
+
+        h += static_cast<uint64_t>(nb);
+
+        while (p + 8 <= end) {
+            h ^= round(0, read64(p));
+            h = rotl(h, 27) * P1 + P4;
+            p += 8;
+        }
+        if (p + 4 <= end) {
+            h ^= static_cast<uint64_t>(read32(p)) * P1;
+            h = rotl(h, 23) * P2 + P3;
+            p += 4;
+        }
+        while (p < end) {
+            h ^= static_cast<uint64_t>(*p) * P5;
+            h = rotl(h, 11) * P1;
+            p++;
+        }
+
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    enum class Mode {
+        NONE,       // Not cached: sent as usual.
+        FULL,       // Sent in full, Julia keeps the payload.
+        REFERENCE   // Held by Julia, only the digest is sent.
+    };
+
+    class ArgumentCache {
+        struct Entry {
+            uint64_t nbytes;
+            uint64_t used;    // Message in which the entry was last used.
+        };
+
+        std::map<uint64_t, Entry> entries{};
+        uint64_t total = 0;
+        uint64_t message = 0;
+
+        // Digests of the arrays of the current message, such that every array is hashed once.
+        std::map<std::pair<const void*, size_t>, uint64_t> digests{};
+
+    public:
+        uint64_t budget = 0;
+        uint64_t threshold = 0;
+
+        // Digests sent in full by the write of the current message.
+        std::set<uint64_t> written{};
+
+        /**
+         * Whether an array of nb bytes is cached: large enough, but not larger than the whole budget.
+         */
+        bool caches(const size_t nb) const {
+            return budget > 0 && nb >= threshold && nb > 0 && nb <= budget;
+        }
+
+        uint64_t digest(const void* data, const size_t nb) {
+            const auto key = std::make_pair(data, nb);
+            auto it = digests.find(key);
+            if (it != digests.end()) {
+                return it->second;
+            }
+            const uint64_t d = hash(reinterpret_cast<const uint8_t *>(data), nb);
+            digests.emplace(key, d);
+            return d;
+        }
+
+        /**
+         * Encoding of an array of nb bytes at data. sent holds the digests sent in full in this message by the pass
+         * over the message asking, a later occurrence of the same payload is a reference.
+         */
+        Mode mode(const void* data, const size_t nb, std::set<uint64_t> &sent, uint64_t &d) {
+            if (!caches(nb)) {
+                return Mode::NONE;
+            }
+            d = digest(data, nb);
+            if (entries.find(d) != entries.end() || sent.count(d) > 0) {
+                return Mode::REFERENCE;
+            }
+            sent.insert(d);
+            return Mode::FULL;
+        }
+
+        /**
+         * Record the use of a payload by the message being written, as Julia will on reading it.
+         */
+        void use(const uint64_t d, const uint64_t nbytes) {
+            auto it = entries.find(d);
+            if (it == entries.end()) {
+                entries.emplace(d, Entry{nbytes, message});
+                total += nbytes;
+            } else {
+                it->second.used = message;
+            }
+        }
+
+        /**
+         * Evict as Julia does after reading the message, see `end_message!` in cache.jl.
+         */
+        void end_message() {
+            while (total > budget && !entries.empty()) {
+                auto lru = entries.begin();
+                for (auto it = entries.begin(); it != entries.end(); ++it) {
+                    if (it->second.used < lru->second.used) {
+                        lru = it;
+                    }
+                }
+                total -= lru->second.nbytes;
+                entries.erase(lru);
+            }
+            digests.clear();
+            written.clear();
+            message++;
+        }
+
+        size_t size() const {
+            return entries.size();
+        }
+
+        uint64_t nbytes() const {
+            return total;
+        }
+    };
+
+}
+
+#endif //MATFROST_JL_CACHE_HPP
@@ -0,0 +1,119 @@
+/**
+ * Wire encoding flags. The lower 16 bits of the type tag hold the MATLAB array type, the upper bits mark alternative
+ * encodings of the payload.
+ */
+#ifndef MATFROST_JL_ENCODING_HPP
+#define MATFROST_JL_ENCODING_HPP
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace MATFrost::Encoding {
+
+    constexpr int32_t TYPE_MASK = 0xFFFF;
+
+    // Primitive payload placed in the shared memory block of the message.
+    constexpr int32_t SHARED_MEMORY = 0x10000;
+
+    // Struct field names given by the index of an earlier struct in the message, see Schemas.
+    constexpr int32_t SCHEMA_REFERENCE = 0x20000;
+
+    // Cell array of primitive arrays of equal type and dimensions, or struct array, sent column by column: a single
+    // header for all elements followed by their payloads back to back. See Write::write_column.
+    constexpr int32_t COLUMNAR = 0x40000;
+
+    // Primitive array cached by Julia: the header is followed by the digest of the payload, see Cache::ArgumentCache.
+    // CACHED payloads follow as usual and are kept by Julia, CACHE_REFERENCE payloads are taken from the Julia cache.
+    constexpr int32_t CACHED = 0x80000;
+    constexpr int32_t CACHE_REFERENCE = 0x100000;
+
+    // Message sent by serialization plan, see Plans. PLAN: [plan id u64] followed by the array in full, which becomes
+    // the plan. PLAN_REFERENCE: [plan id u64][threshold u64] followed by the payloads of the plan back to back, payloads
+    // of at least threshold bytes in the shared memory block.
+    constexpr int32_t PLAN = 0x200000;
+    constexpr int32_t PLAN_REFERENCE = 0x400000;
+
+    // String array sent at once: [offsets (nel+1) u64][UTF-8 of all strings back to back], string i spans bytes
+    // [offsets[i], offsets[i+1]). See Write::write_string.
+    constexpr int32_t PACKED = 0x800000;
+
+    // Logical array sent 8 elements per byte: [packed_nbytes(nel) bytes], see Bits. Only for arrays of at least the
+    // negotiated threshold of elements sent over the socket.
+    constexpr int32_t BIT_PACKED = 0x1000000;
+
+    /**
+     * Struct field names interned per message. The first struct with a given list of field names is sent in full:
+     * [nfields][names], and becomes the next schema. Later structs with the same field names are tagged with
+     * SCHEMA_REFERENCE and send only the index of the schema: [index u64].
+     */
+    struct Schemas {
+        std::map<std::vector<std::string>, uint64_t> written{};
+        // Deque: references stay valid while nested structs add schemas.
+        std::deque<std::vector<std::string>> read{};
+
+        /**
+         * Look up the schema of the field names. Returns true if written before in this message, otherwise the field
+         * names are registered as the next schema.
+         */
+        bool intern(const std::vector<std::string> &fieldnames, uint64_t &index) {
+            auto it = written.find(fieldnames);
+            if (it != written.end()) {
+                index = it->second;
+                return true;
+            }
+            index = written.size();
+            written.emplace(fieldnames, index);
+            return false;
+        }
+    };
+
+    inline matlab::data::ArrayType array_type(const int32_t type) {
+        return static_cast<matlab::data::ArrayType>(type & TYPE_MASK);
+    }
+
+    inline int32_t encoding(const int32_t type) {
+        return type & ~TYPE_MASK;
+    }
+
+    /**
+     * Size of a single element of a primitive MATLAB array, 0 for non-primitive arrays.
+     */
+    inline size_t element_size(const matlab::data::ArrayType type) {
+        switch (type) {
+            case matlab::data::ArrayType::LOGICAL:
+            case matlab::data::ArrayType::INT8:
+            case matlab::data::ArrayType::UINT8:
+                return 1;
+            case matlab::data::ArrayType::INT16:
+            case matlab::data::ArrayType::UINT16:
+            case matlab::data::ArrayType::COMPLEX_INT8:
+            case matlab::data::ArrayType::COMPLEX_UINT8:
+                return 2;
+            case matlab::data::ArrayType::SINGLE:
+            case matlab::data::ArrayType::INT32:
+            case matlab::data::ArrayType::UINT32:
+            case matlab::data::ArrayType::COMPLEX_INT16:
+            case matlab::data::ArrayType::COMPLEX_UINT16:
+                return 4;
+            case matlab::data::ArrayType::DOUBLE:
+            case matlab::data::ArrayType::INT64:
+            case matlab::data::ArrayType::UINT64:
+            case matlab::data::ArrayType::COMPLEX_SINGLE:
+            case matlab::data::ArrayType::COMPLEX_INT32:
+            case matlab::data::ArrayType::COMPLEX_UINT32:
+                return 8;
+            case matlab::data::ArrayType::COMPLEX_DOUBLE:
+            case matlab::data::ArrayType::COMPLEX_INT64:
+            case matlab::data::ArrayType::COMPLEX_UINT64:
+                return 16;
+            default:
+                return 0;
+        }
+    }
+
+}
+
+#endif //MATFROST_JL_ENCODING_HPP
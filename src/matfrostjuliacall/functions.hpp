@@ -0,0 +1,71 @@
+/**
+ * Function IDs of the functions resolved on a single connection.
+ *
+ * On first use of a function MATFrost sends a RESOLVE to Julia, which looks up the function and its argument types
+ * once and returns a function ID. Later calls send the ID instead of the fully qualified name and signature.
+ */
+#ifndef MATFROST_JL_FUNCTIONS_HPP
+#define MATFROST_JL_FUNCTIONS_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace MATFrost::Functions {
+
+    class FunctionTable {
+        std::map<std::u16string, int64_t> function_ids{};
+
+    public:
+
+        /**
+         * Key identifying the function of a callmeta struct: the fully qualified name followed by the signature.
+         */
+        static std::u16string key(const matlab::data::StructArray &callmeta) {
+            std::u16string key = static_cast<const matlab::data::StringArray>(callmeta[0]["fully_qualified_name"])[0];
+
+            const matlab::data::Array signature = callmeta[0]["signature"];
+            if (signature.getType() == matlab::data::ArrayType::MATLAB_STRING) {
+                const matlab::data::StringArray entries(signature);
+                for (size_t i = 0; i < entries.getNumberOfElements(); i++) {
+                    key += u'\0';
+                    key += std::u16string(entries[i]);
+                }
+            }
+            return key;
+        }
+
+        /**
+         * Function ID from the response to a RESOLVE. Returns false if Julia could not resolve the function.
+         */
+        static bool resolved_id(const matlab::data::Array &result, int64_t &function_id) {
+            if (result.getType() != matlab::data::ArrayType::STRUCT) {
+                return false;
+            }
+            const matlab::data::StructArray result_struct(result);
+            const std::u16string status = static_cast<const matlab::data::StringArray>(result_struct[0]["status"])[0];
+            const matlab::data::Array value = result_struct[0]["value"];
+            if (status != u"SUCCESFUL" || value.getType() != matlab::data::ArrayType::INT64) {
+                return false;
+            }
+            function_id = static_cast<const matlab::data::TypedArray<int64_t>>(value)[0];
+            return true;
+        }
+
+        bool find(const std::u16string &key, int64_t &function_id) const {
+            auto it = function_ids.find(key);
+            if (it == function_ids.end()) {
+                return false;
+            }
+            function_id = it->second;
+            return true;
+        }
+
+        void insert(const std::u16string &key, const int64_t function_id) {
+            function_ids[key] = function_id;
+        }
+    };
+
+}
+
+#endif //MATFROST_JL_FUNCTIONS_HPP
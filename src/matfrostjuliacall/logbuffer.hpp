@@ -0,0 +1,129 @@
+/**
+ * Bounded buffer of the output of a Julia process, filled by the log-drain thread of MATFrostServer and emptied on the
+ * MATLAB thread. Free of MATLAB dependencies.
+ *
+ * The buffer is a ring of fixed capacity. When full the oldest output is dropped, or appended to the spill file if one
+ * is configured. The next take reports how much output went missing.
+ */
+#ifndef MATFROST_JL_LOGBUFFER_HPP
+#define MATFROST_JL_LOGBUFFER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace MATFrost::Logs {
+
+    class LogBuffer {
+        std::mutex mutex{};
+        std::vector<char> ring;
+        size_t start = 0;
+        size_t size = 0;
+
+        std::ofstream spill{};
+        uint64_t dropped = 0;
+        uint64_t spilled = 0;
+
+        /**
+         * Remove the nb oldest bytes of the ring.
+         */
+        void evict(size_t nb) {
+            while (nb > 0) {
+                const size_t chunk = std::min(nb, ring.size() - start);
+                overflow(ring.data() + start, chunk);
+                start = (start + chunk) % ring.size();
+                size -= chunk;
+                nb -= chunk;
+            }
+        }
+
+        void overflow(const char* data, const size_t nb) {
+            if (spill.is_open()) {
+                spill.write(data, static_cast<std::streamsize>(nb));
+                spilled += nb;
+            } else {
+                dropped += nb;
+            }
+        }
+
+    public:
+        const std::string spill_path;
+
+        /**
+         * Buffer of capacity bytes. If spill_path is non-empty, output overflowing the buffer is appended to that file.
+         */
+        LogBuffer(const size_t capacity, std::string spill_path) :
+            ring(std::max<size_t>(capacity, 1)), spill_path(std::move(spill_path))
+        {
+            if (!this->spill_path.empty()) {
+                spill.open(this->spill_path, std::ios::binary | std::ios::app);
+            }
+        }
+
+        void append(const char* data, size_t nb) {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (nb >= ring.size()) {
+                // Output larger than the buffer: only its tail is kept.
+                evict(size);
+                start = 0;
+                const size_t skip = nb - ring.size();
+                overflow(data, skip);
+                data += skip;
+                nb -= skip;
+            } else if (size + nb > ring.size()) {
+                evict(size + nb - ring.size());
+            }
+
+            size_t end = (start + size) % ring.size();
+            while (nb > 0) {
+                const size_t chunk = std::min(nb, ring.size() - end);
+                std::copy(data, data + chunk, ring.data() + end);
+                end = (end + chunk) % ring.size();
+                size += chunk;
+                data += chunk;
+                nb -= chunk;
+            }
+            if (spill.is_open()) {
+                spill.flush();
+            }
+        }
+
+        bool empty() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return size == 0 && dropped == 0 && spilled == 0;
+        }
+
+        /**
+         * Take the buffered output, preceded by a notice if output has been dropped or spilled since the last take.
+         */
+        std::string take() {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            std::string text{};
+            if (dropped > 0) {
+                text += "[MATFrost: " + std::to_string(dropped) + " bytes of Julia output dropped]\n";
+            }
+            if (spilled > 0) {
+                text += "[MATFrost: " + std::to_string(spilled) + " bytes of Julia output written to " + spill_path + "]\n";
+            }
+            dropped = 0;
+            spilled = 0;
+
+            text.reserve(text.size() + size);
+            const size_t first = std::min(size, ring.size() - start);
+            text.append(ring.data() + start, first);
+            text.append(ring.data(), size - first);
+
+            start = 0;
+            size = 0;
+            return text;
+        }
+    };
+
+}
+
+#endif //MATFROST_JL_LOGBUFFER_HPP
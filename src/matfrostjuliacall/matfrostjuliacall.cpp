@@ -1,7 +1,9 @@
 
 
 #include <cstdint>
+#ifdef _WIN32
 #include <winsock2.h>
+#endif
 
 #include "mex.hpp"
 #include "mexAdapter.hpp"
@@ -27,13 +29,22 @@ using matlab::mex::ArgumentList;
 #include "write.hpp"
 
 #include "read.hpp"
+#include "requests.hpp"
+#include "functions.hpp"
+#include "pool.hpp"
+#include "standby.hpp"
+#include "streams.hpp"
+#include "sessions.hpp"
 
 
 
 #define EXPERIMENT_SIZE 1000000
 
-std::map<uint64_t, std::shared_ptr<MATFrost::MATFrostServer>> matfrost_server{};
-std::map<uint64_t, std::shared_ptr<MATFrost::Socket::BufferedUnixDomainSocket>> matfrost_connections{};
+MATFrost::Sessions::Registry matfrost_sessions{};
+
+// Julia processes in standby per launch command line, shared by all sessions.
+std::map<std::string, std::shared_ptr<MATFrost::Standby::Pool>> matfrost_standby{};
+std::mutex matfrost_standby_mutex{};
 
 class MexFunction : public matlab::mex::Function {
 private:
@@ -61,101 +72,270 @@ public:
         const uint64_t id = static_cast<const matlab::data::TypedArray<uint64_t>>(input["id"])[0];
         const std::u16string action = static_cast<const matlab::data::StringArray>(input["action"])[0];
 
+        // All actions but START and STOP act on a started session, see Sessions::Registry. Actions on the same session
+        // are serialized, actions on different sessions run concurrently.
+        std::shared_ptr<MATFrost::Sessions::Session> session{};
+        std::unique_lock<std::mutex> lock{};
+        if (action != u"START" && action != u"STOP") {
+            session = connected(id);
+            lock = std::unique_lock<std::mutex>(session->mutex);
+        }
+
         if (action == u"START") {
-            const std::string cmdline = static_cast<const matlab::data::StringArray>(input["cmdline"])[0];
-            const std::string socket_path = static_cast<const matlab::data::StringArray>(input["socket"])[0];
+            // One cmdline and socket per worker. The first worker serves the regular calls.
+            const matlab::data::StringArray cmdlines = input["cmdline"];
+            const matlab::data::StringArray socket_paths = input["socket"];
             const uint64_t timeout = static_cast<const matlab::data::TypedArray<uint64_t>>(input["timeout"])[0];
-
-            if (matfrost_server.find(id) != matfrost_server.end() || matfrost_connections.find(id) != matfrost_connections.end()) {
+            const uint64_t shared_memory = static_cast<const matlab::data::TypedArray<uint64_t>>(input["sharedmemory"])[0];
+            const uint64_t shared_memory_threshold = static_cast<const matlab::data::TypedArray<uint64_t>>(input["sharedmemorythreshold"])[0];
+            const uint64_t cache_budget = static_cast<const matlab::data::TypedArray<uint64_t>>(input["argumentcache"])[0];
+            const uint64_t cache_threshold = static_cast<const matlab::data::TypedArray<uint64_t>>(input["argumentcachethreshold"])[0];
+            const uint64_t bit_packing_threshold = static_cast<const matlab::data::TypedArray<uint64_t>>(input["bitpackthreshold"])[0];
+            const uint64_t log_capacity = static_cast<const matlab::data::TypedArray<uint64_t>>(input["logbuffer"])[0];
+            const std::string log_spill = static_cast<const matlab::data::StringArray>(input["logfile"])[0];
+            MATFrost::Socket::BufferSizes buffer_sizes{};
+            buffer_sizes.nbytes = static_cast<const matlab::data::TypedArray<uint64_t>>(input["socketbuffer"])[0];
+            buffer_sizes.kernel_nbytes = static_cast<const matlab::data::TypedArray<uint64_t>>(input["socketkernelbuffer"])[0];
+            buffer_sizes.adaptive = static_cast<const matlab::data::TypedArray<bool>>(input["adaptivebuffers"])[0];
+            const uint64_t standby = static_cast<const matlab::data::TypedArray<uint64_t>>(input["standby"])[0];
+            const std::string launch = static_cast<const matlab::data::StringArray>(input["launch"])[0];
+
+            if (matfrost_sessions.contains(id)) {
                 throw(matlab::engine::MATLABException("MATFrost server already started"));
             }
+            if (cmdlines.getNumberOfElements() == 0 || cmdlines.getNumberOfElements() != socket_paths.getNumberOfElements()) {
+                throw(matlab::engine::MATLABException("MATFrost requires one cmdline and socket per worker"));
+            }
             auto matlab = getEngine();
-            auto server = MATFrost::MATFrostServer::spawn(cmdline);
-            auto socket = MATFrost::Socket::BufferedUnixDomainSocket::connect_socket(socket_path, server, matlab, static_cast<long>(timeout));
 
-            matfrost_server[id] = server;
-            matfrost_connections[id] = socket;
+            // Spawn all workers before connecting, such that they boot in parallel. With standby, workers are claimed
+            // from the processes started ahead of time, and their replacements boot meanwhile.
+            std::vector<std::shared_ptr<MATFrost::MATFrostServer>> servers{};
+            std::vector<std::string> paths{};
+            for (size_t w = 0; w < cmdlines.getNumberOfElements(); w++) {
+                if (standby > 0) {
+                    std::lock_guard<std::mutex> standby_lock(matfrost_standby_mutex);
+                    auto &pool = matfrost_standby[launch];
+                    if (!pool) {
+                        pool = std::make_shared<MATFrost::Standby::Pool>(launch, std::string(socket_paths[0]), log_capacity, log_spill);
+                    }
+                    pool->target = standby;
+                    const MATFrost::Standby::Process process = pool->claim();
+                    servers.push_back(process.server);
+                    paths.push_back(process.socket_path);
+                } else {
+                    servers.push_back(MATFrost::MATFrostServer::spawn(std::string(cmdlines[w]), log_capacity, log_spill));
+                    paths.push_back(std::string(socket_paths[w]));
+                }
+            }
 
+            std::vector<MATFrost::Pool::Worker> workers{};
+            for (size_t w = 0; w < servers.size(); w++) {
+                auto socket = MATFrost::Socket::BufferedUnixDomainSocket::connect_socket(paths[w], servers[w], matlab, static_cast<long>(timeout), shared_memory, shared_memory_threshold, cache_budget, cache_threshold, bit_packing_threshold, buffer_sizes);
+                workers.push_back(MATFrost::Pool::Worker{servers[w], socket, std::make_shared<MATFrost::Requests::PendingRequests>(), std::make_shared<MATFrost::Functions::FunctionTable>()});
+            }
 
-        } else if (action == u"STOP") {
-            if (matfrost_connections.find(id) != matfrost_connections.end()) {
-                matfrost_connections.erase(id);
+            if (!matfrost_sessions.insert(id, std::make_shared<MATFrost::Sessions::Session>(std::make_shared<MATFrost::Pool::WorkerPool>(workers)))) {
+                throw(matlab::engine::MATLABException("MATFrost server already started"));
             }
-            if (matfrost_server.find(id) != matfrost_server.end()) {
-                matfrost_server.erase(id);
+
+
+        } else if (action == u"STOP") {
+            // Wait for an action of another thread on the session to complete.
+            auto stopped = matfrost_sessions.erase(id);
+            if (stopped) {
+                std::lock_guard<std::mutex> stop_lock(stopped->mutex);
             }
         }
         else if (action == u"CALL") {
 
             matlab::data::CellArray callstruct = input["callstruct"];
 
-            if ( matfrost_server.find(id) == matfrost_server.end()) {
-                throw(matlab::engine::MATLABException("MATFrost server not started"));
-            }
-            if (matfrost_connections.find(id) == matfrost_connections.end()) {
-                throw(matlab::engine::MATLABException("MATFrost server not connected"));
+            try {
+                const uint64_t request_id = submit(session->worker(), callstruct);
+                session->worker().await(request_id, getEngine());
+                outputs[0] = session->worker().requests->take(request_id);
+            } catch (MATFrost::Write::UnsupportedType&) {
+                // Nothing written: the connection stays usable.
+                throw;
+            } catch (MATFrost::Requests::Cancelled&) {
+                // The connection and the Julia process stay usable, see Pool::Worker::cancel.
+                throw;
+            } catch (matlab::engine::MATLABException& e) {
+                // Unrecoverable discconect and stop server
+                disconnect(id);
+                throw matlab::engine::MATLABException(e);
             }
+        }
+        else if (action == u"CALL_ASYNC") {
 
-            auto socket = matfrost_connections[id];
-            auto server = matfrost_server[id];
+            matlab::data::CellArray callstruct = input["callstruct"];
 
             matlab::data::ArrayFactory factory;
 
+            try {
+                outputs[0] = factory.createScalar<uint64_t>(submit(session->worker(), callstruct));
+            } catch (MATFrost::Write::UnsupportedType&) {
+                throw;
+            } catch (MATFrost::Requests::Cancelled&) {
+                throw;
+            } catch (matlab::engine::MATLABException& e) {
+                disconnect(id);
+                throw matlab::engine::MATLABException(e);
+            }
+        }
+        else if (action == u"MAP") {
 
-            MATFrost::Write::valid(callstruct);
+            matlab::data::CellArray callstructs = input["callstructs"];
 
             try {
-                outputs[0] = juliacall(socket, server, callstruct);
+                outputs[0] = session->pool->map(callstructs, getEngine());
+            } catch (MATFrost::Write::UnsupportedType&) {
+                throw;
+            } catch (MATFrost::Requests::Cancelled&) {
+                throw;
             } catch (matlab::engine::MATLABException& e) {
-                // Unrecoverable discconect and stop server
-                matfrost_connections.erase(id);
-                matfrost_server.erase(id);
+                disconnect(id);
                 throw matlab::engine::MATLABException(e);
             }
         }
+        else if (action == u"POLL" || action == u"WAIT" || action == u"FETCH") {
 
+            const uint64_t request_id = static_cast<const matlab::data::TypedArray<uint64_t>>(input["request"])[0];
 
-    }
-
-    matlab::data::Array juliacall(const std::shared_ptr<MATFrost::Socket::BufferedUnixDomainSocket> socket, const std::shared_ptr<MATFrost::MATFrostServer> server, const matlab::data::Array callstruct) {
+            const MATFrost::Pool::Worker &worker = session->worker();
+            if (!worker.requests->is_known(request_id)) {
+                throw matlab::engine::MATLABException("matfrostjulia:request:notFound", u"MATFrost request not found: " + matlab::engine::convertUTF8StringToUTF16String(std::to_string(request_id)));
+            }
 
-        auto matlab = getEngine();
-        server->dump_logging(matlab);
+            matlab::data::ArrayFactory factory;
 
-        matlab::data::ArrayFactory factory;
+            try {
+                if (action == u"POLL") {
+                    worker.collect();
+                    outputs[0] = factory.createScalar<bool>(worker.requests->is_completed(request_id));
+                } else {
+                    worker.await(request_id, getEngine());
+                    if (action == u"FETCH") {
+                        outputs[0] = worker.requests->take(request_id);
+                    }
+                }
+            } catch (MATFrost::Requests::Cancelled&) {
+                throw;
+            } catch (matlab::engine::MATLABException& e) {
+                disconnect(id);
+                throw matlab::engine::MATLABException(e);
+            }
+        }
+        else if (action == u"NEXT" || action == u"DONE") {
 
-        if (!socket->is_connected()) {
-            throw(matlab::engine::MATLABException("MATFrost server disconnected"));
+            // Streams of a streaming call, see Streams::ReadAhead.
+            try {
+                if (action == u"NEXT") {
+                    const uint64_t stream = static_cast<const matlab::data::TypedArray<uint64_t>>(input["stream"])[0];
+                    outputs[0] = session->streams.next(session->worker(), stream, getEngine());
+                } else {
+                    const matlab::data::TypedArray<uint64_t> streams = input["streams"];
+                    outputs[0] = session->streams.done(session->worker(), streams, getEngine());
+                }
+            } catch (MATFrost::Requests::Cancelled&) {
+                throw;
+            } catch (matlab::engine::MATLABException& e) {
+                disconnect(id);
+                throw matlab::engine::MATLABException(e);
+            }
         }
+        else if (action == u"OPEN_STREAM" || action == u"PUSH" || action == u"CLOSE_STREAM") {
 
-        MATFrost::Write::write(socket, callstruct);
-        socket->flush();
+            // Uploads, see Streams::WriteBehind.
+            const MATFrost::Pool::Worker &worker = session->worker();
+            try {
+                if (action == u"OPEN_STREAM") {
+                    matlab::data::ArrayFactory factory;
+                    matlab::data::CellArray call = factory.createCellArray({1, 1});
+                    call[0] = factory.createScalar(std::u16string(u"OPEN_STREAM"));
+                    const uint64_t request_id = worker.submit(call);
+                    worker.await(request_id, getEngine());
+                    outputs[0] = worker.requests->take(request_id);
+                } else {
+                    const uint64_t upload = static_cast<const matlab::data::TypedArray<uint64_t>>(input["upload"])[0];
+                    if (action == u"PUSH") {
+                        outputs[0] = session->uploads.push(worker, upload, input["chunk"], getEngine());
+                    } else {
+                        outputs[0] = session->uploads.close(worker, upload, getEngine());
+                    }
+                }
+            } catch (MATFrost::Write::UnsupportedType&) {
+                throw;
+            } catch (MATFrost::Requests::Cancelled&) {
+                throw;
+            } catch (matlab::engine::MATLABException& e) {
+                disconnect(id);
+                throw matlab::engine::MATLABException(e);
+            }
+        }
+        else if (action == u"LOGS") {
 
-        size_t niters = socket->timeout_ms / 100+1;
+            // Output not yet displayed, one element per worker.
+            const auto &workers = session->pool->workers;
+            matlab::data::ArrayFactory factory;
+            matlab::data::StringArray logs = factory.createArray<matlab::data::MATLABString>({1, workers.size()});
+            for (size_t w = 0; w < workers.size(); w++) {
+                logs[w] = matlab::engine::convertUTF8StringToUTF16String(workers[w].server->take_logging());
+            }
+            outputs[0] = logs;
+        }
+        else if (action == u"STATS") {
 
-        timeval timeout{0, 100000}; // 100ms
+            std::vector<const MATFrost::Stats::Statistics*> stats{};
+            for (const auto &w : session->pool->workers) {
+                stats.push_back(&w.socket->stats);
+            }
+            outputs[0] = MATFrost::Stats::to_struct(stats);
+        }
+        else if (action == u"RESET_STATS") {
 
-        for (size_t i = 0; i < niters; i++) {
-            if (socket->wait_for_readable(timeout)) {
-                // Data available to read
-                auto jlout = MATFrost::Read::read(socket);
+            for (const auto &w : session->pool->workers) {
+                w.socket->stats = MATFrost::Stats::Statistics{};
+            }
+        }
 
-                server->dump_logging(matlab);
 
-                return jlout;
-            } else {
-                server->dump_logging(matlab);
+    }
 
-                matlab->feval(u"pause", 0, std::vector<matlab::data::Array>
-                    ({ factory.createScalar(0.0)})); // No-operation added to be able interrupt.
-            }
+    std::shared_ptr<MATFrost::Sessions::Session> connected(const uint64_t id) {
+        auto session = matfrost_sessions.find(id);
+        if (!session) {
+            throw(matlab::engine::MATLABException("MATFrost server not started"));
         }
+        return session;
+    }
 
-        throw(matlab::engine::MATLABException("MATFrost server timeout"));
-
+    /**
+     * Remove the session, it is stopped once the action holding it completes.
+     */
+    void disconnect(const uint64_t id) {
+        matfrost_sessions.erase(id);
     }
 
+    /**
+     * Write the call to Julia without waiting for the response. Returns the request ID of the call.
+     */
+    uint64_t submit(const MATFrost::Pool::Worker &w, const matlab::data::Array callstruct) {
+        auto matlab = getEngine();
+
+        w.server->dump_logging(matlab);
 
+        const matlab::data::Array call = w.resolve(callstruct, matlab);
+
+        // Validation and sizing in a single pass, before any byte of the call is written. Throws
+        // Write::UnsupportedType.
+        const MATFrost::Write::Layout layout = MATFrost::Write::measure(call);
+
+        // Calls are pipelined: no need to wait for earlier responses. Responses arriving while the socket is full are
+        // kept in the socket backlog, see BufferedUnixDomainSocket::wait_for_writable_draining.
+        return w.submit(call, layout);
+    }
 
 };
 
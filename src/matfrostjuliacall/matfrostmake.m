@@ -13,19 +13,17 @@ if ispc
     mex("-setup:" + fullfile(matlabroot(), "bin", "win64", "mexopts","mingw64_g++.xml"), "C++")
     % mex('-setup', 'c++')
     mex('-v', ...
+        'CXXFLAGS=$CXXFLAGS -std=c++17', ...
         '-lws2_32',...
         '-output', fullfile(fileparts(mfilename('fullpath')), "bin", mjlname + ".mexw64"), ...
         fullfile(fileparts(mfilename('fullpath')), 'matfrostjuliacall.cpp'));
-% elseif isunix
-%     dir(fullfile(matlabroot(), "/sys/os/glnxa64/orig"))
-%     mex('-v', ...
-%         strcat('-I"', fullfile(julia_dir, 'include', 'julia'), '"'), ...
-%         strcat('"',   fullfile(julia_dir, 'lib', 'libjulia.so'), '"'), ...
-%         strcat('"', fullfile(matlabroot(), "/sys/os/glnxa64/orig/libstdc++.so.6"), '"'), ...
-%         '-output', fullfile(mexdir, mjlname + ".mexa64"), ...
-%         fullfile(fileparts(fileparts(fileparts(mfilename('fullpath')))), 'matfrostjuliacall', 'matfrostjuliacall.cpp'));
-%     
-%     dir(fullfile(mexdir, mjlname + ".mexa64"))
+elseif isunix && ~ismac
+    % POSIX backend: posix_spawn, AF_UNIX sockets and shm_open (librt on older glibc).
+    mex('-v', ...
+        'CXXFLAGS=$CXXFLAGS -std=c++17', ...
+        '-lrt', ...
+        '-output', fullfile(fileparts(mfilename('fullpath')), "bin", mjlname + ".mexa64"), ...
+        fullfile(fileparts(mfilename('fullpath')), 'matfrostjuliacall.cpp'));
 else
     error("Not supported yet!")
 end
@@ -0,0 +1,109 @@
+/**
+ * Serialization plans of repeated message layouts.
+ *
+ * The layout of a message is everything but its primitive payloads: types, dimensions, struct field names and
+ * strings. A call repeated with arguments of the same types and dimensions has the same layout. The second message
+ * with a layout defines a plan: it is sent in full, tagged PLAN, and Julia keeps its structure as a template. Later
+ * messages with the layout are tagged PLAN_REFERENCE and send only the plan ID followed by the payloads, in the order
+ * of Plan::payloads. Julia fills a copy of the template with them.
+ *
+ * Plans live as long as the connection and are never evicted: the number of plans is bounded, once full messages are
+ * sent in full. Free of MATLAB dependencies.
+ */
+#ifndef MATFROST_JL_PLAN_HPP
+#define MATFROST_JL_PLAN_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace MATFrost::Plans {
+
+    // Larger layouts are sent in full, appending to a layout stops beyond this size.
+    constexpr size_t MAX_LAYOUT_NBYTES = 1 << 16;
+
+    /**
+     * Payload of a primitive array in a message sent by plan. Logical payloads may be sent bit-packed.
+     */
+    struct Payload {
+        const void* data;
+        size_t nbytes;
+        bool logical = false;
+    };
+
+    /**
+     * Layout of a message and its payloads, depth first: cells in element order, structs element by element with the
+     * values of every element in field order.
+     */
+    struct Plan {
+        std::string layout{};
+        std::vector<Payload> payloads{};
+
+        template<typename T>
+        void append(const T &v) {
+            append(&v, sizeof(T));
+        }
+
+        void append(const void* data, const size_t nb) {
+            if (layout.size() <= MAX_LAYOUT_NBYTES) {
+                layout.append(static_cast<const char*>(data), nb);
+            }
+        }
+    };
+
+    enum class Use {
+        NONE,       // Sent in full.
+        DEFINE,     // Sent in full, Julia keeps the structure as the next plan.
+        REFERENCE   // Sent as plan ID and payloads.
+    };
+
+    class Registry {
+        std::unordered_map<std::string, uint64_t> plans{};
+
+        // Layouts sent once, a layout becomes a plan when sent again.
+        std::unordered_set<std::string> seen{};
+
+    public:
+        static constexpr size_t MAX_PLANS = 256;
+        static constexpr size_t MAX_SEEN = 1024;
+
+        bool enabled = true;
+
+        /**
+         * Encoding of a message with the layout. id is set for DEFINE and REFERENCE.
+         */
+        Use use(const std::string &layout, uint64_t &id) {
+            if (!enabled || layout.size() > MAX_LAYOUT_NBYTES) {
+                return Use::NONE;
+            }
+            auto it = plans.find(layout);
+            if (it != plans.end()) {
+                id = it->second;
+                return Use::REFERENCE;
+            }
+            if (plans.size() >= MAX_PLANS) {
+                return Use::NONE;
+            }
+            if (seen.find(layout) == seen.end()) {
+                if (seen.size() >= MAX_SEEN) {
+                    seen.clear();
+                }
+                seen.insert(layout);
+                return Use::NONE;
+            }
+            seen.erase(layout);
+            id = plans.size();
+            plans.emplace(layout, id);
+            return Use::DEFINE;
+        }
+
+        size_t size() const {
+            return plans.size();
+        }
+    };
+
+}
+
+#endif //MATFROST_JL_PLAN_HPP
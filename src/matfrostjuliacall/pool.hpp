@@ -0,0 +1,377 @@
+/**
+ * Pool of Julia worker processes for scatter/gather of independent calls.
+ *
+ * Every worker is a regular MATFrost server with its own connection. A MAP distributes a cell array of calls over the
+ * workers: each worker holds a small window of outstanding calls and takes the next item from the shared queue as soon
+ * as one of its calls completes. Fast workers therefore process more items, slow workers are not waited upon.
+ */
+#ifndef MATFROST_JL_POOL_HPP
+#define MATFROST_JL_POOL_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace MATFrost::Pool {
+
+    struct Worker {
+        std::shared_ptr<MATFrostServer> server;
+        std::shared_ptr<Socket::BufferedUnixDomainSocket> socket;
+        std::shared_ptr<Requests::PendingRequests> requests;
+        std::shared_ptr<Functions::FunctionTable> functions;
+
+        /**
+         * Write the call to Julia without waiting for the response. Returns the request ID of the call.
+         */
+        uint64_t submit(const matlab::data::Array &callstruct) const {
+            return submit(callstruct, Write::measure(callstruct));
+        }
+
+        /**
+         * Write the call, laid out by Write::measure, to Julia without waiting for the response.
+         */
+        uint64_t submit(const matlab::data::Array &callstruct, const Write::Layout &layout) const {
+            if (!socket->is_connected()) {
+                throw(matlab::engine::MATLABException("MATFrost server disconnected"));
+            }
+            const uint64_t request_id = requests->issue();
+
+            // Time blocked on the socket is send, including responses drained while the socket is full.
+            auto &stats = socket->stats;
+            const uint64_t socket_ns = stats.send_ns + stats.receive_ns;
+            const uint64_t start = Stats::now_ns();
+            Write::write_message(socket, request_id, callstruct, layout);
+            socket->flush();
+            const uint64_t total = Stats::now_ns() - start;
+            const uint64_t send = stats.send_ns + stats.receive_ns - socket_ns;
+
+            stats.record(Stats::SEND, send);
+            stats.record(Stats::SERIALIZE, total - std::min(send, total));
+            stats.requests++;
+            return request_id;
+        }
+
+        /**
+         * Read a single response and complete its request. Returns the time spent in nanoseconds.
+         */
+        uint64_t receive() const {
+            auto &stats = socket->stats;
+            const uint64_t receive_ns = stats.receive_ns;
+            const uint64_t start = Stats::now_ns();
+            auto msg = Read::read_message(socket);
+            const uint64_t total = Stats::now_ns() - start;
+            const uint64_t receive = stats.receive_ns - receive_ns;
+
+            stats.record(Stats::RECEIVE, receive);
+            stats.record(Stats::DESERIALIZE, total - std::min(receive, total));
+            stats.responses++;
+
+            requests->complete(msg.request_id, msg.value);
+            return total;
+        }
+
+        /**
+         * Read all responses that are available without waiting.
+         */
+        void collect() const {
+            timeval immediate{0, 0};
+
+            while (socket->has_buffered_input() || socket->wait_for_readable(immediate)) {
+                receive();
+            }
+        }
+
+        /**
+         * Read responses until the response of request_id is received. Responses to other requests read meanwhile are
+         * parked, they do not count towards the timeout: the call is cancelled once timeout_ms have elapsed.
+         */
+        void await(const uint64_t request_id, std::shared_ptr<matlab::engine::MATLABEngine> matlab) const {
+            server->dump_logging(matlab);
+
+            matlab::data::ArrayFactory factory;
+
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(socket->timeout_ms);
+
+            // Wait: time until the response arrives, excluding reading of responses.
+            const uint64_t start = Stats::now_ns();
+            uint64_t received = 0;
+            bool waited = false;
+            auto record_wait = [&]() {
+                socket->stats.record(Stats::WAIT, Stats::now_ns() - start - received);
+            };
+
+            while (true) {
+                if (requests->is_completed(request_id)) {
+                    if (waited) {
+                        record_wait();
+                    }
+                    return;
+                }
+                const auto now = std::chrono::steady_clock::now();
+                if (now >= deadline) {
+                    break;
+                }
+                waited = true;
+
+                // At most 100ms, such that MATLAB can interrupt.
+                const auto remaining = std::min<std::chrono::microseconds>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(deadline - now), std::chrono::milliseconds(100));
+                timeval timeout{0, static_cast<decltype(timeval::tv_usec)>(remaining.count())};
+
+                if (socket->has_buffered_input() || socket->wait_for_readable(timeout)) {
+                    // Data available to read
+                    received += receive();
+
+                    server->dump_logging(matlab);
+                } else {
+                    server->dump_logging(matlab);
+
+                    try {
+                        matlab->feval(u"pause", 0, std::vector<matlab::data::Array>
+                            ({ factory.createScalar(0.0)})); // No-operation added to be able interrupt.
+                    } catch (matlab::engine::MATLABException&) {
+                        // Interrupted, e.g. Ctrl-C. The socket is at a message boundary.
+                        cancel({request_id});
+                        throw Requests::Cancelled("matfrostjulia:call:cancelled", u"MATFrost call cancelled");
+                    }
+                }
+            }
+
+            cancel({request_id});
+            throw Requests::Cancelled("matfrostjulia:call:timeout", u"MATFrost server timeout, call cancelled");
+        }
+
+        /**
+         * Abandon the calls of request_ids, keeping the connection and the Julia process with everything it loaded
+         * and compiled. Their responses are dropped when read. Other calls in flight, e.g. of CALL_ASYNC, are kept and
+         * collected as usual. If Julia is running one of the abandoned calls, it is interrupted (not on Windows, there
+         * it runs to completion) and a CANCEL marker follows. Abandoned calls Julia has not started yet still run.
+         */
+        void cancel(const std::vector<uint64_t> &request_ids) const {
+            if (request_ids.empty()) {
+                return;
+            }
+            const bool running = requests->is_first_in_flight(*std::min_element(request_ids.begin(), request_ids.end()));
+            for (const uint64_t request_id : request_ids) {
+                requests->cancel(request_id);
+            }
+            if (!running || !server->interrupt()) {
+                return;
+            }
+
+            matlab::data::ArrayFactory factory;
+            matlab::data::CellArray marker = factory.createCellArray({2, 1});
+            marker[0] = factory.createScalar(std::u16string(u"CANCEL"));
+            marker[1] = factory.createScalar<uint64_t>(1);
+            requests->cancel(submit(marker));
+        }
+
+        /**
+         * Replace the callmeta of a {callmeta; args} or {callmeta; args; "HANDLE"} call by its function ID. The
+         * function is resolved by Julia on first use, which costs one round trip. Calls that cannot be resolved are
+         * returned unchanged, such that Julia reports the error as the result of the call itself.
+         */
+        matlab::data::Array resolve(const matlab::data::Array &callstruct, std::shared_ptr<matlab::engine::MATLABEngine> matlab) const {
+            if (callstruct.getType() != matlab::data::ArrayType::CELL || callstruct.getNumberOfElements() < 2 || callstruct.getNumberOfElements() > 3) {
+                return callstruct;
+            }
+            const matlab::data::CellArray call(callstruct);
+            const matlab::data::Array callmeta = call[0];
+            if (callmeta.getType() != matlab::data::ArrayType::STRUCT || callmeta.getNumberOfElements() != 1) {
+                return callstruct;
+            }
+
+            const std::u16string key = Functions::FunctionTable::key(matlab::data::StructArray(callmeta));
+
+            int64_t function_id;
+            if (!functions->find(key, function_id)) {
+                matlab::data::ArrayFactory factory;
+                matlab::data::CellArray resolvestruct = factory.createCellArray({1, 1});
+                resolvestruct[0] = callmeta;
+
+                const uint64_t request_id = submit(resolvestruct);
+                await(request_id, matlab);
+                if (!Functions::FunctionTable::resolved_id(requests->take(request_id), function_id)) {
+                    return callstruct;
+                }
+                functions->insert(key, function_id);
+            }
+
+            matlab::data::ArrayFactory factory;
+            matlab::data::CellArray resolved = factory.createCellArray({call.getNumberOfElements(), 1});
+            resolved[0] = factory.createScalar<int64_t>(function_id);
+            for (size_t i = 1; i < call.getNumberOfElements(); i++) {
+                resolved[i] = call[i];
+            }
+            return resolved;
+        }
+
+        /**
+         * Function ID of a call returned by resolve, 0 if the call is sent unresolved.
+         */
+        static int64_t function_id(const matlab::data::Array &call) {
+            if (call.getType() != matlab::data::ArrayType::CELL || call.getNumberOfElements() == 0) {
+                return 0;
+            }
+            const matlab::data::Array head = matlab::data::CellArray(call)[0];
+            if (head.getType() != matlab::data::ArrayType::INT64 || head.getNumberOfElements() != 1) {
+                return 0;
+            }
+            return static_cast<const matlab::data::TypedArray<int64_t>>(head)[0];
+        }
+    };
+
+    class WorkerPool {
+    public:
+        /**
+         * Number of calls kept outstanding per worker. Larger than 1 such that a worker does not idle while its next
+         * call is on the way.
+         */
+        static constexpr size_t WINDOW = 2;
+
+        const std::vector<Worker> workers;
+
+        explicit WorkerPool(std::vector<Worker> workers) : workers(std::move(workers)) {}
+
+        /**
+         * Perform all calls and return the results in a cell array of the same dimensions. Responses to calls not
+         * part of this map, e.g. outstanding asynchronous calls, are parked in the pending requests of the worker.
+         */
+        matlab::data::CellArray map(const matlab::data::CellArray &callstructs, std::shared_ptr<matlab::engine::MATLABEngine> matlab) const {
+            matlab::data::ArrayFactory factory;
+
+            const size_t n = callstructs.getNumberOfElements();
+            matlab::data::CellArray results = factory.createCellArray(callstructs.getDimensions());
+
+            std::vector<std::shared_ptr<Socket::BufferedUnixDomainSocket>> sockets{};
+            for (const auto &worker: workers) {
+                sockets.push_back(worker.socket);
+            }
+
+            // Every worker resolves the functions before the first call is sent. A RESOLVE waits for its response: a
+            // cancel meanwhile leaves no call of the map outstanding, and dispatching never waits.
+            std::vector<std::vector<matlab::data::Array>> calls(workers.size());
+            for (size_t w = 0; w < workers.size(); w++) {
+                calls[w].reserve(n);
+                for (size_t i = 0; i < n; i++) {
+                    calls[w].push_back(workers[w].resolve(callstructs[i], matlab));
+                }
+            }
+
+            // Every call is validated and laid out in a single pass before the first is sent: an unsupported value
+            // throws Write::UnsupportedType with no call of the map written. A worker resolving a function to the same
+            // ID as the first worker shares its calls and layouts, otherwise its calls are laid out of their own.
+            std::vector<Write::Layout> layouts{};
+            layouts.reserve(n);
+            for (size_t i = 0; i < n; i++) {
+                layouts.push_back(Write::measure(calls[0][i]));
+            }
+            // Per worker: item index -> layout of a call differing from the call of the first worker.
+            std::vector<std::map<size_t, Write::Layout>> own_layouts(workers.size());
+            for (size_t w = 1; w < workers.size(); w++) {
+                for (size_t i = 0; i < n; i++) {
+                    if (Worker::function_id(calls[w][i]) == Worker::function_id(calls[0][i])) {
+                        calls[w][i] = calls[0][i];
+                    } else {
+                        own_layouts[w].emplace(i, Write::measure(calls[w][i]));
+                    }
+                }
+            }
+
+            // Per worker: request ID -> item index.
+            std::vector<std::map<uint64_t, size_t>> assigned(workers.size());
+
+            size_t next = 0;
+            size_t completed = 0;
+
+            // Gather the completed calls of the worker and hand it new ones. Responses drained while the socket is full
+            // are parked in its pending requests: repeat until none are left.
+            auto dispatch = [&](const size_t w) {
+                bool progress = true;
+                while (progress) {
+                    progress = false;
+                    for (auto it = assigned[w].begin(); it != assigned[w].end();) {
+                        if (workers[w].requests->is_completed(it->first)) {
+                            results[it->second] = workers[w].requests->take(it->first);
+                            it = assigned[w].erase(it);
+                            completed++;
+                            progress = true;
+                        } else {
+                            ++it;
+                        }
+                    }
+                    while (next < n && assigned[w].size() < WINDOW) {
+                        const auto own = own_layouts[w].find(next);
+                        const Write::Layout &layout = own == own_layouts[w].end() ? layouts[next] : own->second;
+                        assigned[w].emplace(workers[w].submit(calls[w][next], layout), next);
+                        next++;
+                    }
+                }
+            };
+
+            for (size_t w = 0; w < workers.size(); w++) {
+                dispatch(w);
+            }
+
+            // Timeout counts from the last response received.
+            const size_t niters = workers[0].socket->timeout_ms / 100 + 1;
+            timeval timeout{0, 100000}; // 100ms
+            size_t idle = 0;
+
+            while (completed < n) {
+                const uint64_t start = Stats::now_ns();
+                const int w = Socket::BufferedUnixDomainSocket::wait_for_any_readable(sockets, timeout);
+
+                if (w < 0) {
+                    dump_logging(matlab);
+                    if (++idle >= niters) {
+                        cancel(assigned);
+                        throw Requests::Cancelled("matfrostjulia:call:timeout", u"MATFrost server timeout, map cancelled");
+                    }
+                    try {
+                        matlab->feval(u"pause", 0, std::vector<matlab::data::Array>
+                            ({ factory.createScalar(0.0)})); // No-operation added to be able interrupt.
+                    } catch (matlab::engine::MATLABException&) {
+                        cancel(assigned);
+                        throw Requests::Cancelled("matfrostjulia:call:cancelled", u"MATFrost map cancelled");
+                    }
+                    continue;
+                }
+                idle = 0;
+
+                workers[w].socket->stats.record(Stats::WAIT, Stats::now_ns() - start);
+                workers[w].receive();
+                dispatch(w);
+            }
+
+            dump_logging(matlab);
+
+            return results;
+        }
+
+        /**
+         * Cancel the outstanding calls of a map on every worker, see Worker::cancel.
+         */
+        void cancel(const std::vector<std::map<uint64_t, size_t>> &assigned) const {
+            for (size_t w = 0; w < workers.size(); w++) {
+                std::vector<uint64_t> request_ids{};
+                for (const auto &entry : assigned[w]) {
+                    request_ids.push_back(entry.first);
+                }
+                workers[w].cancel(request_ids);
+            }
+        }
+
+        void dump_logging(std::shared_ptr<matlab::engine::MATLABEngine> matlab) const {
+            for (const auto &worker: workers) {
+                worker.server->dump_logging(matlab);
+            }
+        }
+    };
+
+}
+
+#endif //MATFROST_JL_POOL_HPP
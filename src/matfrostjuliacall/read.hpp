@@ -6,14 +6,21 @@
 #include <string>
 #include <complex>
 #include <memory>
+#include <vector>
+
+#include "encoding.hpp"
+#include "utf.hpp"
+#include "bits.hpp"
 
 
 namespace MATFrost::Read {
 
     matlab::data::Array read(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket);
 
+    matlab::data::Array read_value(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, matlab::data::ArrayType type, const matlab::data::ArrayDimensions &dims, const int32_t encoding);
+
     template<typename T>
-    matlab::data::Array read_primitive(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, matlab::data::ArrayDimensions dims) {
+    matlab::data::Array read_primitive(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, matlab::data::ArrayDimensions dims, const int32_t encoding) {
         size_t nel = 1;
         for (const auto dim : dims){
             nel *= dim;
@@ -22,52 +29,180 @@ namespace MATFrost::Read {
         matlab::data::ArrayFactory factory;
         matlab::data::buffer_ptr_t<T> buf = factory.createBuffer<T>(nel);
 
-        socket->read(reinterpret_cast<uint8_t *>(buf.get()), sizeof(T)*nel);
+        if (encoding == Encoding::SHARED_MEMORY && socket->shared_memory) {
+            socket->shared_memory->read(reinterpret_cast<uint8_t *>(buf.get()), sizeof(T)*nel);
+            socket->stats.shared_memory_bytes_received += sizeof(T)*nel;
+        } else {
+            socket->read(reinterpret_cast<uint8_t *>(buf.get()), sizeof(T)*nel);
+        }
 
         return factory.createArrayFromBuffer<T>(dims, std::move(buf));
 
     }
 
-    matlab::data::Array read_string(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, matlab::data::ArrayDimensions dims) {
+    /**
+     * Logical array sent BIT_PACKED, see Write::write_bits. Unpacked a block at a time into the MATLAB buffer.
+     */
+    matlab::data::Array read_bits(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, matlab::data::ArrayDimensions dims) {
         size_t nel = 1;
         for (const auto dim : dims){
             nel *= dim;
         }
 
+        matlab::data::ArrayFactory factory;
+        matlab::data::buffer_ptr_t<bool> buf = factory.createBuffer<bool>(nel);
+
+        uint8_t block[Bits::BLOCK_ELEMENTS / 8];
+        for (size_t i = 0; i < nel; i += Bits::BLOCK_ELEMENTS) {
+            const size_t n = std::min(Bits::BLOCK_ELEMENTS, nel - i);
+            socket->read(block, Bits::packed_nbytes(n));
+            Bits::unpack(block, n, buf.get() + i);
+        }
+
+        return factory.createArrayFromBuffer<bool>(dims, std::move(buf));
+    }
+
+    /**
+     * Sparse matrix in compressed-column form, see Write::write_sparse. The one-based column pointers and row indices
+     * are expanded to the zero-based coordinates of every nonzero taken by createSparseArray.
+     */
+    template<typename T>
+    matlab::data::Array read_sparse(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, matlab::data::ArrayDimensions dims) {
+        if (dims.size() != 2) {
+            throw matlab::engine::MATLABException("MATFrost received sparse matrix with " + std::to_string(dims.size()) + " dimensions");
+        }
+        uint64_t nnz;
+        socket->read(reinterpret_cast<uint8_t *>(&nnz), sizeof(uint64_t));
+
+        std::vector<uint64_t> colptr(dims[1] + 1);
+        socket->read(reinterpret_cast<uint8_t *>(colptr.data()), sizeof(uint64_t)*colptr.size());
+
+        matlab::data::ArrayFactory factory;
+        matlab::data::buffer_ptr_t<size_t> rows = factory.createBuffer<size_t>(nnz);
+        matlab::data::buffer_ptr_t<size_t> cols = factory.createBuffer<size_t>(nnz);
+        matlab::data::buffer_ptr_t<T> data = factory.createBuffer<T>(nnz);
+
+        socket->read(reinterpret_cast<uint8_t *>(rows.get()), sizeof(size_t)*nnz);
+        socket->read(reinterpret_cast<uint8_t *>(data.get()), sizeof(T)*nnz);
+
+        if (colptr[0] != 1 || colptr[dims[1]] != nnz + 1) {
+            throw matlab::engine::MATLABException("MATFrost received malformed sparse matrix");
+        }
+        for (size_t i = 0; i < nnz; i++) {
+            rows[i]--;
+        }
+        for (size_t c = 0; c < dims[1]; c++) {
+            if (colptr[c + 1] < colptr[c]) {
+                throw matlab::engine::MATLABException("MATFrost received malformed sparse matrix");
+            }
+            for (uint64_t i = colptr[c] - 1; i < colptr[c + 1] - 1; i++) {
+                cols[i] = c;
+            }
+        }
+
+        return factory.createSparseArray<T>(dims, nnz, std::move(data), std::move(rows), std::move(cols));
+    }
+
+    /**
+     * String array, see Write::write_string: every string as [nbytes][UTF-8], or PACKED as an offsets table followed
+     * by all strings back to back.
+     */
+    matlab::data::Array read_string(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, matlab::data::ArrayDimensions dims, const int32_t encoding) {
         matlab::data::ArrayFactory factory;
 
         matlab::data::StringArray strarr = factory.createArray<matlab::data::MATLABString>(dims);
+        const size_t nel = strarr.getNumberOfElements();
+
+        if (!(encoding & Encoding::PACKED)) {
+            std::string str{};
+            for (auto e : strarr) {
+                size_t strbytes;
+                socket->read(reinterpret_cast<uint8_t *>(&strbytes), sizeof(size_t));
+                str.resize(strbytes);
+                socket->read(reinterpret_cast<uint8_t *>(&str[0]), strbytes);
+                e = Utf::to_utf16(str.data(), strbytes);
+            }
+            return strarr;
+        }
+
+        std::vector<uint64_t> offsets(nel + 1);
+        socket->read(reinterpret_cast<uint8_t *>(offsets.data()), sizeof(uint64_t)*offsets.size());
+        for (size_t i = 0; i < nel; i++) {
+            if (offsets[0] != 0 || offsets[i + 1] < offsets[i]) {
+                throw matlab::engine::MATLABException("MATFrost received malformed string array");
+            }
+        }
+
+        std::unique_ptr<char[]> blob(new char[offsets[nel]]);
+        socket->read(reinterpret_cast<uint8_t *>(blob.get()), offsets[nel]);
 
+        size_t i = 0;
         for (auto e : strarr) {
-            size_t strbytes;
+            e = Utf::to_utf16(blob.get() + offsets[i], offsets[i + 1] - offsets[i]);
+            i++;
+        }
+        return strarr;
+    }
 
-            socket->read(reinterpret_cast<uint8_t *>(&strbytes), sizeof(size_t));
+    /**
+     * Elements of a column, see Write::write_column: the elements of a cell array or the values of a single struct
+     * field. The header of the column itself has been read, assign is called with every element in order.
+     */
+    template<typename Assign>
+    void read_column(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const int32_t encoding, const size_t nel, Assign assign) {
+        if (!(encoding & Encoding::COLUMNAR)) {
+            for (size_t i = 0; i < nel; i++) {
+                assign(read(socket));
+            }
+            return;
+        }
 
-            auto strdata = std::vector<uint8_t>(strbytes);
+        // Columnar: a single header for all elements followed by their payloads.
+        int32_t type;
+        size_t ndims;
+        socket->read(reinterpret_cast<uint8_t *>(&type), sizeof(int32_t));
+        socket->read(reinterpret_cast<uint8_t *>(&ndims), sizeof(size_t));
+        matlab::data::ArrayDimensions dims(ndims);
+        socket->read(reinterpret_cast<uint8_t *>(dims.data()), sizeof(size_t)*ndims);
 
-            socket->read(strdata.data(), strbytes);
-            e = matlab::engine::convertUTF8StringToUTF16String(std::string(reinterpret_cast<char*>(strdata.data()), strbytes));
+        if (Encoding::element_size(Encoding::array_type(type)) == 0) {
+            throw matlab::engine::MATLABException("MATFrost received columnar cell array of non-primitive type: " + std::to_string(type));
+        }
 
+        for (size_t i = 0; i < nel; i++) {
+            assign(read_value(socket, Encoding::array_type(type), dims, Encoding::encoding(type)));
         }
-        return strarr;
     }
 
-    matlab::data::Array read_cell(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, matlab::data::ArrayDimensions dims) {
+    matlab::data::Array read_cell(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, matlab::data::ArrayDimensions dims, const int32_t encoding) {
         matlab::data::ArrayFactory factory;
 
         matlab::data::CellArray carr = factory.createCellArray(dims);
 
-        for (auto e : carr) {
-            e = read(socket);
-        }
+        auto e = carr.begin();
+        read_column(socket, encoding, carr.getNumberOfElements(), [&](matlab::data::Array value) {
+            *e = std::move(value);
+            ++e;
+        });
         return carr;
     }
 
-    matlab::data::Array read_struct(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, matlab::data::ArrayDimensions dims) {
-        size_t nel = 1;
-        for (const auto dim : dims){
-            nel *= dim;
+    /**
+     * Field names of a struct: in full for the first struct with these field names, otherwise a reference to an earlier
+     * struct in the message. See Encoding::Schemas.
+     */
+    const std::vector<std::string>& read_schema(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const int32_t encoding) {
+        auto &schemas = socket->schemas.read;
+
+        if (encoding & Encoding::SCHEMA_REFERENCE) {
+            uint64_t schema;
+            socket->read(reinterpret_cast<uint8_t *>(&schema), sizeof(uint64_t));
+            if (schema >= schemas.size()) {
+                throw matlab::engine::MATLABException("MATFrost received reference to unknown struct schema: " + std::to_string(schema));
+            }
+            return schemas[schema];
         }
+
         size_t nfields;
 
         socket->read(reinterpret_cast<uint8_t *>(&nfields), sizeof(size_t));
@@ -78,18 +213,46 @@ namespace MATFrost::Read {
 
             socket->read(reinterpret_cast<uint8_t *>(&strbytes), sizeof(size_t));
 
-            auto strdata = std::vector<uint8_t>(strbytes);
+            fieldnames[i].resize(strbytes);
+            socket->read(reinterpret_cast<uint8_t *>(fieldnames[i].data()), strbytes);
+        }
 
-            socket->read(strdata.data(), strbytes);
+        schemas.push_back(std::move(fieldnames));
+        return schemas.back();
+    }
 
-            fieldnames[i] = std::string(reinterpret_cast<char*>(strdata.data()), strbytes);
-        }
+    matlab::data::Array read_struct(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, matlab::data::ArrayDimensions dims, const int32_t encoding) {
+        const std::vector<std::string> &fieldnames = read_schema(socket, encoding);
+        const size_t nfields = fieldnames.size();
 
         matlab::data::ArrayFactory factory;
 
 
         matlab::data::StructArray matstruct = factory.createStructArray(dims, fieldnames);
 
+        if (encoding & Encoding::COLUMNAR) {
+            // Field by field, every field a column with the values of all elements.
+            for (size_t fi = 0; fi < nfields; fi++){
+                int32_t type;
+                size_t ndims;
+                socket->read(reinterpret_cast<uint8_t *>(&type), sizeof(int32_t));
+                socket->read(reinterpret_cast<uint8_t *>(&ndims), sizeof(size_t));
+                matlab::data::ArrayDimensions coldims(ndims);
+                socket->read(reinterpret_cast<uint8_t *>(coldims.data()), sizeof(size_t)*ndims);
+
+                if (Encoding::array_type(type) != matlab::data::ArrayType::CELL || coldims != dims) {
+                    throw matlab::engine::MATLABException("MATFrost received malformed column of struct field: " + fieldnames[fi]);
+                }
+
+                auto e = matstruct.begin();
+                read_column(socket, Encoding::encoding(type), matstruct.getNumberOfElements(), [&](matlab::data::Array value) {
+                    (*e)[fieldnames[fi]] = std::move(value);
+                    ++e;
+                });
+            }
+            return matstruct;
+        }
+
         for (auto e : matstruct) {
             for (size_t fi = 0; fi < nfields; fi++){
                 e[fieldnames[fi]] = read(socket);
@@ -108,59 +271,73 @@ matlab::data::Array read(const std::shared_ptr<Socket::BufferedUnixDomainSocket>
     matlab::data::ArrayDimensions dims(ndims);
     socket->read(reinterpret_cast<uint8_t *>(dims.data()), sizeof(size_t)*ndims);
 
-    switch (static_cast<matlab::data::ArrayType>(type)) {
+    return read_value(socket, Encoding::array_type(type), dims, Encoding::encoding(type));
+}
+
+matlab::data::Array read_value(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, matlab::data::ArrayType type, const matlab::data::ArrayDimensions &dims, const int32_t encoding){
+    switch (type) {
         case matlab::data::ArrayType::CELL:
-             return read_cell(socket, dims);
+             return read_cell(socket, dims, encoding);
         case matlab::data::ArrayType::STRUCT:
-            return read_struct(socket, dims);
+            return read_struct(socket, dims, encoding);
         case matlab::data::ArrayType::MATLAB_STRING:
-             return read_string(socket, dims);
+             return read_string(socket, dims, encoding);
         case matlab::data::ArrayType::LOGICAL:
-            return read_primitive<bool>(socket, dims);
+            if (encoding & Encoding::BIT_PACKED) {
+                return read_bits(socket, dims);
+            }
+            return read_primitive<bool>(socket, dims, encoding);
 
         case matlab::data::ArrayType::SINGLE:
-            return read_primitive<float>(socket, dims);
+            return read_primitive<float>(socket, dims, encoding);
         case matlab::data::ArrayType::DOUBLE:
-            return read_primitive<double>(socket, dims);
+            return read_primitive<double>(socket, dims, encoding);
 
         case matlab::data::ArrayType::INT8:
-            return read_primitive<int8_t>(socket, dims);
+            return read_primitive<int8_t>(socket, dims, encoding);
         case matlab::data::ArrayType::UINT8:
-            return read_primitive<uint8_t>(socket, dims);
+            return read_primitive<uint8_t>(socket, dims, encoding);
         case matlab::data::ArrayType::INT16:
-            return read_primitive<int16_t>(socket, dims);
+            return read_primitive<int16_t>(socket, dims, encoding);
         case matlab::data::ArrayType::UINT16:
-            return read_primitive<uint16_t>(socket, dims);
+            return read_primitive<uint16_t>(socket, dims, encoding);
         case matlab::data::ArrayType::INT32:
-            return read_primitive<int32_t>(socket, dims);
+            return read_primitive<int32_t>(socket, dims, encoding);
         case matlab::data::ArrayType::UINT32:
-            return read_primitive<uint32_t>(socket, dims);
+            return read_primitive<uint32_t>(socket, dims, encoding);
         case matlab::data::ArrayType::INT64:
-            return read_primitive<int64_t>(socket, dims);
+            return read_primitive<int64_t>(socket, dims, encoding);
         case matlab::data::ArrayType::UINT64:
-            return read_primitive<uint64_t>(socket, dims);
+            return read_primitive<uint64_t>(socket, dims, encoding);
 
         case matlab::data::ArrayType::COMPLEX_SINGLE:
-            return read_primitive<std::complex<float>>(socket, dims);
+            return read_primitive<std::complex<float>>(socket, dims, encoding);
         case matlab::data::ArrayType::COMPLEX_DOUBLE:
-            return read_primitive<std::complex<double>>(socket, dims);
+            return read_primitive<std::complex<double>>(socket, dims, encoding);
 
         case matlab::data::ArrayType::COMPLEX_UINT8:
-            return read_primitive<std::complex<uint8_t>>(socket, dims);
+            return read_primitive<std::complex<uint8_t>>(socket, dims, encoding);
         case matlab::data::ArrayType::COMPLEX_INT8:
-            return read_primitive<std::complex<int8_t>>(socket, dims);
+            return read_primitive<std::complex<int8_t>>(socket, dims, encoding);
         case matlab::data::ArrayType::COMPLEX_UINT16:
-            return read_primitive<std::complex<uint16_t>>(socket, dims);
+            return read_primitive<std::complex<uint16_t>>(socket, dims, encoding);
         case matlab::data::ArrayType::COMPLEX_INT16:
-            return read_primitive<std::complex<int16_t>>(socket, dims);
+            return read_primitive<std::complex<int16_t>>(socket, dims, encoding);
         case matlab::data::ArrayType::COMPLEX_UINT32:
-            return read_primitive<std::complex<uint32_t>>(socket, dims);
+            return read_primitive<std::complex<uint32_t>>(socket, dims, encoding);
         case matlab::data::ArrayType::COMPLEX_INT32:
-            return read_primitive<std::complex<int32_t>>(socket, dims);
+            return read_primitive<std::complex<int32_t>>(socket, dims, encoding);
         case matlab::data::ArrayType::COMPLEX_UINT64:
-            return read_primitive<std::complex<uint64_t>>(socket, dims);
+            return read_primitive<std::complex<uint64_t>>(socket, dims, encoding);
         case matlab::data::ArrayType::COMPLEX_INT64:
-            return read_primitive<std::complex<int64_t>>(socket, dims);
+            return read_primitive<std::complex<int64_t>>(socket, dims, encoding);
+
+        case matlab::data::ArrayType::SPARSE_LOGICAL:
+            return read_sparse<bool>(socket, dims);
+        case matlab::data::ArrayType::SPARSE_DOUBLE:
+            return read_sparse<double>(socket, dims);
+        case matlab::data::ArrayType::SPARSE_COMPLEX_DOUBLE:
+            return read_sparse<std::complex<double>>(socket, dims);
 
         default:
             throw matlab::engine::MATLABException("matfrostjulia:conversion:typeNotSupported", u"MATFrost does not support conversions to MATLAB from Julia with array_type: ");
@@ -168,8 +345,40 @@ matlab::data::Array read(const std::shared_ptr<Socket::BufferedUnixDomainSocket>
     }
 }
 
+    /**
+     * Response to the call identified by request_id.
+     */
+    struct Message {
+        uint64_t request_id;
+        matlab::data::Array value;
+    };
+
+    /**
+     * Read a complete message, see Write::write_message.
+     */
+    Message read_message(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket) {
+        uint64_t request_id;
+        uint64_t nbytes;
+        uint64_t offset;
+        uint64_t advance;
+        socket->read(reinterpret_cast<uint8_t *>(&request_id), sizeof(uint64_t));
+        socket->read(reinterpret_cast<uint8_t *>(&nbytes), sizeof(uint64_t));
+        socket->read(reinterpret_cast<uint8_t *>(&offset), sizeof(uint64_t));
+        socket->read(reinterpret_cast<uint8_t *>(&advance), sizeof(uint64_t));
+        socket->observe_message(nbytes);
+
+        socket->schemas.read.clear();
+
+        if (socket->shared_memory) {
+            socket->shared_memory->begin_read(offset, advance);
+        }
 
+        auto arr = read(socket);
 
+        if (socket->shared_memory) {
+            socket->shared_memory->end_read();
+        }
+        return Message{request_id, arr};
+    }
 
 }
-
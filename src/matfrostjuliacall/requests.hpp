@@ -0,0 +1,101 @@
+/**
+ * Bookkeeping of the calls in flight on a single connection.
+ *
+ * Every call written to the socket is tagged with a request ID, which Julia echoes in its response. Responses read
+ * before MATLAB asks for them are parked in the completed table until they are fetched. Responses of cancelled calls
+ * are dropped when they arrive.
+ */
+#ifndef MATFROST_JL_REQUESTS_HPP
+#define MATFROST_JL_REQUESTS_HPP
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+
+namespace MATFrost::Requests {
+
+    /**
+     * Thrown when the calls in flight are cancelled, see Pool::Worker::cancel. The connection stays usable.
+     */
+    class Cancelled : public matlab::engine::MATLABException {
+    public:
+        using matlab::engine::MATLABException::MATLABException;
+    };
+
+    class PendingRequests {
+        uint64_t next_request_id = 1;
+
+        std::set<uint64_t> in_flight{};
+        std::map<uint64_t, matlab::data::Array> completed{};
+
+        // In flight, but abandoned: the response is dropped.
+        std::set<uint64_t> cancelled{};
+
+    public:
+
+        /**
+         * Reserve the request ID for a new call.
+         */
+        uint64_t issue() {
+            const uint64_t request_id = next_request_id++;
+            in_flight.insert(request_id);
+            return request_id;
+        }
+
+        void complete(const uint64_t request_id, const matlab::data::Array value) {
+            if (cancelled.erase(request_id) > 0) {
+                return;
+            }
+            if (in_flight.erase(request_id) == 0) {
+                throw matlab::engine::MATLABException("MATFrost received response for unknown request: " + std::to_string(request_id));
+            }
+            completed.emplace(request_id, value);
+        }
+
+        /**
+         * Abandon a single call. If in flight, its response is still read, in order, and dropped. Other calls are
+         * not affected.
+         */
+        void cancel(const uint64_t request_id) {
+            if (in_flight.erase(request_id) > 0) {
+                cancelled.insert(request_id);
+            } else {
+                completed.erase(request_id);
+            }
+        }
+
+        /**
+         * Whether no call issued before request_id is still awaited. Julia answers in order: it runs this call, or
+         * one of the cancelled calls before it.
+         */
+        bool is_first_in_flight(const uint64_t request_id) const {
+            return in_flight.empty() || *in_flight.begin() >= request_id;
+        }
+
+        bool is_known(const uint64_t request_id) const {
+            return in_flight.count(request_id) > 0 || completed.count(request_id) > 0;
+        }
+
+        bool is_completed(const uint64_t request_id) const {
+            return completed.count(request_id) > 0;
+        }
+
+        /**
+         * Hand out the result of a completed request. The request is forgotten afterwards.
+         */
+        matlab::data::Array take(const uint64_t request_id) {
+            auto it = completed.find(request_id);
+            if (it == completed.end()) {
+                throw matlab::engine::MATLABException("MATFrost request not completed: " + std::to_string(request_id));
+            }
+            matlab::data::Array value = it->second;
+            completed.erase(it);
+            return value;
+        }
+
+    };
+
+}
+
+#endif //MATFROST_JL_REQUESTS_HPP
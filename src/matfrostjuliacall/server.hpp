@@ -3,10 +3,22 @@
  * process. This class is free of MATLAB dependencies
  */
 #include <cstdint>
+#ifdef _WIN32
 #include <windows.h>
 #include <tchar.h>
 #include <cstdio>
 #include <strsafe.h>
+#else
+#include <spawn.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <cerrno>
+
+extern char **environ;
+#endif
 
 
 
@@ -16,20 +28,32 @@
 #include <string>
 #include <iostream>
 #include <array>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include "logbuffer.hpp"
 
 namespace MATFrost {
 
     class MATFrostServer {
 
+        // Julia output is drained continuously, such that Julia never blocks on a full pipe. See Logs::LogBuffer.
+        Logs::LogBuffer logs;
+        std::atomic<bool> stopping{false};
+        std::atomic<bool> drained{false};
+        std::thread drain_thread{};
+
     public:
 
+#ifdef _WIN32
         PROCESS_INFORMATION process_information;
         HANDLE h_stdouterr;
 
-        MATFrostServer(PROCESS_INFORMATION process_information, HANDLE h_stdouterr) :
-            process_information(process_information), h_stdouterr(h_stdouterr)
+        MATFrostServer(PROCESS_INFORMATION process_information, HANDLE h_stdouterr, const size_t log_capacity, const std::string log_spill) :
+            logs(log_capacity, log_spill), process_information(process_information), h_stdouterr(h_stdouterr)
         {
-
+            drain_thread = std::thread(&MATFrostServer::drain, this);
         }
 
 
@@ -41,6 +65,9 @@ namespace MATFrost {
 
             WaitForSingleObject(process_information.hProcess, 500);
 
+            stopping = true;
+            drain_thread.join();
+
             CloseHandle(process_information.hProcess);
             CloseHandle(process_information.hThread);
             CloseHandle(h_stdouterr);
@@ -57,6 +84,14 @@ namespace MATFrost {
             return exit_code == STILL_ACTIVE;
         }
 
+        /**
+         * Interrupt the running Julia call. Not supported: the Julia process has no console to send Ctrl-C to, the
+         * running call completes.
+         */
+        bool interrupt() {
+            return false;
+        }
+
 
         static DWORD bytes_available(HANDLE handle) {
             DWORD bytes_available = 0;
@@ -94,25 +129,120 @@ namespace MATFrost {
             return buffer;
         }
 
+        /**
+         * Body of the log-drain thread: move the Julia output into the log buffer until the pipe is closed.
+         */
+        void drain() {
+            while (!stopping) {
+                const DWORD ba = bytes_available(h_stdouterr);
+                if (ba == static_cast<DWORD>(-1)) {
+                    break; // Pipe closed: Julia exited.
+                }
+                if (ba == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    continue;
+                }
+                const std::string output = read_string(h_stdouterr);
+                logs.append(output.data(), output.size());
+            }
+            drained = true;
+        }
+#else
+        pid_t pid;
+        int h_stdouterr;
 
+        MATFrostServer(pid_t pid, int h_stdouterr, const size_t log_capacity, const std::string log_spill) :
+            logs(log_capacity, log_spill), pid(pid), h_stdouterr(h_stdouterr)
+        {
+            drain_thread = std::thread(&MATFrostServer::drain, this);
+        }
 
-        void dump_logging(std::shared_ptr<matlab::engine::MATLABEngine> matlab) {
+        ~MATFrostServer() {
+            if (is_alive()) {
+                kill(pid, SIGTERM);
+                for (int i = 0; i < 50 && is_alive(); i++) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                if (is_alive()) {
+                    kill(pid, SIGKILL);
+                }
+            }
+            // Reap the child.
+            waitpid(pid, nullptr, 0);
+
+            stopping = true;
+            drain_thread.join();
+            close(h_stdouterr);
+        }
+
+        bool is_alive() {
+            int status;
+            return waitpid(pid, &status, WNOHANG) == 0;
+        }
 
-            if (bytes_available(h_stdouterr) > 0) {
+        /**
+         * Interrupt the running Julia call with SIGINT, Julia throws an InterruptException in the call. Returns whether
+         * the signal was sent.
+         */
+        bool interrupt() {
+            return is_alive() && kill(pid, SIGINT) == 0;
+        }
 
-                matlab::data::ArrayFactory factory;
-                std::u16string logging = matlab::engine::convertUTF8StringToUTF16String(read_string(h_stdouterr));
-                if (logging.size() == 0) {
-                    return;
+        /**
+         * Body of the log-drain thread: move the Julia output into the log buffer until the pipe is closed.
+         */
+        void drain() {
+            std::array<char, 4096> chunk{};
+            pollfd pfd{h_stdouterr, POLLIN, 0};
+
+            while (!stopping) {
+                // Bounded wait, such that the thread notices stopping.
+                const int rc = poll(&pfd, 1, 50);
+                if (rc < 0 && errno != EINTR) {
+                    break;
+                }
+                if (rc <= 0) {
+                    continue;
+                }
+                const ssize_t n = read(h_stdouterr, chunk.data(), chunk.size());
+                if (n <= 0) {
+                    break; // Pipe closed: Julia exited.
+                }
+                logs.append(chunk.data(), static_cast<size_t>(n));
+            }
+            drained = true;
+        }
+#endif
+
+        /**
+         * Take the Julia output received since the last call.
+         */
+        std::string take_logging() {
+            if (!is_alive()) {
+                // Output written just before exiting, e.g. the error that stopped Julia, is still on its way.
+                for (int i = 0; i < 100 && !drained; i++) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
                 }
-                matlab->feval(u"disp", 0, std::vector<matlab::data::Array>
-                  ({factory.createScalar(logging)}));
-                // return read_string(h_stdouterr);
+            }
+            return logs.take();
+        }
+
+        void dump_logging(std::shared_ptr<matlab::engine::MATLABEngine> matlab) {
+            if (logs.empty() && is_alive()) {
+                return;
             }
 
+            matlab::data::ArrayFactory factory;
+            std::u16string logging = matlab::engine::convertUTF8StringToUTF16String(take_logging());
+            if (logging.size() == 0) {
+                return;
+            }
+            matlab->feval(u"disp", 0, std::vector<matlab::data::Array>
+              ({factory.createScalar(logging)}));
         }
 
-        static std::shared_ptr<MATFrostServer> spawn(const std::string cmdline) {
+#ifdef _WIN32
+        static std::shared_ptr<MATFrostServer> spawn(const std::string cmdline, const size_t log_capacity, const std::string log_spill) {
 
             SECURITY_ATTRIBUTES saAttr;
 
@@ -164,10 +294,58 @@ namespace MATFrost {
 
             CloseHandle(h_stdouterr[1]);
 
-            return std::make_shared<MATFrostServer>(piProcInfo, h_stdouterr[0]);
+            return std::make_shared<MATFrostServer>(piProcInfo, h_stdouterr[0], log_capacity, log_spill);
+
 
+        }
+#else
+        static std::shared_ptr<MATFrostServer> spawn(const std::string cmdline, const size_t log_capacity, const std::string log_spill) {
+
+            // Only the duplicated stdout/stderr descriptors are inherited by the child. The pipe is close-on-exec from
+            // the start: a Julia process spawned concurrently by another session must not inherit the write end, or
+            // the drain thread never sees the end of the output.
+            int h_stdouterr[2];
+#ifdef __linux__
+            if (pipe2(h_stdouterr, O_CLOEXEC) != 0) {
+                throw matlab::engine::MATLABException("pipe failed");
+            }
+#else
+            // No pipe2: a spawn of another thread between pipe and fcntl may still inherit the pipe.
+            if (pipe(h_stdouterr) != 0) {
+                throw matlab::engine::MATLABException("pipe failed");
+            }
+            if (fcntl(h_stdouterr[0], F_SETFD, FD_CLOEXEC) != 0 || fcntl(h_stdouterr[1], F_SETFD, FD_CLOEXEC) != 0) {
+                close(h_stdouterr[0]);
+                close(h_stdouterr[1]);
+                throw matlab::engine::MATLABException("fcntl failed");
+            }
+#endif
+
+            posix_spawn_file_actions_t file_actions;
+            posix_spawn_file_actions_init(&file_actions);
+            posix_spawn_file_actions_adddup2(&file_actions, h_stdouterr[1], STDOUT_FILENO);
+            posix_spawn_file_actions_adddup2(&file_actions, h_stdouterr[1], STDERR_FILENO);
+
+            // The command line is interpreted by the shell, `exec` replaces the shell by the Julia process.
+            std::string cmdline_exec = "exec " + cmdline;
+            char sh[] = "/bin/sh";
+            char c[] = "-c";
+            char* argv[] = {sh, c, &cmdline_exec[0], nullptr};
+
+            pid_t pid;
+            int rc = posix_spawn(&pid, "/bin/sh", &file_actions, nullptr, argv, environ);
+
+            posix_spawn_file_actions_destroy(&file_actions);
+            close(h_stdouterr[1]);
+
+            if (rc != 0) {
+                close(h_stdouterr[0]);
+                throw matlab::engine::MATLABException("Julia process could not be started. With cmdline: " + cmdline);
+            }
 
+            return std::make_shared<MATFrostServer>(pid, h_stdouterr[0], log_capacity, log_spill);
         }
+#endif
 
     };
 }
@@ -0,0 +1,80 @@
+/**
+ * Registry of the sessions of the MEX, one per matfrostjulia object.
+ *
+ * Sessions are used concurrently, e.g. from MATLAB backgroundPool workers. The registry lock is only held to look up,
+ * add or remove a session, never during an action. Each session has its own lock, held for a whole action: it
+ * serializes the use of the connections, pending requests and function tables of the session. Actions on different
+ * sessions never wait for each other.
+ */
+#ifndef MATFROST_JL_SESSIONS_HPP
+#define MATFROST_JL_SESSIONS_HPP
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+namespace MATFrost::Sessions {
+
+    struct Session {
+        std::mutex mutex{};
+
+        const std::shared_ptr<Pool::WorkerPool> pool;
+
+        // Streams and uploads of the first worker, see Streams.
+        Streams::ReadAhead streams{};
+        Streams::WriteBehind uploads{};
+
+        explicit Session(std::shared_ptr<Pool::WorkerPool> pool) : pool(std::move(pool)) {}
+
+        /**
+         * Worker serving the regular calls, the first one.
+         */
+        const Pool::Worker& worker() const {
+            return pool->workers[0];
+        }
+    };
+
+    class Registry {
+        mutable std::shared_mutex mutex{};
+        std::map<uint64_t, std::shared_ptr<Session>> sessions{};
+
+    public:
+
+        std::shared_ptr<Session> find(const uint64_t id) const {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto it = sessions.find(id);
+            return it == sessions.end() ? nullptr : it->second;
+        }
+
+        bool contains(const uint64_t id) const {
+            return find(id) != nullptr;
+        }
+
+        /**
+         * Add the session, unless a session with the ID exists already. Returns whether it was added.
+         */
+        bool insert(const uint64_t id, std::shared_ptr<Session> session) {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            return sessions.emplace(id, std::move(session)).second;
+        }
+
+        /**
+         * Remove the session. It is stopped once the actions still holding it complete.
+         */
+        std::shared_ptr<Session> erase(const uint64_t id) {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            auto it = sessions.find(id);
+            if (it == sessions.end()) {
+                return nullptr;
+            }
+            std::shared_ptr<Session> session = it->second;
+            sessions.erase(it);
+            return session;
+        }
+    };
+
+}
+
+#endif //MATFROST_JL_SESSIONS_HPP
@@ -0,0 +1,253 @@
+/**
+ * Shared-memory data plane for bulk payloads.
+ *
+ * A single memory mapped region is negotiated at connection time. It holds two single-producer/single-consumer
+ * rings, one for each direction. Large primitive payloads are copied straight into the ring, while the socket only
+ * carries the array header. All shared memory payloads of a message are placed in one contiguous block which is
+ * reserved before the message is written, such that the reader can consume the payloads in stream order.
+ *
+ * Region layout (all fields uint64):
+ *   [0]  capacity (bytes per ring)
+ *   [8]  ring 0 head  (MATLAB -> Julia, bytes reserved by writer, monotonic)
+ *   [16] ring 0 tail  (MATLAB -> Julia, bytes released by reader, monotonic)
+ *   [24] ring 1 head  (Julia -> MATLAB)
+ *   [32] ring 1 tail  (Julia -> MATLAB)
+ *   [64] ring 0 data, followed by ring 1 data.
+ */
+#ifndef MATFROST_JL_SHAREDMEMORY_HPP
+#define MATFROST_JL_SHAREDMEMORY_HPP
+
+#include <cstdint>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <cstring>
+
+namespace MATFrost::SharedMemory {
+
+    constexpr size_t HEADER_SIZE = 64;
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory rings require lock-free 64-bit atomics");
+
+    /**
+     * Block of a ring reserved for the shared memory payloads of a single message.
+     */
+    struct Block {
+        uint64_t offset = 0;   // Offset of the block with respect to the ring data.
+        uint64_t advance = 0;  // Number of bytes the ring tail moves after the block is consumed (includes wrap padding).
+        uint64_t nbytes = 0;
+        uint64_t cursor = 0;
+        bool active = false;
+    };
+
+    class Region {
+#ifdef _WIN32
+        HANDLE h_mapping = nullptr;
+#endif
+        uint8_t* base = nullptr;
+
+        std::atomic<uint64_t>* head(size_t ring) const {
+            return reinterpret_cast<std::atomic<uint64_t>*>(base + 8 + 16*ring);
+        }
+
+        std::atomic<uint64_t>* tail(size_t ring) const {
+            return reinterpret_cast<std::atomic<uint64_t>*>(base + 16 + 16*ring);
+        }
+
+        uint8_t* data(size_t ring) const {
+            return base + HEADER_SIZE + ring*capacity;
+        }
+
+        // MATLAB writes to ring 0 and reads from ring 1.
+        static constexpr size_t WRITE_RING = 0;
+        static constexpr size_t READ_RING = 1;
+
+    public:
+        const std::string name;
+        const uint64_t capacity;
+        const uint64_t threshold;
+
+        Block write_block{};
+        Block read_block{};
+
+#ifdef _WIN32
+        Region(const std::string &name, const uint64_t capacity, const uint64_t threshold, HANDLE h_mapping, uint8_t* base) :
+            h_mapping(h_mapping),
+            base(base),
+            name(name),
+            capacity(capacity),
+            threshold(threshold)
+        { }
+
+        ~Region() {
+            if (base != nullptr) {
+                UnmapViewOfFile(base);
+            }
+            if (h_mapping != nullptr) {
+                CloseHandle(h_mapping);
+            }
+        }
+#else
+        Region(const std::string &name, const uint64_t capacity, const uint64_t threshold, uint8_t* base) :
+            base(base),
+            name(name),
+            capacity(capacity),
+            threshold(threshold)
+        { }
+
+        ~Region() {
+            if (base != nullptr) {
+                munmap(base, HEADER_SIZE + 2*capacity);
+            }
+            shm_unlink(name.c_str());
+        }
+#endif
+
+        /**
+         * Reserve a contiguous block of nb bytes for the next outgoing message. If the ring has insufficient space
+         * the block stays inactive and the payloads are sent over the socket.
+         */
+        const Block& begin_write(const uint64_t nb) {
+            write_block = Block{};
+            if (nb == 0 || nb > capacity) {
+                return write_block;
+            }
+
+            const uint64_t h = head(WRITE_RING)->load(std::memory_order_relaxed);
+            const uint64_t t = tail(WRITE_RING)->load(std::memory_order_acquire);
+
+            const uint64_t pos = h % capacity;
+            const uint64_t pad = (pos + nb > capacity) ? capacity - pos : 0;
+
+            if (pad + nb > capacity - (h - t)) {
+                return write_block;
+            }
+
+            write_block.offset = pad > 0 ? 0 : pos;
+            write_block.advance = pad + nb;
+            write_block.nbytes = nb;
+            write_block.active = true;
+
+            head(WRITE_RING)->store(h + pad + nb, std::memory_order_release);
+            return write_block;
+        }
+
+        bool writes(const uint64_t nb) const {
+            return write_block.active && nb >= threshold;
+        }
+
+        void write(const uint8_t* src, const uint64_t nb) {
+            memcpy(data(WRITE_RING) + write_block.offset + write_block.cursor, src, nb);
+            write_block.cursor += nb;
+        }
+
+        void end_write() {
+            write_block = Block{};
+        }
+
+        void begin_read(const uint64_t offset, const uint64_t advance) {
+            read_block = Block{offset, advance, 0, 0, advance > 0};
+        }
+
+        void read(uint8_t* dst, const uint64_t nb) {
+            if (!read_block.active) {
+                throw matlab::engine::MATLABException("MATFrost shared memory block not available");
+            }
+            memcpy(dst, data(READ_RING) + read_block.offset + read_block.cursor, nb);
+            read_block.cursor += nb;
+        }
+
+        /**
+         * Hand the consumed block back to the writer on the other side.
+         */
+        void end_read() {
+            if (read_block.active) {
+                tail(READ_RING)->fetch_add(read_block.advance, std::memory_order_release);
+            }
+            read_block = Block{};
+        }
+
+#ifdef _WIN32
+        static std::shared_ptr<Region> create(const std::string &name, const uint64_t capacity, const uint64_t threshold) {
+            const uint64_t size = HEADER_SIZE + 2*capacity;
+
+            HANDLE h_mapping = CreateFileMappingA(
+                INVALID_HANDLE_VALUE,
+                nullptr,
+                PAGE_READWRITE,
+                static_cast<DWORD>(size >> 32),
+                static_cast<DWORD>(size & 0xFFFFFFFF),
+                name.c_str());
+
+            if (h_mapping == nullptr) {
+                throw matlab::engine::MATLABException("MATFrost shared memory could not be created: " + std::to_string(GetLastError()));
+            }
+
+            auto base = static_cast<uint8_t*>(MapViewOfFile(h_mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+            if (base == nullptr) {
+                CloseHandle(h_mapping);
+                throw matlab::engine::MATLABException("MATFrost shared memory could not be mapped: " + std::to_string(GetLastError()));
+            }
+
+            memset(base, 0, HEADER_SIZE);
+            *reinterpret_cast<uint64_t*>(base) = capacity;
+
+            return std::make_shared<Region>(name, capacity, threshold, h_mapping, base);
+        }
+
+        static std::string unique_name(const std::string &socket_path) {
+            static std::atomic<uint64_t> counter{0};
+            return "Local\\matfrost-" + std::to_string(GetCurrentProcessId()) + "-" + std::to_string(counter++) + "-" +
+                std::to_string(std::hash<std::string>{}(socket_path));
+        }
+#else
+        static std::shared_ptr<Region> create(const std::string &name, const uint64_t capacity, const uint64_t threshold) {
+            const uint64_t size = HEADER_SIZE + 2*capacity;
+
+            int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+            if (fd < 0) {
+                throw matlab::engine::MATLABException("MATFrost shared memory could not be created: " + std::to_string(errno));
+            }
+
+            if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                close(fd);
+                shm_unlink(name.c_str());
+                throw matlab::engine::MATLABException("MATFrost shared memory could not be sized: " + std::to_string(errno));
+            }
+
+            void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (base == MAP_FAILED) {
+                shm_unlink(name.c_str());
+                throw matlab::engine::MATLABException("MATFrost shared memory could not be mapped: " + std::to_string(errno));
+            }
+
+            memset(base, 0, HEADER_SIZE);
+            *static_cast<uint64_t*>(base) = capacity;
+
+            return std::make_shared<Region>(name, capacity, threshold, static_cast<uint8_t*>(base));
+        }
+
+        static std::string unique_name(const std::string &socket_path) {
+            static std::atomic<uint64_t> counter{0};
+            return "/matfrost-" + std::to_string(getpid()) + "-" + std::to_string(counter++) + "-" +
+                std::to_string(std::hash<std::string>{}(socket_path));
+        }
+#endif
+
+    };
+
+}
+
+#endif //MATFROST_JL_SHAREDMEMORY_HPP
@@ -0,0 +1,33 @@
+/**
+ * Detection of the vector instructions used by the transcoding and packing kernels, see Utf and Bits. SSE2 is part of
+ * every x86-64 target. Other targets fall back to processing 64-bit words. Free of MATLAB dependencies.
+ */
+#ifndef MATFROST_JL_SIMD_HPP
+#define MATFROST_JL_SIMD_HPP
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATFROST_JL_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace MATFrost::Simd {
+
+    inline unsigned trailing_zeros(const uint32_t mask) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+}
+
+#endif //MATFROST_JL_SIMD_HPP
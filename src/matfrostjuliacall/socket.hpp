@@ -6,6 +6,7 @@
 #define MATFROST_JL_SOCKET_HPP
 
 #include <cstdint>
+#ifdef _WIN32
 #include <winsock2.h>
 #include <windows.h>
 #include <tchar.h>
@@ -13,27 +14,111 @@
 #include <strsafe.h>
 
 #include <afunix.h>
+#else
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#endif
 
 #include <memory>
 
 #include <string>
 #include <iostream>
 #include <array>
-
+#include <climits>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+#include "sharedmemory.hpp"
+#include "encoding.hpp"
+#include "stats.hpp"
+#include "cache.hpp"
+#include "plan.hpp"
+
+// Default size of the input and output buffers of a connection, see BufferSizes.
 #define BUFSIZE 65536 // 16384
 
 namespace MATFrost::Socket {
 
+#ifdef _WIN32
+    // WSAStartup once per MEX, also when sessions connect concurrently.
+    std::mutex wsa_mutex;
     bool wsa_initialized = false;
     WSADATA wsa_data = { 0 };
 
+    inline int last_error() {
+        return WSAGetLastError();
+    }
+
+    inline void close_socket(SOCKET fd) {
+        closesocket(fd);
+    }
+#else
+    inline int last_error() {
+        return errno;
+    }
+
+    inline void close_socket(SOCKET fd) {
+        close(fd);
+    }
+
+    inline int poll_timeout_ms(const timeval &time_out) {
+        return static_cast<int>(time_out.tv_sec * 1000 + time_out.tv_usec / 1000);
+    }
+
+    inline bool would_block() {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+#endif
+
 
     struct Buffer {
-        std::array<uint8_t, BUFSIZE> data{};
+        std::vector<uint8_t> data = std::vector<uint8_t>(BUFSIZE);
         size_t position = 0;
         size_t available = 0;
     };
 
+    // Smallest input and output buffers of a connection.
+    constexpr size_t MIN_BUFSIZE = 4096;
+
+    /**
+     * Buffer sizes of a connection, set by START. nbytes sizes the input and output buffers, kernel_nbytes the kernel
+     * send and receive buffers (SO_SNDBUF, SO_RCVBUF), 0 keeps the OS default. The OS may round or cap the kernel size.
+     *
+     * If adaptive, both grow to the power of two above the largest message sent or received, up to max_nbytes. They
+     * never shrink: a connection moving large messages once keeps its buffers.
+     */
+    struct BufferSizes {
+        size_t nbytes = BUFSIZE;
+        size_t kernel_nbytes = 0;
+        bool adaptive = false;
+        size_t max_nbytes = 1 << 22;
+    };
+
+    /**
+     * Contiguous bytes of pending output: bytes staged in the output buffer, or a payload referenced in place.
+     */
+    struct Segment {
+        const uint8_t* data;
+        size_t nbytes;
+    };
+
+    // Payloads of at least this size are sent in place by write_referenced, smaller payloads are copied.
+    constexpr size_t REFERENCE_MIN_NBYTES = 1024;
+
+    // Segments per vectored send call.
+    constexpr size_t MAX_SEGMENTS = 64;
+
 
     class BufferedUnixDomainSocket {
         const std::string socket_path;
@@ -45,10 +130,70 @@ namespace MATFrost::Socket {
         Buffer input{};
         Buffer output{};
 
+        // Data received while blocked on writing, consumed after the input buffer.
+        std::vector<uint8_t> backlog{};
+        size_t backlog_position = 0;
+
+        // Pending output in order, sent by flush with vectored send calls. Output buffer bytes from staged onwards are
+        // not yet part of a segment.
+        std::vector<Segment> segments{};
+        size_t staged = 0;
+
+        // Target sizes, the input and output buffers are resized to sizes.nbytes once empty. See BufferSizes.
+        BufferSizes sizes{};
+
+        void set_kernel_buffers(const size_t nb) {
+            const int n = static_cast<int>(std::min<size_t>(nb, INT_MAX));
+            // Best effort: the OS caps the size to its limits, the connection works at any size.
+            setsockopt(socket_fd, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&n), sizeof(n));
+            setsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&n), sizeof(n));
+            sizes.kernel_nbytes = nb;
+        }
+
+        size_t kernel_send_buffer() const {
+            int n = 0;
+#ifdef _WIN32
+            int len = sizeof(n);
+#else
+            socklen_t len = sizeof(n);
+#endif
+            if (getsockopt(socket_fd, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<char*>(&n), &len) != 0) {
+                return 0;
+            }
+            return static_cast<size_t>(n);
+        }
+
+        /**
+         * Close the output buffer bytes written since the last segment into a segment.
+         */
+        void stage() {
+            if (output.available > staged) {
+                segments.push_back(Segment{&output.data[staged], output.available - staged});
+                staged = output.available;
+            }
+        }
+
     public:
 
         const long timeout_ms = 0;
 
+        std::shared_ptr<SharedMemory::Region> shared_memory = nullptr;
+
+        // Struct schemas of the message being written or read.
+        Encoding::Schemas schemas{};
+
+        // Traffic and latency of this connection, see Stats.
+        Stats::Statistics stats{};
+
+        // Mirror of the Julia cache of large arguments, see Cache::ArgumentCache.
+        Cache::ArgumentCache cache{};
+
+        // Serialization plans registered with Julia, see Plans::Registry.
+        Plans::Registry plans{};
+
+        // Logical arrays of at least this many elements are sent bit-packed, 0 disables bit packing. See Bits.
+        uint64_t bit_packing = 0;
+
         BufferedUnixDomainSocket(const std::string &socket_path, SOCKET socket, timeval timeout, uint64_t timeout_ms) :
             socket_path(socket_path),
             socket_fd(socket),
@@ -58,7 +203,7 @@ namespace MATFrost::Socket {
 
         ~BufferedUnixDomainSocket() {
             if (socket_fd != INVALID_SOCKET) {
-                closesocket(socket_fd);
+                close_socket(socket_fd);
             }
         }
 
@@ -72,17 +217,29 @@ namespace MATFrost::Socket {
                     memcpy(&data[br], &input.data[input.position], brn);
                     input.position += brn;
                     br += brn;
-                } else if (nb - br >= BUFSIZE) {
-                    br += read_from_socket(&data[br], BUFSIZE);;
+                } else if (backlog_position < backlog.size()) {
+                    size_t brn = std::min(backlog.size() - backlog_position, nb - br);
+                    memcpy(&data[br], &backlog[backlog_position], brn);
+                    backlog_position += brn;
+                    br += brn;
+                    if (backlog_position == backlog.size()) {
+                        backlog.clear();
+                        backlog_position = 0;
+                    }
+                } else if (nb - br >= input.data.size()) {
+                    br += read_from_socket(&data[br], input.data.size());
                 } else {
+                    if (input.data.size() != sizes.nbytes) {
+                        input.data.resize(sizes.nbytes);
+                    }
                     input.position = 0;
-                    input.available = read_from_socket(&input.data[0], BUFSIZE);
+                    input.available = read_from_socket(&input.data[0], input.data.size());
                 }
             }
         };
 
         void write(const uint8_t *data, const size_t nb) {
-            size_t bw = std::min(BUFSIZE - output.available, nb);
+            size_t bw = std::min(output.data.size() - output.available, nb);
             memcpy(&output.data[output.available], data, bw);
             output.available += bw;
 
@@ -92,8 +249,8 @@ namespace MATFrost::Socket {
 
             flush();
 
-            while (nb - bw >= BUFSIZE) {
-                bw += write_to_socket(&data[bw], BUFSIZE);
+            while (nb - bw >= output.data.size()) {
+                bw += write_to_socket(&data[bw], output.data.size());
             }
 
             if (bw < nb) {
@@ -103,38 +260,158 @@ namespace MATFrost::Socket {
             }
         }
 
+        /**
+         * Write without copying: data is sent in place by the next flush and must stay valid until then. The output
+         * buffer only coalesces the small writes in between. Writes smaller than REFERENCE_MIN_NBYTES are copied.
+         */
+        void write_referenced(const uint8_t *data, const size_t nb) {
+            if (nb < REFERENCE_MIN_NBYTES) {
+                return write(data, nb);
+            }
+            stage();
+            segments.push_back(Segment{data, nb});
+            if (segments.size() >= MAX_SEGMENTS) {
+                flush();
+            }
+        }
+
+        /**
+         * Input already read from the socket but not yet consumed. Such data is not reported by wait_for_readable.
+         */
+        bool has_buffered_input() const {
+            return input.available > input.position || backlog_position < backlog.size();
+        }
+
         void flush() {
-            while (output.available > output.position) {
-                output.position += write_to_socket(&output.data[output.position], output.available - output.position);
+            stage();
+            size_t first = 0;
+            while (first < segments.size()) {
+                size_t sent = write_to_socket(&segments[first], std::min(segments.size() - first, MAX_SEGMENTS));
+                // Drop the segments sent completely, a partially sent segment continues where the send stopped.
+                while (sent > 0) {
+                    Segment &segment = segments[first];
+                    if (sent >= segment.nbytes) {
+                        sent -= segment.nbytes;
+                        first++;
+                    } else {
+                        segment.data += sent;
+                        segment.nbytes -= sent;
+                        sent = 0;
+                    }
+                }
             }
+            segments.clear();
+            staged = 0;
             output.position = 0;
             output.available = 0;
+            if (output.data.size() != sizes.nbytes) {
+                output.data.resize(sizes.nbytes);
+            }
+        }
+
+        /**
+         * Apply the buffer sizes, see BufferSizes. The input and output buffers are resized once empty.
+         */
+        void configure_buffers(const BufferSizes &configured) {
+            sizes = configured;
+            sizes.nbytes = std::max(configured.nbytes, MIN_BUFSIZE);
+            sizes.max_nbytes = std::max(configured.max_nbytes, sizes.nbytes);
+            if (configured.kernel_nbytes > 0) {
+                set_kernel_buffers(configured.kernel_nbytes);
+            } else {
+                sizes.kernel_nbytes = kernel_send_buffer();
+            }
+            if (output.available == 0) {
+                output.data.resize(sizes.nbytes);
+            }
+            if (input.available == input.position) {
+                input.data.resize(sizes.nbytes);
+            }
+        }
+
+        const BufferSizes& buffer_sizes() const {
+            return sizes;
+        }
+
+        /**
+         * Account a message of nbytes sent or received, with adaptive sizes the buffers grow to hold it.
+         */
+        void observe_message(const uint64_t nbytes) {
+            if (!sizes.adaptive || nbytes <= sizes.nbytes || sizes.nbytes >= sizes.max_nbytes) {
+                return;
+            }
+            size_t target = sizes.nbytes;
+            while (target < nbytes && target < sizes.max_nbytes) {
+                target *= 2;
+            }
+            sizes.nbytes = std::min(target, sizes.max_nbytes);
+            if (sizes.nbytes > sizes.kernel_nbytes) {
+                set_kernel_buffers(sizes.nbytes);
+            }
         }
 
         int write_to_socket(const uint8_t *data, const size_t nb) {
+            const Segment segment{data, nb};
+            return static_cast<int>(write_to_socket(&segment, 1));
+        }
 
-            if (!wait_for_writable(timeout)) {
+        /**
+         * Send the segments with a single vectored send call, at most MAX_SEGMENTS. Returns the number of bytes sent,
+         * which may end within any of the segments.
+         */
+        size_t write_to_socket(const Segment *segs, const size_t nsegs) {
+            const uint64_t start = Stats::now_ns();
+#ifdef _WIN32
+            if (!wait_for_writable_draining(timeout)) {
                 throw matlab::engine::MATLABException("Write socket timeout: " + std::to_string(timeout.tv_sec) + " seconds");
             }
 
-            int sent = send(socket_fd,
-                reinterpret_cast<const char*>(data),
-                static_cast<int>(nb),
-                0);
+            WSABUF bufs[MAX_SEGMENTS];
+            for (size_t i = 0; i < nsegs; i++) {
+                bufs[i].buf = reinterpret_cast<CHAR*>(const_cast<uint8_t*>(segs[i].data));
+                bufs[i].len = static_cast<ULONG>(std::min<size_t>(segs[i].nbytes, 1 << 30));
+            }
+            DWORD sent_bytes = 0;
+            const int rc = WSASend(socket_fd, bufs, static_cast<DWORD>(nsegs), &sent_bytes, 0, nullptr, nullptr);
+            const long long sent = rc == 0 ? static_cast<long long>(sent_bytes) : -1;
+#else
+            iovec iov[MAX_SEGMENTS];
+            for (size_t i = 0; i < nsegs; i++) {
+                iov[i].iov_base = const_cast<uint8_t*>(segs[i].data);
+                iov[i].iov_len = segs[i].nbytes;
+            }
+            msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = nsegs;
+
+            // Optimistic send, only wait for the socket when the kernel buffer is full.
+            ssize_t sent = sendmsg(socket_fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+            while (sent < 0 && would_block()) {
+                if (errno != EINTR && !wait_for_writable_draining(timeout)) {
+                    throw matlab::engine::MATLABException("Write socket timeout: " + std::to_string(timeout.tv_sec) + " seconds");
+                }
+                sent = sendmsg(socket_fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+            }
+#endif
+
+            stats.send_ns += Stats::now_ns() - start;
 
             if (sent > 0) {
-                return sent;
+                stats.bytes_sent += sent;
+                return static_cast<size_t>(sent);
                 // Might block here on next iteration if buffer fills
             } else if (sent == 0) {
                 throw matlab::engine::MATLABException("Connection closed");
             } else {
                 throw matlab::engine::MATLABException("Socket send error: " +
-                                       std::to_string(WSAGetLastError()));
+                                       std::to_string(last_error()));
             }
 
         }
 
         int read_from_socket(uint8_t *data, const int nb) {
+            const uint64_t start = Stats::now_ns();
+#ifdef _WIN32
             // Use select to wait for data with timeout
             if (!wait_for_readable(timeout)) {
                 throw matlab::engine::MATLABException("MATFrost timeout: " + std::to_string(timeout.tv_sec) + " seconds");
@@ -145,13 +422,26 @@ namespace MATFrost::Socket {
                         reinterpret_cast<char *>(data),
                         nb,
                         0);
+#else
+            // Optimistic receive, only wait for the socket when no data is pending.
+            ssize_t brn = recv(socket_fd, data, nb, MSG_DONTWAIT);
+            while (brn < 0 && would_block()) {
+                if (errno != EINTR && !wait_for_readable(timeout)) {
+                    throw matlab::engine::MATLABException("MATFrost timeout: " + std::to_string(timeout.tv_sec) + " seconds");
+                }
+                brn = recv(socket_fd, data, nb, MSG_DONTWAIT);
+            }
+#endif
+
+            stats.receive_ns += Stats::now_ns() - start;
 
             if (brn > 0) {
-                return brn;
+                stats.bytes_received += brn;
+                return static_cast<int>(brn);
             } else if (brn == 0) {
                 throw matlab::engine::MATLABException("Connection closed by peer during read");
             } else {
-                throw matlab::engine::MATLABException("Socket read error: " + std::to_string(WSAGetLastError()));
+                throw matlab::engine::MATLABException("Socket read error: " + std::to_string(last_error()));
             }
         }
 
@@ -160,6 +450,29 @@ namespace MATFrost::Socket {
                 throw matlab::engine::MATLABException("Invalid socket");
             }
 
+#ifndef _WIN32
+            pollfd pfd{socket_fd, POLLIN, 0};
+            int result;
+            do {
+                result = poll(&pfd, 1, poll_timeout_ms(time_out));
+            } while (result < 0 && errno == EINTR);
+
+            if (result < 0) {
+                throw matlab::engine::MATLABException("Socket error: " + std::to_string(last_error()));
+            }
+            if (result == 0) {
+                // Timeout
+                return false;
+            }
+            if (pfd.revents & (POLLERR | POLLNVAL)) {
+                throw matlab::engine::MATLABException("Socket error:");
+            }
+            if (pfd.revents & POLLIN) {
+                // EOF is reported by the subsequent recv.
+                return true;
+            }
+            throw matlab::engine::MATLABException("Socket - EOF connection closed");
+#else
             fd_set read_set, error_set;
             FD_ZERO(&read_set);
             FD_ZERO(&error_set);
@@ -196,6 +509,7 @@ namespace MATFrost::Socket {
                 return true;
             }
             throw matlab::engine::MATLABException("Socket error:");
+#endif
         }
 
         bool wait_for_writable(timeval time_out) const {
@@ -203,6 +517,25 @@ namespace MATFrost::Socket {
                 throw matlab::engine::MATLABException("Invalid socket");
             }
 
+#ifndef _WIN32
+            pollfd pfd{socket_fd, POLLOUT, 0};
+            int result;
+            do {
+                result = poll(&pfd, 1, poll_timeout_ms(time_out));
+            } while (result < 0 && errno == EINTR);
+
+            if (result < 0) {
+                throw matlab::engine::MATLABException("Socket error: " + std::to_string(last_error()));
+            }
+            if (result == 0) {
+                // Timeout
+                return false;
+            }
+            if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                throw matlab::engine::MATLABException("Socket error");
+            }
+            return true;
+#else
             fd_set write_set, error_set;
             FD_ZERO(&write_set);
             FD_ZERO(&error_set);
@@ -246,14 +579,132 @@ namespace MATFrost::Socket {
                 }
             }
             throw matlab::engine::MATLABException("Socket error");
+#endif
+        }
+
+
+        /**
+         * Wait until the socket is writable. Meanwhile incoming data is moved into the backlog, such that Julia never
+         * blocks on writing responses while we are blocked on writing the next request.
+         */
+        bool wait_for_writable_draining(timeval time_out) {
+            if (socket_fd == INVALID_SOCKET) {
+                throw matlab::engine::MATLABException("Invalid socket");
+            }
+
+            while (true) {
+#ifndef _WIN32
+                pollfd pfd{socket_fd, POLLIN | POLLOUT, 0};
+                int result;
+                do {
+                    result = poll(&pfd, 1, poll_timeout_ms(time_out));
+                } while (result < 0 && errno == EINTR);
+
+                if (result < 0) {
+                    throw matlab::engine::MATLABException("Socket error: " + std::to_string(last_error()));
+                }
+                if (result == 0) {
+                    return false;
+                }
+                if (pfd.revents & (POLLERR | POLLNVAL)) {
+                    throw matlab::engine::MATLABException("Socket error");
+                }
+                const bool writable = pfd.revents & POLLOUT;
+                const bool readable = pfd.revents & POLLIN;
+#else
+                fd_set read_set, write_set, error_set;
+                FD_ZERO(&read_set);
+                FD_ZERO(&write_set);
+                FD_ZERO(&error_set);
+
+                FD_SET(socket_fd, &read_set);
+                FD_SET(socket_fd, &write_set);
+                FD_SET(socket_fd, &error_set);
+
+                int result = select(0, &read_set, &write_set, &error_set, &time_out);
+
+                if (result == SOCKET_ERROR) {
+                    throw matlab::engine::MATLABException("Socket error: " + std::to_string(WSAGetLastError()));
+                }
+                if (result == 0) {
+                    return false;
+                }
+                if (FD_ISSET(socket_fd, &error_set)) {
+                    throw matlab::engine::MATLABException("Socket error");
+                }
+                const bool writable = FD_ISSET(socket_fd, &write_set);
+                const bool readable = FD_ISSET(socket_fd, &read_set);
+#endif
+                if (writable) {
+                    return true;
+                }
+                if (!readable) {
+                    throw matlab::engine::MATLABException("Socket - EOF connection closed");
+                }
+
+                const size_t n = backlog.size();
+                backlog.resize(n + input.data.size());
+                const int brn = read_from_socket(&backlog[n], input.data.size());
+                backlog.resize(n + brn);
+            }
+        }
+
+        /**
+         * Announce the shared memory region to the Julia side. A capacity of 0 disables the shared memory data plane.
+         * Handshake: [capacity u64][threshold u64][namelen u64][name]
+         */
+        void negotiate_shared_memory(const uint64_t capacity, const uint64_t threshold) {
+            if (capacity > 0) {
+                shared_memory = SharedMemory::Region::create(SharedMemory::Region::unique_name(socket_path), capacity, threshold);
+            }
+
+            const uint64_t cap = shared_memory ? shared_memory->capacity : 0;
+            const std::string name = shared_memory ? shared_memory->name : "";
+            const uint64_t namelen = name.size();
+
+            write(reinterpret_cast<const uint8_t *>(&cap), sizeof(uint64_t));
+            write(reinterpret_cast<const uint8_t *>(&threshold), sizeof(uint64_t));
+            write(reinterpret_cast<const uint8_t *>(&namelen), sizeof(uint64_t));
+            write(reinterpret_cast<const uint8_t *>(name.data()), namelen);
+            flush();
+        }
+
+        /**
+         * Handshake of the argument cache, right after the shared memory handshake: [budget]. A budget of 0 disables
+         * the cache.
+         */
+        void negotiate_cache(const uint64_t budget, const uint64_t threshold) {
+            cache.budget = budget;
+            cache.threshold = threshold;
+
+            write(reinterpret_cast<const uint8_t *>(&budget), sizeof(uint64_t));
+            flush();
         }
 
+        /**
+         * Handshake of bit packing, right after the cache handshake: [threshold]. Both sides send logical arrays of at
+         * least threshold elements bit-packed, see Bits. A threshold of 0 disables bit packing.
+         */
+        void negotiate_bit_packing(const uint64_t threshold) {
+            bit_packing = threshold;
+
+            write(reinterpret_cast<const uint8_t *>(&threshold), sizeof(uint64_t));
+            flush();
+        }
 
         bool is_connected() const {
             if (socket_fd == INVALID_SOCKET) {
                 return false;
             }
 
+#ifndef _WIN32
+            // A full send buffer is not a disconnect: with requests in flight Julia may be busy.
+            pollfd pfd{socket_fd, POLLOUT, 0};
+            if (poll(&pfd, 1, 0) < 0) {
+                return false;
+            }
+            return !(pfd.revents & (POLLERR | POLLHUP | POLLNVAL));
+#else
             fd_set write_set, error_set;
             FD_ZERO(&write_set);
             FD_ZERO(&error_set);
@@ -266,10 +717,15 @@ namespace MATFrost::Socket {
 
             int result = select(0, nullptr, &write_set, &error_set, &timeout);
 
-            if (result == SOCKET_ERROR || result == 0) {
+            if (result == SOCKET_ERROR) {
                 return false;
             }
 
+            if (result == 0) {
+                // Send buffer full, not a disconnect: with requests in flight Julia may be busy.
+                return true;
+            }
+
             // Check for errors
             if (FD_ISSET(socket_fd, &error_set)) {
                 return false;
@@ -288,41 +744,114 @@ namespace MATFrost::Socket {
             }
 
             return false;
+#endif
         }
 
 
-        static std::shared_ptr<BufferedUnixDomainSocket> connect_socket(const std::string socket_path, const std::shared_ptr<MATFrostServer> server, std::shared_ptr<matlab::engine::MATLABEngine> matlab, const long timeout_ms) {
-            if (!wsa_initialized) {
-                int rc = WSAStartup(MAKEWORD(2, 2), &wsa_data);
-                if (rc != 0) {
-                    throw(matlab::engine::MATLABException("WSAStartup failed: " + std::to_string(rc)));
+        /**
+         * Wait until any of the sockets has input. Returns the index of a readable socket, or -1 on timeout.
+         */
+        static int wait_for_any_readable(const std::vector<std::shared_ptr<BufferedUnixDomainSocket>> &sockets, timeval time_out) {
+            for (size_t i = 0; i < sockets.size(); i++) {
+                if (sockets[i]->has_buffered_input()) {
+                    return static_cast<int>(i);
+                }
+            }
+
+#ifndef _WIN32
+            std::vector<pollfd> pfds(sockets.size());
+            for (size_t i = 0; i < sockets.size(); i++) {
+                pfds[i] = pollfd{sockets[i]->socket_fd, POLLIN, 0};
+            }
+            int result;
+            do {
+                result = poll(pfds.data(), pfds.size(), poll_timeout_ms(time_out));
+            } while (result < 0 && errno == EINTR);
+
+            if (result < 0) {
+                throw matlab::engine::MATLABException("Socket error: " + std::to_string(last_error()));
+            }
+            for (size_t i = 0; i < pfds.size(); i++) {
+                if (pfds[i].revents & (POLLERR | POLLNVAL)) {
+                    throw matlab::engine::MATLABException("Socket error");
+                }
+                // EOF (POLLHUP) is reported by the subsequent recv.
+                if (pfds[i].revents & (POLLIN | POLLHUP)) {
+                    return static_cast<int>(i);
+                }
+            }
+            return -1;
+#else
+            fd_set read_set, error_set;
+            FD_ZERO(&read_set);
+            FD_ZERO(&error_set);
+
+            for (const auto &socket : sockets) {
+                FD_SET(socket->socket_fd, &read_set);
+                FD_SET(socket->socket_fd, &error_set);
+            }
+
+            int result = select(0, &read_set, nullptr, &error_set, &time_out);
+
+            if (result == SOCKET_ERROR) {
+                throw matlab::engine::MATLABException("Socket error: " + std::to_string(WSAGetLastError()));
+            }
+            for (size_t i = 0; i < sockets.size(); i++) {
+                if (FD_ISSET(sockets[i]->socket_fd, &error_set)) {
+                    throw matlab::engine::MATLABException("Socket error");
+                }
+                if (FD_ISSET(sockets[i]->socket_fd, &read_set)) {
+                    return static_cast<int>(i);
+                }
+            }
+            return -1;
+#endif
+        }
+
+        static std::shared_ptr<BufferedUnixDomainSocket> connect_socket(const std::string socket_path, const std::shared_ptr<MATFrostServer> server, std::shared_ptr<matlab::engine::MATLABEngine> matlab, const long timeout_ms, const uint64_t shared_memory_capacity, const uint64_t shared_memory_threshold, const uint64_t cache_budget, const uint64_t cache_threshold, const uint64_t bit_packing_threshold, const BufferSizes &buffer_sizes) {
+#ifdef _WIN32
+            {
+                std::lock_guard<std::mutex> wsa_lock(wsa_mutex);
+                if (!wsa_initialized) {
+                    int rc = WSAStartup(MAKEWORD(2, 2), &wsa_data);
+                    if (rc != 0) {
+                        throw(matlab::engine::MATLABException("WSAStartup failed: " + std::to_string(rc)));
+                    }
+                    wsa_initialized = true;
                 }
-                wsa_initialized = true;
             }
+#endif
 
             matlab::data::ArrayFactory factory;
 
-            SOCKADDR_UN socket_addr = {0};
+            sockaddr_un socket_addr = {};
             socket_addr.sun_family = AF_UNIX;
-            strncpy_s(socket_addr.sun_path, sizeof socket_addr.sun_path,
-                      socket_path.c_str(), socket_path.length());
+            socket_path.copy(socket_addr.sun_path, sizeof(socket_addr.sun_path) - 1);
 
 
             size_t connection_timeout_s = 3600;
-            size_t attempts = connection_timeout_s * 10;
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(connection_timeout_s);
+
+            // Retry quickly at first, a pre-started Julia is listening already. Backs off to 100 ms while Julia boots.
+            auto backoff = std::chrono::milliseconds(1);
 
-            for (int attempt = 0; attempt < attempts; attempt++) {
+            while (std::chrono::steady_clock::now() < deadline) {
 
                 if (!server->is_alive()) {
                     server->dump_logging(matlab);
                     throw(matlab::engine::MATLABException("MATFrost server not running"));
                 }
 
+#ifdef SOCK_CLOEXEC
+                // Not inherited by Julia processes spawned later on.
+                SOCKET socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+#else
                 SOCKET socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+#endif
 
                 if (socket_fd == INVALID_SOCKET) {
                     throw(matlab::engine::MATLABException("Failed to create socket: " +
-                                                         std::to_string(WSAGetLastError())));
+                                                         std::to_string(last_error())));
                 }
 
                 // Attempt connection
@@ -337,15 +866,21 @@ namespace MATFrost::Socket {
                     timeout.tv_usec = (timeout_ms % 1000) * 1000;
 
                     server->dump_logging(matlab);
-                    return std::make_shared<BufferedUnixDomainSocket>(socket_path, socket_fd, timeout, timeout_ms);
+                    auto socket = std::make_shared<BufferedUnixDomainSocket>(socket_path, socket_fd, timeout, timeout_ms);
+                    socket->configure_buffers(buffer_sizes);
+                    socket->negotiate_shared_memory(shared_memory_capacity, shared_memory_threshold);
+                    socket->negotiate_cache(cache_budget, cache_threshold);
+                    socket->negotiate_bit_packing(bit_packing_threshold);
+                    return socket;
                 }
-                closesocket(socket_fd);
+                close_socket(socket_fd);
 
                 server->dump_logging(matlab);
                 matlab->feval(u"pause", 0, std::vector<matlab::data::Array>
                     ({ factory.createScalar(0.0)})); // No-operation added to be able interrupt.
 
-                Sleep(100);
+                std::this_thread::sleep_for(backoff);
+                backoff = std::min(backoff * 2, std::chrono::milliseconds(100));
             }
             throw(matlab::engine::MATLABException("Connection timeout after " +
                                      std::to_string(connection_timeout_s) +
@@ -0,0 +1,91 @@
+/**
+ * Julia processes started ahead of time, such that START does not wait for Julia to boot.
+ *
+ * A pool holds processes for a single launch command line (Julia binary, project and bootstrap script). Each process
+ * is spawned with its own socket path and boots in the background, until it listens on its socket. START claims the
+ * oldest process, which is usually listening already, so connecting succeeds at the first attempt. The claimed process
+ * is replaced right away. Standby processes live as long as the MEX, they are stopped when it is cleared.
+ */
+#ifndef MATFROST_JL_STANDBY_HPP
+#define MATFROST_JL_STANDBY_HPP
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+
+namespace MATFrost::Standby {
+
+    /**
+     * A Julia process not yet connected, listening on socket_path once booted.
+     */
+    struct Process {
+        std::shared_ptr<MATFrostServer> server;
+        std::string socket_path;
+    };
+
+    class Pool {
+        const std::string launch;
+        const std::string socket_base;
+        const size_t log_capacity;
+        const std::string log_spill;
+
+        uint64_t spawned = 0;
+
+        std::deque<Process> processes{};
+
+        void spawn() {
+            const std::string socket_path = socket_base + ".standby." + std::to_string(++spawned);
+            processes.push_back(Process{MATFrostServer::spawn(launch + " \"" + socket_path + "\"", log_capacity, log_spill),
+                socket_path});
+        }
+
+    public:
+
+        // Number of processes kept in standby.
+        size_t target = 0;
+
+        /**
+         * Standby processes are spawned as `launch "socket_path"`, with socket paths derived from socket_base.
+         */
+        Pool(std::string launch, std::string socket_base, const size_t log_capacity, std::string log_spill) :
+            launch(std::move(launch)),
+            socket_base(std::move(socket_base)),
+            log_capacity(log_capacity),
+            log_spill(std::move(log_spill))
+        {  }
+
+        /**
+         * Spawn processes until target are in standby. Processes that exited meanwhile are dropped.
+         */
+        void fill() {
+            for (auto it = processes.begin(); it != processes.end();) {
+                it = it->server->is_alive() ? it + 1 : processes.erase(it);
+            }
+            while (processes.size() < target) {
+                spawn();
+            }
+        }
+
+        /**
+         * Take the oldest process out of the pool and spawn its replacement.
+         */
+        Process claim() {
+            fill();
+            if (processes.empty()) {
+                spawn();
+            }
+            Process process = processes.front();
+            processes.pop_front();
+            fill();
+            return process;
+        }
+
+        size_t size() const {
+            return processes.size();
+        }
+    };
+
+}
+
+#endif //MATFROST_JL_STANDBY_HPP
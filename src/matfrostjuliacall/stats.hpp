@@ -0,0 +1,190 @@
+/**
+ * Per-connection counters and latency histograms of the phases of a call:
+ *
+ * - valid:       validation and sizing of the MATLAB values of a call, a single pass (Write::measure);
+ * - serialize:   encoding of a message, excluding time blocked on the socket;
+ * - send:        time in socket send calls, including waiting for a full socket;
+ * - wait:        waiting for a response: Julia compute and transport latency;
+ * - receive:     time in socket receive calls while reading a response;
+ * - deserialize: building MATLAB arrays from a response, excluding time blocked on the socket.
+ *
+ * Phases are recorded per event: serialize and send per message written, receive and deserialize per message read,
+ * wait per wait for a response. With pipelined calls a wait may cover several calls.
+ */
+#ifndef MATFROST_JL_STATS_HPP
+#define MATFROST_JL_STATS_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace MATFrost::Stats {
+
+    enum Phase {
+        SERIALIZE,
+        SEND,
+        WAIT,
+        RECEIVE,
+        DESERIALIZE,
+        NPHASES
+    };
+
+    inline const char* phase_name(const Phase phase) {
+        switch (phase) {
+            case SERIALIZE: return "serialize";
+            case SEND: return "send";
+            case WAIT: return "wait";
+            case RECEIVE: return "receive";
+            case DESERIALIZE: return "deserialize";
+            default: return "unknown";
+        }
+    }
+
+    inline uint64_t now_ns() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    /**
+     * Histogram of durations in nanoseconds with logarithmic buckets: every power of two is split in 8 buckets, so
+     * percentiles are resolved within 12.5% at constant memory.
+     */
+    class Histogram {
+        static constexpr uint64_t SUB_BITS = 3;
+        static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BITS;
+        static constexpr size_t NBUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+        std::array<uint64_t, NBUCKETS> counts{};
+
+        static size_t bucket(const uint64_t v) {
+            if (v < SUB_BUCKETS) {
+                return static_cast<size_t>(v);
+            }
+            uint64_t msb = 0;
+            for (uint64_t w = v; w > 1; w >>= 1) {
+                msb++;
+            }
+            const uint64_t shift = msb - SUB_BITS;
+            return static_cast<size_t>(((shift + 1) << SUB_BITS) + ((v >> shift) & (SUB_BUCKETS - 1)));
+        }
+
+        static uint64_t lower_bound(const size_t b) {
+            if (b < SUB_BUCKETS) {
+                return b;
+            }
+            const uint64_t shift = (b >> SUB_BITS) - 1;
+            return (SUB_BUCKETS + (b & (SUB_BUCKETS - 1))) << shift;
+        }
+
+    public:
+        uint64_t count = 0;
+        uint64_t total = 0;
+        uint64_t max = 0;
+
+        void record(const uint64_t v) {
+            counts[bucket(v)]++;
+            count++;
+            total += v;
+            max = std::max(max, v);
+        }
+
+        /**
+         * Value below which a fraction p of the recorded values lies: the middle of its bucket, at most max.
+         */
+        uint64_t percentile(const double p) const {
+            if (count == 0) {
+                return 0;
+            }
+            const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * static_cast<double>(count) + 0.5));
+            uint64_t seen = 0;
+            for (size_t b = 0; b < NBUCKETS; b++) {
+                seen += counts[b];
+                if (seen >= rank) {
+                    const uint64_t lo = lower_bound(b);
+                    const uint64_t hi = b + 1 < NBUCKETS ? lower_bound(b + 1) : max;
+                    return std::min(max, lo + (hi - lo) / 2);
+                }
+            }
+            return max;
+        }
+    };
+
+    struct Statistics {
+        uint64_t requests = 0;
+        uint64_t responses = 0;
+
+        // Socket traffic, counted by BufferedUnixDomainSocket.
+        uint64_t bytes_sent = 0;
+        uint64_t bytes_received = 0;
+        uint64_t send_ns = 0;
+        uint64_t receive_ns = 0;
+
+        // Payload bytes through the shared memory region.
+        uint64_t shared_memory_bytes_sent = 0;
+        uint64_t shared_memory_bytes_received = 0;
+
+        // Large arguments sent as reference to the Julia cache, or in full. See Cache::ArgumentCache.
+        uint64_t cache_hits = 0;
+        uint64_t cache_misses = 0;
+        uint64_t cache_bytes_saved = 0;
+
+        // Messages sent as reference to a serialization plan, see Plans::Registry.
+        uint64_t plan_hits = 0;
+
+        std::array<Histogram, NPHASES> phases{};
+
+        void record(const Phase phase, const uint64_t ns) {
+            phases[phase].record(ns);
+        }
+    };
+
+    matlab::data::StructArray phase_struct(const Histogram &histogram) {
+        matlab::data::ArrayFactory factory;
+        matlab::data::StructArray s = factory.createStructArray({1, 1}, {"count", "total_ms", "mean_us", "p50_us", "p99_us", "max_us"});
+        s[0]["count"] = factory.createScalar<uint64_t>(histogram.count);
+        s[0]["total_ms"] = factory.createScalar<double>(static_cast<double>(histogram.total) * 1e-6);
+        s[0]["mean_us"] = factory.createScalar<double>(histogram.count == 0 ? 0.0 : static_cast<double>(histogram.total) * 1e-3 / static_cast<double>(histogram.count));
+        s[0]["p50_us"] = factory.createScalar<double>(static_cast<double>(histogram.percentile(0.5)) * 1e-3);
+        s[0]["p99_us"] = factory.createScalar<double>(static_cast<double>(histogram.percentile(0.99)) * 1e-3);
+        s[0]["max_us"] = factory.createScalar<double>(static_cast<double>(histogram.max) * 1e-3);
+        return s;
+    }
+
+    /**
+     * MATLAB struct array with the statistics of every connection.
+     */
+    matlab::data::StructArray to_struct(const std::vector<const Statistics*> &connections) {
+        std::vector<std::string> fieldnames{"requests", "responses", "bytes_sent", "bytes_received",
+            "shared_memory_bytes_sent", "shared_memory_bytes_received", "cache_hits", "cache_misses", "cache_bytes_saved", "plan_hits"};
+        for (size_t p = 0; p < NPHASES; p++) {
+            fieldnames.emplace_back(phase_name(static_cast<Phase>(p)));
+        }
+
+        matlab::data::ArrayFactory factory;
+        matlab::data::StructArray s = factory.createStructArray({1, connections.size()}, fieldnames);
+
+        for (size_t i = 0; i < connections.size(); i++) {
+            const Statistics &stats = *connections[i];
+            s[i]["requests"] = factory.createScalar<uint64_t>(stats.requests);
+            s[i]["responses"] = factory.createScalar<uint64_t>(stats.responses);
+            s[i]["bytes_sent"] = factory.createScalar<uint64_t>(stats.bytes_sent);
+            s[i]["bytes_received"] = factory.createScalar<uint64_t>(stats.bytes_received);
+            s[i]["shared_memory_bytes_sent"] = factory.createScalar<uint64_t>(stats.shared_memory_bytes_sent);
+            s[i]["shared_memory_bytes_received"] = factory.createScalar<uint64_t>(stats.shared_memory_bytes_received);
+            s[i]["cache_hits"] = factory.createScalar<uint64_t>(stats.cache_hits);
+            s[i]["cache_misses"] = factory.createScalar<uint64_t>(stats.cache_misses);
+            s[i]["cache_bytes_saved"] = factory.createScalar<uint64_t>(stats.cache_bytes_saved);
+            s[i]["plan_hits"] = factory.createScalar<uint64_t>(stats.plan_hits);
+            for (size_t p = 0; p < NPHASES; p++) {
+                s[i][phase_name(static_cast<Phase>(p))] = phase_struct(stats.phases[p]);
+            }
+        }
+        return s;
+    }
+
+}
+
+#endif //MATFROST_JL_STATS_HPP
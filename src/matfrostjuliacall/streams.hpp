@@ -0,0 +1,176 @@
+/**
+ * Streams of chunks between MATLAB and Julia, each chunk a message of its own.
+ *
+ * Results: a streaming call keeps the iterator returned by the Julia function and returns a stream ID. Every NEXT
+ * returns the next element of the iterator, a chunk. When MATLAB takes a chunk, the NEXT of the chunk after it is
+ * submitted right away: Julia computes it while MATLAB consumes the current one. At most one NEXT per stream is
+ * outstanding, a stream is never more than a chunk ahead of MATLAB.
+ *
+ * Uploads: OPEN_STREAM creates an upload in Julia, PUSH appends a chunk and CLOSE_STREAM ends it. A call taking the
+ * upload as argument consumes the chunks as they arrive. A PUSH returns once the PUSH before it is answered: MATLAB
+ * prepares the next chunk while Julia takes the current one, and is never more than a chunk ahead of Julia.
+ */
+#ifndef MATFROST_JL_STREAMS_HPP
+#define MATFROST_JL_STREAMS_HPP
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace MATFrost::Streams {
+
+    /**
+     * Command {name; argument} of streams and uploads.
+     */
+    inline matlab::data::Array command(const std::u16string &name, const matlab::data::Array &argument) {
+        matlab::data::ArrayFactory factory;
+        matlab::data::CellArray call = factory.createCellArray({2, 1});
+        call[0] = factory.createScalar(name);
+        call[1] = argument;
+        return call;
+    }
+
+    /**
+     * Whether Julia answered a command without error.
+     */
+    inline bool successful(const matlab::data::Array &result) {
+        if (result.getType() != matlab::data::ArrayType::STRUCT) {
+            return false;
+        }
+        const matlab::data::StructArray result_struct(result);
+        return static_cast<const matlab::data::StringArray>(result_struct[0]["status"])[0] == u"SUCCESFUL";
+    }
+
+    class ReadAhead {
+        // Stream ID -> request ID of the NEXT submitted ahead.
+        std::map<uint64_t, uint64_t> next_requests{};
+
+        static matlab::data::Array next_command(const uint64_t stream) {
+            matlab::data::ArrayFactory factory;
+            return command(u"NEXT", factory.createScalar<uint64_t>(stream));
+        }
+
+    public:
+
+        /**
+         * Whether a response to NEXT is a chunk, i.e. the stream may have more. False once the stream is exhausted or
+         * failed.
+         */
+        static bool has_more(const matlab::data::Array &result) {
+            if (!successful(result)) {
+                return false;
+            }
+            const matlab::data::Array value = matlab::data::StructArray(result)[0]["value"];
+            if (value.getType() != matlab::data::ArrayType::STRUCT) {
+                return false;
+            }
+            const matlab::data::Array done = matlab::data::StructArray(value)[0]["done"];
+            return done.getType() == matlab::data::ArrayType::LOGICAL &&
+                !static_cast<const matlab::data::TypedArray<bool>>(done)[0];
+        }
+
+        /**
+         * Response to NEXT of the stream: the one submitted ahead, or a new one if there is none. A NEXT abandoned by
+         * a cancel is submitted again.
+         */
+        matlab::data::Array next(const Pool::Worker &worker, const uint64_t stream, std::shared_ptr<matlab::engine::MATLABEngine> matlab) {
+            uint64_t request_id = 0;
+            auto it = next_requests.find(stream);
+            if (it != next_requests.end()) {
+                request_id = it->second;
+                next_requests.erase(it);
+            }
+            if (request_id == 0 || !worker.requests->is_known(request_id)) {
+                request_id = worker.submit(next_command(stream));
+            }
+
+            worker.await(request_id, matlab);
+            matlab::data::Array result = worker.requests->take(request_id);
+
+            if (has_more(result)) {
+                next_requests[stream] = worker.submit(next_command(stream));
+            }
+            return result;
+        }
+
+        /**
+         * Close the streams in Julia. Chunks computed ahead are dropped unseen. Returns the response to DONE.
+         */
+        matlab::data::Array done(const Pool::Worker &worker, const matlab::data::TypedArray<uint64_t> &streams, std::shared_ptr<matlab::engine::MATLABEngine> matlab) {
+            for (size_t i = 0; i < streams.getNumberOfElements(); i++) {
+                const uint64_t stream = streams[i];
+                auto it = next_requests.find(stream);
+                if (it != next_requests.end()) {
+                    worker.requests->cancel(it->second);
+                    next_requests.erase(it);
+                }
+            }
+
+            const uint64_t request_id = worker.submit(command(u"DONE", streams));
+            worker.await(request_id, matlab);
+            return worker.requests->take(request_id);
+        }
+    };
+
+    class WriteBehind {
+        // Upload ID -> request ID of the last PUSH, not yet answered.
+        std::map<uint64_t, uint64_t> push_requests{};
+
+        /**
+         * Wait for the response to the last PUSH of the upload. Returns an empty array if there is none.
+         */
+        matlab::data::Array confirm(const Pool::Worker &worker, const uint64_t upload, std::shared_ptr<matlab::engine::MATLABEngine> matlab) {
+            auto it = push_requests.find(upload);
+            if (it == push_requests.end()) {
+                return matlab::data::ArrayFactory().createArray<double>({0, 0});
+            }
+            const uint64_t request_id = it->second;
+            push_requests.erase(it);
+            if (!worker.requests->is_known(request_id)) {
+                // Abandoned by a cancel.
+                return matlab::data::ArrayFactory().createArray<double>({0, 0});
+            }
+            worker.await(request_id, matlab);
+            return worker.requests->take(request_id);
+        }
+
+    public:
+
+        /**
+         * Append the chunk to the upload. Returns the response to the PUSH before, or an empty array for the first
+         * PUSH.
+         */
+        matlab::data::Array push(const Pool::Worker &worker, const uint64_t upload, const matlab::data::Array &chunk, std::shared_ptr<matlab::engine::MATLABEngine> matlab) {
+            matlab::data::ArrayFactory factory;
+            matlab::data::CellArray call = factory.createCellArray({3, 1});
+            call[0] = factory.createScalar(std::u16string(u"PUSH"));
+            call[1] = factory.createScalar<uint64_t>(upload);
+            call[2] = chunk;
+
+            const uint64_t request_id = worker.submit(call);
+            matlab::data::Array previous = confirm(worker, upload, matlab);
+            push_requests[upload] = request_id;
+            return previous;
+        }
+
+        /**
+         * End the upload. Returns the response to the last PUSH if it failed, the response to CLOSE_STREAM otherwise.
+         */
+        matlab::data::Array close(const Pool::Worker &worker, const uint64_t upload, std::shared_ptr<matlab::engine::MATLABEngine> matlab) {
+            matlab::data::ArrayFactory factory;
+            const uint64_t request_id = worker.submit(command(u"CLOSE_STREAM", factory.createScalar<uint64_t>(upload)));
+            matlab::data::Array previous = confirm(worker, upload, matlab);
+
+            worker.await(request_id, matlab);
+            matlab::data::Array result = worker.requests->take(request_id);
+            if (!previous.isEmpty() && !successful(previous)) {
+                return previous;
+            }
+            return result;
+        }
+    };
+
+}
+
+#endif //MATFROST_JL_STREAMS_HPP
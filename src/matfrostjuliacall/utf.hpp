@@ -0,0 +1,249 @@
+/**
+ * UTF-16 <-> UTF-8 transcoding of MATLAB strings, with a vectorized fast path for ASCII.
+ *
+ * Most strings sent through MATFrost are ASCII: identifiers, names and keys. Runs of ASCII are transcoded a block at a
+ * time, 16 code units with SSE2 (see simd.hpp), otherwise 4 (UTF-16) or 8 (UTF-8) code units in a 64-bit word. Other
+ * code points are transcoded one by one. Unpaired surrogates and malformed UTF-8 become U+FFFD. Free of MATLAB
+ * dependencies.
+ */
+#ifndef MATFROST_JL_UTF_HPP
+#define MATFROST_JL_UTF_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "simd.hpp"
+
+namespace MATFrost::Utf {
+
+    constexpr char16_t REPLACEMENT = 0xFFFD;
+
+    inline bool high_surrogate(const char16_t c) {
+        return c >= 0xD800 && c < 0xDC00;
+    }
+
+    inline bool low_surrogate(const char16_t c) {
+        return c >= 0xDC00 && c < 0xE000;
+    }
+
+    /**
+     * Copy the leading ASCII run of src to dst, narrowed to bytes. Returns the length of the run. May write up to 15
+     * bytes beyond the run, dst must have room for the UTF-8 of all n code units.
+     */
+    inline size_t narrow_ascii(const char16_t *src, const size_t n, char *dst) {
+        size_t i = 0;
+#ifdef MATFROST_JL_SSE2
+        const __m128i non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= n; i += 16) {
+            const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8));
+            // 2 mask bits per code unit, set for ASCII.
+            const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(lo, non_ascii), zero))) |
+                (static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(hi, non_ascii), zero))) << 16);
+            // The 16 code units take at least 16 bytes of UTF-8: the store stays within dst.
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+            if (mask != 0xFFFFFFFF) {
+                return i + Simd::trailing_zeros(~mask) / 2;
+            }
+        }
+#endif
+        for (; i + 4 <= n; i += 4) {
+            uint64_t word;
+            std::memcpy(&word, src + i, sizeof(uint64_t));
+            if (word & 0xFF80FF80FF80FF80ULL) {
+                break;
+            }
+            dst[i] = static_cast<char>(src[i]);
+            dst[i + 1] = static_cast<char>(src[i + 1]);
+            dst[i + 2] = static_cast<char>(src[i + 2]);
+            dst[i + 3] = static_cast<char>(src[i + 3]);
+        }
+        for (; i < n && src[i] < 0x80; i++) {
+            dst[i] = static_cast<char>(src[i]);
+        }
+        return i;
+    }
+
+    /**
+     * Copy the leading ASCII run of src to dst, widened to UTF-16. Returns the length of the run. Writes nothing
+     * beyond the run.
+     */
+    inline size_t widen_ascii(const char *src, const size_t n, char16_t *dst) {
+        size_t i = 0;
+#ifdef MATFROST_JL_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= n; i += 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            if (_mm_movemask_epi8(v) != 0) {
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_unpacklo_epi8(v, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8), _mm_unpackhi_epi8(v, zero));
+        }
+#endif
+        for (; i + 8 <= n; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, src + i, sizeof(uint64_t));
+            if (word & 0x8080808080808080ULL) {
+                break;
+            }
+            for (size_t k = 0; k < 8; k++) {
+                dst[i + k] = static_cast<char16_t>(static_cast<uint8_t>(src[i + k]));
+            }
+        }
+        for (; i < n && static_cast<uint8_t>(src[i]) < 0x80; i++) {
+            dst[i] = static_cast<char16_t>(src[i]);
+        }
+        return i;
+    }
+
+    /**
+     * Number of bytes of the UTF-8 encoding of n UTF-16 code units.
+     */
+    inline size_t utf8_nbytes(const char16_t *src, const size_t n) {
+        size_t nb = 0;
+        size_t i = 0;
+#ifdef MATFROST_JL_SSE2
+        const __m128i non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+        const __m128i zero = _mm_setzero_si128();
+#endif
+        while (i < n) {
+#ifdef MATFROST_JL_SSE2
+            while (i + 8 <= n) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+                const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, non_ascii), zero)));
+                if (mask != 0xFFFF) {
+                    const size_t run = Simd::trailing_zeros(~mask) / 2;
+                    nb += run;
+                    i += run;
+                    break;
+                }
+                nb += 8;
+                i += 8;
+            }
+#endif
+            for (; i < n && src[i] < 0x80; i++) {
+                nb++;
+            }
+            if (i == n) {
+                break;
+            }
+            const char16_t c = src[i];
+            if (c < 0x800) {
+                nb += 2;
+                i++;
+            } else if (high_surrogate(c) && i + 1 < n && low_surrogate(src[i + 1])) {
+                nb += 4;
+                i += 2;
+            } else {
+                nb += 3;
+                i++;
+            }
+        }
+        return nb;
+    }
+
+    /**
+     * Transcode n UTF-16 code units to UTF-8. dst must have room for utf8_nbytes(src, n) bytes. Returns the end of the
+     * UTF-8 in dst.
+     */
+    inline char* utf16_to_utf8(const char16_t *src, const size_t n, char *dst) {
+        size_t i = 0;
+        while (i < n) {
+            const size_t run = narrow_ascii(src + i, n - i, dst);
+            i += run;
+            dst += run;
+            if (i == n) {
+                break;
+            }
+            uint32_t c = src[i++];
+            if (high_surrogate(c) && i < n && low_surrogate(src[i])) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (src[i++] - 0xDC00);
+            } else if (high_surrogate(c) || low_surrogate(c)) {
+                c = REPLACEMENT;
+            }
+            if (c < 0x800) {
+                *dst++ = static_cast<char>(0xC0 | (c >> 6));
+                *dst++ = static_cast<char>(0x80 | (c & 0x3F));
+            } else if (c < 0x10000) {
+                *dst++ = static_cast<char>(0xE0 | (c >> 12));
+                *dst++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                *dst++ = static_cast<char>(0x80 | (c & 0x3F));
+            } else {
+                *dst++ = static_cast<char>(0xF0 | (c >> 18));
+                *dst++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+                *dst++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                *dst++ = static_cast<char>(0x80 | (c & 0x3F));
+            }
+        }
+        return dst;
+    }
+
+    /**
+     * Transcode nb bytes of UTF-8 to UTF-16. dst must have room for nb code units. Returns the end of the UTF-16 in
+     * dst.
+     */
+    inline char16_t* utf8_to_utf16(const char *src, const size_t nb, char16_t *dst) {
+        const auto *s = reinterpret_cast<const uint8_t *>(src);
+        size_t i = 0;
+        while (i < nb) {
+            const size_t run = widen_ascii(src + i, nb - i, dst);
+            i += run;
+            dst += run;
+            if (i == nb) {
+                break;
+            }
+            const uint8_t lead = s[i];
+            size_t len;
+            uint32_t c;
+            uint32_t min;
+            if ((lead >> 5) == 0x6) {
+                len = 2; c = lead & 0x1F; min = 0x80;
+            } else if ((lead >> 4) == 0xE) {
+                len = 3; c = lead & 0x0F; min = 0x800;
+            } else if ((lead >> 3) == 0x1E) {
+                len = 4; c = lead & 0x07; min = 0x10000;
+            } else {
+                *dst++ = REPLACEMENT;
+                i++;
+                continue;
+            }
+            size_t k = 1;
+            for (; k < len && i + k < nb && (s[i + k] & 0xC0) == 0x80; k++) {
+                c = (c << 6) | (s[i + k] & 0x3F);
+            }
+            if (k < len || c < min || c > 0x10FFFF || (c >= 0xD800 && c < 0xE000)) {
+                // Truncated, overlong or not a code point: skip the lead byte and the continuation bytes consumed.
+                *dst++ = REPLACEMENT;
+                i += k;
+                continue;
+            }
+            i += len;
+            if (c >= 0x10000) {
+                c -= 0x10000;
+                *dst++ = static_cast<char16_t>(0xD800 + (c >> 10));
+                *dst++ = static_cast<char16_t>(0xDC00 + (c & 0x3FF));
+            } else {
+                *dst++ = static_cast<char16_t>(c);
+            }
+        }
+        return dst;
+    }
+
+    inline std::string to_utf8(const std::u16string &str) {
+        std::string out(utf8_nbytes(str.data(), str.size()), '\0');
+        utf16_to_utf8(str.data(), str.size(), &out[0]);
+        return out;
+    }
+
+    inline std::u16string to_utf16(const char *src, const size_t nb) {
+        std::u16string out(nb, u'\0');
+        out.resize(static_cast<size_t>(utf8_to_utf16(src, nb, &out[0]) - out.data()));
+        return out;
+    }
+
+}
+
+#endif //MATFROST_JL_UTF_HPP
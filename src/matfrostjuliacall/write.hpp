@@ -5,6 +5,15 @@
 // stdc++ lib
 #include <string>
 #include <complex>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "encoding.hpp"
+#include "cache.hpp"
+#include "plan.hpp"
+#include "utf.hpp"
+#include "bits.hpp"
 
 
 namespace MATFrost::Write {
@@ -12,9 +21,68 @@ namespace MATFrost::Write {
 
     void write(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const matlab::data::Array arr);
 
+    template<typename T>
+    const T* values(const matlab::data::TypedArray<T> &arr) {
+        const matlab::data::TypedIterator<const T> it(arr.begin());
+        return it.operator->();
+    }
+
+    /**
+     * MATLAB value that cannot be sent to Julia. Raised by measure before any byte of the message is written: the
+     * connection stays usable.
+     */
+    class UnsupportedType : public matlab::engine::MATLABException {
+    public:
+        using matlab::engine::MATLABException::MATLABException;
+    };
+
+    UnsupportedType unsupported_type(const matlab::data::Array &arr) {
+        std::u16string mattype;
+        switch (arr.getType()) {
+            case matlab::data::ArrayType::CHAR:
+                mattype = u"char"; break;
+            case matlab::data::ArrayType::OBJECT:
+                mattype = u"object"; break;
+            case matlab::data::ArrayType::VALUE_OBJECT:
+                mattype = u"value object"; break;
+            case matlab::data::ArrayType::HANDLE_OBJECT_REF:
+                mattype = u"handle object ref"; break;
+            case matlab::data::ArrayType::ENUM:
+                mattype = u"enum"; break;
+            default:
+                mattype = u"unknown"; break;
+        }
+        return UnsupportedType("matfrostjulia:conversion:typeNotSupported", u"MATFrost does not support conversions of MATLAB type: " + mattype);
+    }
+
+    template<typename T>
+    void write_values(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const matlab::data::TypedArray<T> arr, const bool shared) {
+        const size_t nb = sizeof(T) * arr.getNumberOfElements();
+
+        const T* vs = values<T>(arr);
+
+        if (shared) {
+            socket->shared_memory->write(reinterpret_cast<const uint8_t *>(vs), nb);
+        } else {
+            // Sent in place from the MATLAB array, see write_message.
+            socket->write_referenced(reinterpret_cast<const uint8_t *>(vs), nb);
+        }
+    }
+
+    /**
+     * Primitive arrays are sent as [type][ndims][dims][payload]. Large arrays cached by Julia are tagged CACHED or
+     * CACHE_REFERENCE and carry the digest of their payload after the dimensions; a reference has no payload.
+     */
     template<typename T>
     void write_primitive(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const matlab::data::TypedArray<T> arr) {
-        int32_t mattype = (int32_t) arr.getType();
+        const size_t nb = sizeof(T) * arr.getNumberOfElements();
+
+        uint64_t digest = 0;
+        const Cache::Mode cache = socket->cache.caches(nb) ? socket->cache.mode(values<T>(arr), nb, socket->cache.written, digest) : Cache::Mode::NONE;
+        const bool shared = cache != Cache::Mode::REFERENCE && socket->shared_memory && socket->shared_memory->writes(nb);
+
+        int32_t mattype = (int32_t) arr.getType() | (shared ? Encoding::SHARED_MEMORY : 0) |
+            (cache == Cache::Mode::FULL ? Encoding::CACHED : 0) | (cache == Cache::Mode::REFERENCE ? Encoding::CACHE_REFERENCE : 0);
         auto dims = arr.getDimensions();
         size_t ndims = dims.size();
 
@@ -22,16 +90,117 @@ namespace MATFrost::Write {
         socket->write(reinterpret_cast<const uint8_t *>(&ndims), sizeof(size_t));
         socket->write(reinterpret_cast<const uint8_t *>(dims.data()), sizeof(size_t)*ndims);
 
-        const matlab::data::TypedIterator<const T> it(arr.begin());
-        const T* vs = it.operator->();
+        if (cache != Cache::Mode::NONE) {
+            socket->write(reinterpret_cast<const uint8_t *>(&digest), sizeof(uint64_t));
+            socket->cache.use(digest, nb);
+        }
+        if (cache == Cache::Mode::REFERENCE) {
+            socket->stats.cache_hits++;
+            socket->stats.cache_bytes_saved += nb;
+            return;
+        }
+        if (cache == Cache::Mode::FULL) {
+            socket->stats.cache_misses++;
+        }
+
+        write_values<T>(socket, arr, shared);
+    }
+
+    /**
+     * Payload of a logical array, bit-packed a block at a time into the socket buffer. See Bits.
+     */
+    void write_bits(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const bool *vs, const size_t nel) {
+        uint8_t block[Bits::BLOCK_ELEMENTS / 8];
+        for (size_t i = 0; i < nel; i += Bits::BLOCK_ELEMENTS) {
+            const size_t n = std::min(Bits::BLOCK_ELEMENTS, nel - i);
+            Bits::pack(vs + i, n, block);
+            socket->write(block, Bits::packed_nbytes(n));
+        }
+    }
+
+    /**
+     * Logical arrays of at least the negotiated number of elements are sent BIT_PACKED: [type|BIT_PACKED][ndims][dims]
+     * [packed_nbytes(nel) bytes]. Arrays cached by Julia or placed in shared memory keep one byte per element, as
+     * write_primitive sends them.
+     */
+    void write_logical(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const matlab::data::TypedArray<bool> arr) {
+        const size_t nel = arr.getNumberOfElements();
+        if (!Bits::packs(socket->bit_packing, nel) || socket->cache.caches(nel) ||
+            (socket->shared_memory && socket->shared_memory->writes(nel))) {
+            return write_primitive<bool>(socket, arr);
+        }
+
+        int32_t mattype = static_cast<int32_t>(arr.getType()) | Encoding::BIT_PACKED;
+        auto dims = arr.getDimensions();
+        size_t ndims = dims.size();
+
+        socket->write(reinterpret_cast<const uint8_t *>(&mattype), sizeof(int32_t));
+        socket->write(reinterpret_cast<const uint8_t *>(&ndims), sizeof(size_t));
+        socket->write(reinterpret_cast<const uint8_t *>(dims.data()), sizeof(size_t)*ndims);
+
+        write_bits(socket, values<bool>(arr), nel);
+    }
+
+    /**
+     * Sparse matrices are sent in compressed-column form, the layout of Julia's SparseMatrixCSC with one-based indices:
+     *
+     * [type][ndims=2][rows][cols][nnz u64][colptr (cols+1) u64][rowval nnz u64][nzval nnz]
+     *
+     * The size scales with the nonzeros, not with rows*cols. MATLAB hands out the nonzeros by iteration only, the
+     * three arrays are assembled in a single pass and copied to the socket. They are never cached, placed in shared
+     * memory or sent by plan.
+     */
+    template<typename T>
+    void write_sparse(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const matlab::data::SparseArray<T> arr) {
+        int32_t mattype = static_cast<int32_t>(arr.getType());
+        auto dims = arr.getDimensions();
+        size_t ndims = dims.size();
+        const uint64_t nnz = arr.getNumberOfNonZeroElements();
+
+        socket->write(reinterpret_cast<const uint8_t *>(&mattype), sizeof(int32_t));
+        socket->write(reinterpret_cast<const uint8_t *>(&ndims), sizeof(size_t));
+        socket->write(reinterpret_cast<const uint8_t *>(dims.data()), sizeof(size_t)*ndims);
+        socket->write(reinterpret_cast<const uint8_t *>(&nnz), sizeof(uint64_t));
+
+        // Nonzeros iterate in column-major order: count per column, then accumulate into column pointers.
+        std::vector<uint64_t> colptr(dims[1] + 1, 0);
+        std::vector<uint64_t> rowval(nnz);
+        std::unique_ptr<T[]> nzval(new T[nnz]);
+        size_t i = 0;
+        for (auto it = arr.begin(); it != arr.end(); ++it, ++i) {
+            const matlab::data::SparseIndex index = arr.getIndex(it);
+            rowval[i] = index.first + 1;
+            colptr[index.second + 1]++;
+            nzval[i] = *it;
+        }
+        colptr[0] = 1;
+        for (size_t c = 1; c < colptr.size(); c++) {
+            colptr[c] += colptr[c - 1];
+        }
 
-        socket->write(reinterpret_cast<const uint8_t *>(vs), (sizeof(T) * arr.getNumberOfElements()));
+        socket->write(reinterpret_cast<const uint8_t *>(colptr.data()), sizeof(uint64_t)*colptr.size());
+        socket->write(reinterpret_cast<const uint8_t *>(rowval.data()), sizeof(uint64_t)*nnz);
+        socket->write(reinterpret_cast<const uint8_t *>(nzval.get()), sizeof(T)*nnz);
+    }
 
+    // String arrays of at least this many elements are sent PACKED, see write_string.
+    constexpr size_t PACKED_MIN_STRINGS = 2;
 
+    inline bool packed(const size_t nel) {
+        return nel >= PACKED_MIN_STRINGS;
     }
 
+    /**
+     * String arrays are sent as [type][ndims][dims] followed by every string as [nbytes][UTF-8]. Arrays of at least
+     * PACKED_MIN_STRINGS strings are tagged PACKED and send an offsets table and all strings back to back instead:
+     *
+     * [type|PACKED][ndims][dims][offsets (nel+1) u64][UTF-8 blob]
+     *
+     * The blob is transcoded in place and written at once, see Utf::utf16_to_utf8.
+     */
     void write_string(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const matlab::data::StringArray strarr) {
-        int32_t mattype = static_cast<int32_t>(strarr.getType());
+        const size_t nel = strarr.getNumberOfElements();
+        int32_t mattype = static_cast<int32_t>(strarr.getType()) | (packed(nel) ? Encoding::PACKED : 0);
         auto dims = strarr.getDimensions();
         size_t ndims = dims.size();
 
@@ -39,33 +208,234 @@ namespace MATFrost::Write {
         socket->write(reinterpret_cast<const uint8_t *>(&ndims), sizeof(size_t));
         socket->write(reinterpret_cast<const uint8_t *>(dims.data()), sizeof(size_t)*ndims);
 
-        for (const matlab::data::MATLABString matstr: strarr) {
-            std::string str(matlab::engine::convertUTF16StringToUTF8String(matstr));
-            size_t strlen = str.size();
-            socket->write(reinterpret_cast<const uint8_t *>(&strlen), sizeof(size_t));
-            socket->write(reinterpret_cast<const uint8_t *>(str.data()), str.size());
+        if (!packed(nel)) {
+            for (const matlab::data::MATLABString &matstr: strarr) {
+                const std::string str(Utf::to_utf8(*matstr));
+                size_t strlen = str.size();
+                socket->write(reinterpret_cast<const uint8_t *>(&strlen), sizeof(size_t));
+                socket->write(reinterpret_cast<const uint8_t *>(str.data()), str.size());
+            }
+            return;
+        }
+
+        // Sized first, such that the blob is allocated once and transcoded into directly.
+        std::vector<uint64_t> offsets(nel + 1);
+        offsets[0] = 0;
+        size_t i = 0;
+        for (const matlab::data::MATLABString &matstr: strarr) {
+            const std::u16string &str = *matstr;
+            offsets[i + 1] = offsets[i] + Utf::utf8_nbytes(str.data(), str.size());
+            i++;
         }
 
+        std::unique_ptr<char[]> blob(new char[offsets[nel]]);
+        i = 0;
+        for (const matlab::data::MATLABString &matstr: strarr) {
+            const std::u16string &str = *matstr;
+            Utf::utf16_to_utf8(str.data(), str.size(), blob.get() + offsets[i++]);
+        }
+
+        socket->write(reinterpret_cast<const uint8_t *>(offsets.data()), sizeof(uint64_t)*offsets.size());
+        socket->write(reinterpret_cast<const uint8_t *>(blob.get()), offsets[nel]);
     }
 
 
-    void write_cell(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const matlab::data::CellArray mcarr) {
-        int32_t mattype = static_cast<int32_t>(mcarr.getType());
-        auto dims = mcarr.getDimensions();
+    std::vector<std::string> fieldnames(const matlab::data::StructArray msarr) {
+        std::vector<std::string> fns{};
+        for (auto fieldname : msarr.getFieldNames()) {
+            fns.emplace_back(fieldname);
+        }
+        return fns;
+    }
+
+    /**
+     * Elements of a cell array, or the values of a single field of a struct array, in element order.
+     */
+    using Column = std::vector<matlab::data::Array>;
+
+    Column cell_column(const matlab::data::CellArray mcarr) {
+        Column column{};
+        column.reserve(mcarr.getNumberOfElements());
+        for (const matlab::data::Array arr: mcarr) {
+            column.push_back(arr);
+        }
+        return column;
+    }
+
+    /**
+     * Largest element of a columnar column. Larger elements gain nothing from sharing a header and are sent one by one,
+     * such that they can be cached individually, see Cache::ArgumentCache.
+     */
+    constexpr size_t COLUMNAR_MAX_ELEMENT_NBYTES = 1 << 16;
+
+    /**
+     * Whether the column is sent with the columnar encoding: at least two non-empty primitive arrays, all of the same
+     * type and dimensions, of at most COLUMNAR_MAX_ELEMENT_NBYTES. See Encoding::COLUMNAR.
+     */
+    bool columnar(const Column &column) {
+        if (column.size() < 2) {
+            return false;
+        }
+        const matlab::data::ArrayType type = column[0].getType();
+        const matlab::data::ArrayDimensions dims = column[0].getDimensions();
+        const size_t nb = Encoding::element_size(type) * column[0].getNumberOfElements();
+        if (nb == 0 || nb > COLUMNAR_MAX_ELEMENT_NBYTES) {
+            return false;
+        }
+        for (const auto &arr : column) {
+            if (arr.getType() != type || arr.getDimensions() != dims) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Payload bytes of a columnar column.
+     */
+    inline size_t column_nbytes(const Column &column) {
+        return Encoding::element_size(column[0].getType()) * column[0].getNumberOfElements() * column.size();
+    }
+
+    /**
+     * Columns of a struct array, one per field. Empty if the struct array is sent element by element: a struct array
+     * is sent by column if it has at least two elements and at least one of its fields is columnar.
+     */
+    std::vector<Column> struct_columns(const matlab::data::StructArray msarr, const std::vector<std::string> &fns) {
+        std::vector<Column> columns{};
+        if (msarr.getNumberOfElements() < 2) {
+            return columns;
+        }
+        columns.resize(fns.size());
+        for (auto &column : columns) {
+            column.reserve(msarr.getNumberOfElements());
+        }
+        // Values of a struct iterate in field order, no need to look up fields by name.
+        for (const matlab::data::Struct mats: msarr) {
+            size_t fi = 0;
+            for (const matlab::data::Array arr: mats) {
+                columns[fi++].push_back(arr);
+            }
+        }
+        for (const auto &column : columns) {
+            if (columnar(column)) {
+                return columns;
+            }
+        }
+        columns.clear();
+        return columns;
+    }
+
+    template<typename T>
+    void write_column_values(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const Column &column, const bool shared) {
+        for (const matlab::data::Array &arr : column) {
+            write_values<T>(socket, arr, shared);
+        }
+    }
+
+    /**
+     * Write a column as a cell array of dimensions dims. A columnar column is tagged CELL | COLUMNAR and followed by a
+     * single header for all elements and their payloads back to back:
+     *
+     * [CELL|COLUMNAR][ndims][dims][type][elem ndims][elem dims][payload 1]...[payload n]
+     *
+     * The payloads go to shared memory as a whole. Other columns are sent as a regular cell array.
+     */
+    void write_column(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const matlab::data::ArrayDimensions &dims, const Column &column) {
+        const bool col = columnar(column);
+
+        int32_t mattype = static_cast<int32_t>(matlab::data::ArrayType::CELL) | (col ? Encoding::COLUMNAR : 0);
         size_t ndims = dims.size();
 
         socket->write(reinterpret_cast<const uint8_t *>(&mattype), sizeof(int32_t));
         socket->write(reinterpret_cast<const uint8_t *>(&ndims), sizeof(size_t));
         socket->write(reinterpret_cast<const uint8_t *>(dims.data()), sizeof(size_t)*ndims);
 
+        if (!col) {
+            for (const matlab::data::Array &arr: column) {
+                write(socket, arr);
+            }
+            return;
+        }
 
-        for (const matlab::data::Array arr: mcarr) {
-            write(socket, arr);
+        const bool shared = socket->shared_memory && socket->shared_memory->writes(column_nbytes(column));
+
+        int32_t elemtype = static_cast<int32_t>(column[0].getType()) | (shared ? Encoding::SHARED_MEMORY : 0);
+        auto elemdims = column[0].getDimensions();
+        size_t elemndims = elemdims.size();
+
+        socket->write(reinterpret_cast<const uint8_t *>(&elemtype), sizeof(int32_t));
+        socket->write(reinterpret_cast<const uint8_t *>(&elemndims), sizeof(size_t));
+        socket->write(reinterpret_cast<const uint8_t *>(elemdims.data()), sizeof(size_t)*elemndims);
+
+        switch (column[0].getType()) {
+            case matlab::data::ArrayType::LOGICAL:
+                return write_column_values<bool>(socket, column, shared);
+
+            case matlab::data::ArrayType::SINGLE:
+                return write_column_values<float>(socket, column, shared);
+            case matlab::data::ArrayType::DOUBLE:
+                return write_column_values<double>(socket, column, shared);
+
+            case matlab::data::ArrayType::INT8:
+                return write_column_values<int8_t>(socket, column, shared);
+            case matlab::data::ArrayType::UINT8:
+                return write_column_values<uint8_t>(socket, column, shared);
+            case matlab::data::ArrayType::INT16:
+                return write_column_values<int16_t>(socket, column, shared);
+            case matlab::data::ArrayType::UINT16:
+                return write_column_values<uint16_t>(socket, column, shared);
+            case matlab::data::ArrayType::INT32:
+                return write_column_values<int32_t>(socket, column, shared);
+            case matlab::data::ArrayType::UINT32:
+                return write_column_values<uint32_t>(socket, column, shared);
+            case matlab::data::ArrayType::INT64:
+                return write_column_values<int64_t>(socket, column, shared);
+            case matlab::data::ArrayType::UINT64:
+                return write_column_values<uint64_t>(socket, column, shared);
+
+            case matlab::data::ArrayType::COMPLEX_SINGLE:
+                return write_column_values<std::complex<float>>(socket, column, shared);
+            case matlab::data::ArrayType::COMPLEX_DOUBLE:
+                return write_column_values<std::complex<double>>(socket, column, shared);
+
+            case matlab::data::ArrayType::COMPLEX_UINT8:
+                return write_column_values<std::complex<uint8_t>>(socket, column, shared);
+            case matlab::data::ArrayType::COMPLEX_INT8:
+                return write_column_values<std::complex<int8_t>>(socket, column, shared);
+            case matlab::data::ArrayType::COMPLEX_UINT16:
+                return write_column_values<std::complex<uint16_t>>(socket, column, shared);
+            case matlab::data::ArrayType::COMPLEX_INT16:
+                return write_column_values<std::complex<int16_t>>(socket, column, shared);
+            case matlab::data::ArrayType::COMPLEX_UINT32:
+                return write_column_values<std::complex<uint32_t>>(socket, column, shared);
+            case matlab::data::ArrayType::COMPLEX_INT32:
+                return write_column_values<std::complex<int32_t>>(socket, column, shared);
+            case matlab::data::ArrayType::COMPLEX_UINT64:
+                return write_column_values<std::complex<uint64_t>>(socket, column, shared);
+            case matlab::data::ArrayType::COMPLEX_INT64:
+                return write_column_values<std::complex<int64_t>>(socket, column, shared);
+
+            default:
+                throw matlab::engine::MATLABException("matfrostjulia:conversion:typeNotSupported", u"MATFrost does not support columnar conversion of this MATLAB type");
         }
     }
 
+    void write_cell(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const matlab::data::CellArray mcarr) {
+        write_column(socket, mcarr.getDimensions(), cell_column(mcarr));
+    }
+
+    /**
+     * Struct arrays are sent element by element, values in field order per element. Struct arrays with columnar
+     * fields are tagged STRUCT | COLUMNAR and sent field by field instead: every field as a column, see write_column.
+     */
     void write_struct(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const matlab::data::StructArray msarr) {
-        int32_t mattype = static_cast<int32_t>(msarr.getType());
+        const std::vector<std::string> fns = fieldnames(msarr);
+        uint64_t schema;
+        const bool reference = socket->schemas.intern(fns, schema);
+        const std::vector<Column> columns = struct_columns(msarr, fns);
+
+        int32_t mattype = static_cast<int32_t>(msarr.getType()) | (reference ? Encoding::SCHEMA_REFERENCE : 0) | (columns.empty() ? 0 : Encoding::COLUMNAR);
         auto dims = msarr.getDimensions();
         size_t ndims = dims.size();
 
@@ -73,14 +443,23 @@ namespace MATFrost::Write {
         socket->write(reinterpret_cast<const uint8_t *>(&ndims), sizeof(size_t));
         socket->write(reinterpret_cast<const uint8_t *>(dims.data()), sizeof(size_t)*ndims);
 
+        if (reference) {
+            socket->write(reinterpret_cast<const uint8_t *>(&schema), sizeof(uint64_t));
+        } else {
+            size_t nfields = fns.size();
+            socket->write((uint8_t*) &nfields, sizeof(size_t));
+            for (const auto &fn : fns) {
+                size_t fnlen = fn.size();
+                socket->write(reinterpret_cast<const uint8_t *>(&fnlen), sizeof(size_t));
+                socket->write(reinterpret_cast<const uint8_t *>(fn.data()), fn.size());
+            }
+        }
 
-        size_t nfields = msarr.getNumberOfFields();
-        socket->write((uint8_t*) &nfields, sizeof(size_t));
-        for (auto fieldname : msarr.getFieldNames()) {
-            std::string fn(fieldname);
-            size_t fnlen = fn.size();
-            socket->write(reinterpret_cast<const uint8_t *>(&fnlen), sizeof(size_t));
-            socket->write(reinterpret_cast<const uint8_t *>(fn.data()), fn.size());
+        if (!columns.empty()) {
+            for (const auto &column : columns) {
+                write_column(socket, dims, column);
+            }
+            return;
         }
 
         for (const matlab::data::Struct mats: msarr){
@@ -102,7 +481,7 @@ namespace MATFrost::Write {
              case matlab::data::ArrayType::MATLAB_STRING:
                  return write_string(socket, arr);
              case matlab::data::ArrayType::LOGICAL:
-                 return write_primitive<bool>(socket, arr);
+                 return write_logical(socket, arr);
 
              case matlab::data::ArrayType::SINGLE:
                  return write_primitive<float>(socket, arr);
@@ -148,117 +527,431 @@ namespace MATFrost::Write {
              case matlab::data::ArrayType::COMPLEX_INT64:
                  return write_primitive<std::complex<int64_t>>(socket, arr);
 
+             case matlab::data::ArrayType::SPARSE_LOGICAL:
+                 return write_sparse<bool>(socket, arr);
+             case matlab::data::ArrayType::SPARSE_DOUBLE:
+                 return write_sparse<double>(socket, arr);
+             case matlab::data::ArrayType::SPARSE_COMPLEX_DOUBLE:
+                 return write_sparse<std::complex<double>>(socket, arr);
+
              // Unspported
              default:
-                 std::u16string mattype;
-                 switch (arr.getType()) {
-                     case matlab::data::ArrayType::CHAR:
-                         mattype = u"char"; break;
-                     case matlab::data::ArrayType::OBJECT:
-                         mattype = u"object"; break;
-                     case matlab::data::ArrayType::VALUE_OBJECT:
-                         mattype = u"value object"; break;
-                     case matlab::data::ArrayType::HANDLE_OBJECT_REF:
-                         mattype = u"handle object ref"; break;
-                     case matlab::data::ArrayType::ENUM:
-                         mattype = u"enum"; break;
-                     case matlab::data::ArrayType::SPARSE_LOGICAL:
-                         mattype = u"sparse logical"; break;
-                     case matlab::data::ArrayType::SPARSE_DOUBLE:
-                         mattype = u"sparse double"; break;
-                     case matlab::data::ArrayType::SPARSE_COMPLEX_DOUBLE:
-                         mattype = u"sparse complex double"; break;
-                     default:
-                         mattype = u"unknown"; break;
-
-                 }
-                 throw matlab::engine::MATLABException("matfrostjulia:conversion:typeNotSupported", u"MATFrost does not support conversions of MATLAB type: " + mattype);
+                 throw unsupported_type(arr);
 
          }
     }
 
-    bool valid(const matlab::data::Array arr);
+    /**
+     * Pointer to the payload of a primitive array.
+     */
+    const void* primitive_values(const matlab::data::Array &arr) {
+        switch (arr.getType()) {
+            case matlab::data::ArrayType::LOGICAL: return values<bool>(arr);
+            case matlab::data::ArrayType::SINGLE: return values<float>(arr);
+            case matlab::data::ArrayType::DOUBLE: return values<double>(arr);
+            case matlab::data::ArrayType::INT8: return values<int8_t>(arr);
+            case matlab::data::ArrayType::UINT8: return values<uint8_t>(arr);
+            case matlab::data::ArrayType::INT16: return values<int16_t>(arr);
+            case matlab::data::ArrayType::UINT16: return values<uint16_t>(arr);
+            case matlab::data::ArrayType::INT32: return values<int32_t>(arr);
+            case matlab::data::ArrayType::UINT32: return values<uint32_t>(arr);
+            case matlab::data::ArrayType::INT64: return values<int64_t>(arr);
+            case matlab::data::ArrayType::UINT64: return values<uint64_t>(arr);
+            case matlab::data::ArrayType::COMPLEX_SINGLE: return values<std::complex<float>>(arr);
+            case matlab::data::ArrayType::COMPLEX_DOUBLE: return values<std::complex<double>>(arr);
+            case matlab::data::ArrayType::COMPLEX_UINT8: return values<std::complex<uint8_t>>(arr);
+            case matlab::data::ArrayType::COMPLEX_INT8: return values<std::complex<int8_t>>(arr);
+            case matlab::data::ArrayType::COMPLEX_UINT16: return values<std::complex<uint16_t>>(arr);
+            case matlab::data::ArrayType::COMPLEX_INT16: return values<std::complex<int16_t>>(arr);
+            case matlab::data::ArrayType::COMPLEX_UINT32: return values<std::complex<uint32_t>>(arr);
+            case matlab::data::ArrayType::COMPLEX_INT32: return values<std::complex<int32_t>>(arr);
+            case matlab::data::ArrayType::COMPLEX_UINT64: return values<std::complex<uint64_t>>(arr);
+            case matlab::data::ArrayType::COMPLEX_INT64: return values<std::complex<int64_t>>(arr);
+            default: return nullptr;
+        }
+    }
 
-    bool valid_struct(const matlab::data::StructArray msarr) {
+    /**
+     * Bytes of a sparse matrix following its header, see write_sparse.
+     */
+    size_t sparse_nbytes(const matlab::data::Array &arr) {
+        size_t nnz;
+        size_t element_size;
+        switch (arr.getType()) {
+            case matlab::data::ArrayType::SPARSE_LOGICAL:
+                nnz = static_cast<const matlab::data::SparseArray<bool>>(arr).getNumberOfNonZeroElements();
+                element_size = sizeof(bool);
+                break;
+            case matlab::data::ArrayType::SPARSE_DOUBLE:
+                nnz = static_cast<const matlab::data::SparseArray<double>>(arr).getNumberOfNonZeroElements();
+                element_size = sizeof(double);
+                break;
+            default:
+                nnz = static_cast<const matlab::data::SparseArray<std::complex<double>>>(arr).getNumberOfNonZeroElements();
+                element_size = sizeof(std::complex<double>);
+                break;
+        }
+        return sizeof(uint64_t) * (1 + arr.getDimensions()[1] + 1 + nnz) + element_size * nnz;
+    }
 
-        for (const matlab::data::Struct mats: msarr){
-            for (const matlab::data::Array arr: mats) {
-                valid(arr);
-            }
+    inline size_t header_nbytes(const size_t ndims) {
+        return sizeof(int32_t) + sizeof(size_t) + sizeof(size_t)*ndims;
+    }
+
+    inline size_t header_nbytes(const matlab::data::Array arr) {
+        return header_nbytes(arr.getDimensions().size());
+    }
+
+    /**
+     * Payload of which the encoding depends on the state of the connection: a primitive array, which may be cached by
+     * Julia, placed in shared memory or bit-packed if logical, or the payloads of a columnar column (data nullptr),
+     * placed in shared memory as a whole.
+     */
+    struct Unit {
+        const void* data;
+        size_t nbytes;
+        bool logical = false;
+    };
+
+    /**
+     * Result of the single pass over a message before it is written, see measure:
+     * - fixed: the bytes on the socket independent of the connection state: headers, schemas and strings;
+     * - units: the payloads, their bytes on the socket are decided when writing, see socket_nbytes;
+     * - plan: the layout and payloads of the message, see Plans::Plan;
+     * - sparse: whether the message holds sparse matrices, of which the structure is not part of the layout. Such
+     *   messages are never sent by plan.
+     */
+    struct Layout {
+        uint64_t fixed = 0;
+        std::vector<Unit> units{};
+        Plans::Plan plan{};
+        Encoding::Schemas schemas{};
+        bool sparse = false;
+    };
+
+    void measure(const matlab::data::Array &arr, Layout &layout, const bool sized);
+
+    /**
+     * Header of a column, see write_column. A columnar column adds the element header and its payloads as a single
+     * unit, its elements are not sized individually. Returns whether the column is columnar.
+     */
+    bool measure_column(const size_t ndims, const Column &column, Layout &layout) {
+        layout.fixed += header_nbytes(ndims);
+        if (!columnar(column)) {
+            return false;
         }
+        layout.fixed += header_nbytes(column[0]);
+        layout.units.push_back(Unit{nullptr, column_nbytes(column)});
         return true;
     }
 
-    bool valid_cell(const matlab::data::CellArray mcarr) {
-        for (const matlab::data::Array arr: mcarr) {
-            valid(arr);
+    /**
+     * Validate, size and lay out an array. The plan is built depth first: cells in element order, structs element by
+     * element. Sizes are order independent: every distinct schema and cached payload is sent in full once, whichever
+     * occurrence comes first.
+     */
+    void measure(const matlab::data::Array &arr, Layout &layout, const bool sized) {
+        Plans::Plan &plan = layout.plan;
+        const int32_t type = static_cast<int32_t>(arr.getType());
+        const auto dims = arr.getDimensions();
+        const size_t ndims = dims.size();
+        plan.append(type);
+        plan.append(ndims);
+        plan.append(dims.data(), sizeof(size_t)*ndims);
+
+        switch (arr.getType()) {
+            case matlab::data::ArrayType::CELL: {
+                const Column column = cell_column(arr);
+                const bool col = measure_column(ndims, column, layout);
+                for (const matlab::data::Array &el : column) {
+                    measure(el, layout, !col);
+                }
+                return;
+            }
+            case matlab::data::ArrayType::STRUCT: {
+                const matlab::data::StructArray msarr(arr);
+                const std::vector<std::string> fns = fieldnames(msarr);
+                plan.append(fns.size());
+                for (const auto &fn : fns) {
+                    plan.append(fn.size());
+                    plan.append(fn.data(), fn.size());
+                }
+
+                layout.fixed += header_nbytes(ndims);
+                uint64_t schema;
+                if (layout.schemas.intern(fns, schema)) {
+                    layout.fixed += sizeof(uint64_t);
+                } else {
+                    layout.fixed += sizeof(size_t);
+                    for (const auto &fn : fns) {
+                        layout.fixed += sizeof(size_t) + fn.size();
+                    }
+                }
+
+                const std::vector<Column> columns = struct_columns(msarr, fns);
+                if (columns.empty()) {
+                    for (const matlab::data::Struct mats : msarr) {
+                        for (const matlab::data::Array el : mats) {
+                            measure(el, layout, true);
+                        }
+                    }
+                    return;
+                }
+                std::vector<bool> col(columns.size());
+                for (size_t fi = 0; fi < columns.size(); fi++) {
+                    col[fi] = measure_column(ndims, columns[fi], layout);
+                }
+                for (size_t i = 0; i < msarr.getNumberOfElements(); i++) {
+                    for (size_t fi = 0; fi < columns.size(); fi++) {
+                        measure(columns[fi][i], layout, !col[fi]);
+                    }
+                }
+                return;
+            }
+            case matlab::data::ArrayType::MATLAB_STRING: {
+                // Strings are part of the layout: function names and other call metadata. The layout only has to
+                // tell strings apart, it holds them as UTF-16.
+                const matlab::data::StringArray strarr(arr);
+                layout.fixed += header_nbytes(ndims) + (packed(strarr.getNumberOfElements()) ? sizeof(uint64_t) : 0);
+                for (const matlab::data::MATLABString &matstr : strarr) {
+                    const std::u16string &str = *matstr;
+                    layout.fixed += sizeof(size_t) + Utf::utf8_nbytes(str.data(), str.size());
+                    plan.append(str.size());
+                    plan.append(str.data(), sizeof(char16_t)*str.size());
+                }
+                return;
+            }
+            case matlab::data::ArrayType::SPARSE_LOGICAL:
+            case matlab::data::ArrayType::SPARSE_DOUBLE:
+            case matlab::data::ArrayType::SPARSE_COMPLEX_DOUBLE: {
+                layout.fixed += header_nbytes(ndims) + sparse_nbytes(arr);
+                layout.sparse = true;
+                return;
+            }
+            default: {
+                if (Encoding::element_size(arr.getType()) == 0) {
+                    throw unsupported_type(arr);
+                }
+                const size_t nb = Encoding::element_size(arr.getType()) * arr.getNumberOfElements();
+                if (nb == 0) {
+                    if (sized) {
+                        layout.fixed += header_nbytes(ndims);
+                    }
+                    return;
+                }
+                const void* data = primitive_values(arr);
+                const bool logical = arr.getType() == matlab::data::ArrayType::LOGICAL;
+                if (sized) {
+                    layout.fixed += header_nbytes(ndims);
+                    layout.units.push_back(Unit{data, nb, logical});
+                }
+                plan.payloads.push_back(Plans::Payload{data, nb, logical});
+                return;
+            }
+        }
+    }
+
+    /**
+     * Validate and lay out a message in a single pass. Throws UnsupportedType for values that cannot be sent.
+     */
+    Layout measure(const matlab::data::Array &arr) {
+        Layout layout{};
+        measure(arr, layout, true);
+        return layout;
+    }
+
+    /**
+     * Cache encoding of every unit, as write_primitive will decide. Columnar columns are not cached.
+     */
+    std::vector<Cache::Mode> cache_modes(const Layout &layout, Cache::ArgumentCache &cache) {
+        std::vector<Cache::Mode> modes(layout.units.size(), Cache::Mode::NONE);
+        std::set<uint64_t> cached{};
+        for (size_t i = 0; i < layout.units.size(); i++) {
+            const Unit &unit = layout.units[i];
+            if (unit.data != nullptr && cache.caches(unit.nbytes)) {
+                uint64_t digest;
+                modes[i] = cache.mode(unit.data, unit.nbytes, cached, digest);
+            }
+        }
+        return modes;
+    }
+
+    /**
+     * Total number of payload bytes which will be placed in shared memory. Must mirror the decision in write_primitive
+     * and write_column.
+     */
+    size_t shared_memory_nbytes(const Layout &layout, const std::vector<Cache::Mode> &modes, const uint64_t threshold) {
+        size_t nb = 0;
+        for (size_t i = 0; i < layout.units.size(); i++) {
+            if (modes[i] != Cache::Mode::REFERENCE && layout.units[i].nbytes >= threshold) {
+                nb += layout.units[i].nbytes;
+            }
+        }
+        return nb;
+    }
+
+    /**
+     * Number of bytes write puts on the socket, given whether a shared memory block is available and the bit packing
+     * threshold. Must mirror write.
+     */
+    size_t socket_nbytes(const Layout &layout, const std::vector<Cache::Mode> &modes, const bool shared_memory, const uint64_t threshold, const uint64_t bit_packing) {
+        size_t nb = layout.fixed;
+        for (size_t i = 0; i < layout.units.size(); i++) {
+            const Unit &unit = layout.units[i];
+            if (modes[i] != Cache::Mode::NONE) {
+                nb += sizeof(uint64_t);
+            }
+            if (modes[i] != Cache::Mode::REFERENCE && !(shared_memory && unit.nbytes >= threshold)) {
+                const bool bits = unit.logical && modes[i] == Cache::Mode::NONE && Bits::packs(bit_packing, unit.nbytes);
+                nb += bits ? Bits::packed_nbytes(unit.nbytes) : unit.nbytes;
+            }
+        }
+        return nb;
+    }
+
+    /**
+     * Whether a message may be sent by plan: none of its payloads is cached by Julia.
+     */
+    bool plannable(const Plans::Plan &plan, const Cache::ArgumentCache &cache) {
+        for (const auto &payload : plan.payloads) {
+            if (cache.caches(payload.nbytes)) {
+                return false;
+            }
         }
         return true;
     }
 
-    bool valid(const matlab::data::Array arr) {
-        switch (arr.getType()) {
-             case matlab::data::ArrayType::CELL:
-                 return valid_cell(arr);
-             case matlab::data::ArrayType::STRUCT:
-                return valid_struct(arr);
+    /**
+     * Write a message by reference to a serialization plan, see Plans::Registry:
+     *
+     * [request_id u64][nbytes u64][offset u64][advance u64][type|PLAN_REFERENCE][ndims][dims][plan id u64][threshold u64][payloads]
+     *
+     * Payloads of at least threshold bytes are placed in shared memory, threshold is UINT64_MAX without a block. Logical
+     * payloads on the socket are bit-packed as write_logical would, Julia derives this from the plan and the negotiated
+     * threshold.
+     */
+    void write_plan_message(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const uint64_t request_id, const matlab::data::Array arr, const Plans::Plan &plan, const uint64_t plan_id) {
+        SharedMemory::Block block{};
+        uint64_t threshold = UINT64_MAX;
+        if (socket->shared_memory) {
+            uint64_t shared = 0;
+            for (const auto &payload : plan.payloads) {
+                shared += payload.nbytes >= socket->shared_memory->threshold ? payload.nbytes : 0;
+            }
+            block = socket->shared_memory->begin_write(shared);
+            socket->stats.shared_memory_bytes_sent += block.nbytes;
+            if (block.active) {
+                threshold = socket->shared_memory->threshold;
+            }
+        }
 
-             case matlab::data::ArrayType::MATLAB_STRING:
+        uint64_t nbytes = header_nbytes(arr) + 2*sizeof(uint64_t);
+        for (const auto &payload : plan.payloads) {
+            if (payload.nbytes < threshold) {
+                nbytes += (payload.logical && Bits::packs(socket->bit_packing, payload.nbytes)) ? Bits::packed_nbytes(payload.nbytes) : payload.nbytes;
+            }
+        }
 
-             case matlab::data::ArrayType::LOGICAL:
+        socket->observe_message(nbytes);
 
-             case matlab::data::ArrayType::SINGLE:
-             case matlab::data::ArrayType::DOUBLE:
+        socket->write(reinterpret_cast<const uint8_t *>(&request_id), sizeof(uint64_t));
+        socket->write(reinterpret_cast<const uint8_t *>(&nbytes), sizeof(uint64_t));
+        socket->write(reinterpret_cast<const uint8_t *>(&block.offset), sizeof(uint64_t));
+        socket->write(reinterpret_cast<const uint8_t *>(&block.advance), sizeof(uint64_t));
 
-             case matlab::data::ArrayType::INT8:
-             case matlab::data::ArrayType::UINT8:
-             case matlab::data::ArrayType::INT16:
-             case matlab::data::ArrayType::UINT16:
-             case matlab::data::ArrayType::INT32:
-             case matlab::data::ArrayType::UINT32:
-             case matlab::data::ArrayType::INT64:
-             case matlab::data::ArrayType::UINT64:
+        int32_t mattype = static_cast<int32_t>(arr.getType()) | Encoding::PLAN_REFERENCE;
+        auto dims = arr.getDimensions();
+        size_t ndims = dims.size();
+        socket->write(reinterpret_cast<const uint8_t *>(&mattype), sizeof(int32_t));
+        socket->write(reinterpret_cast<const uint8_t *>(&ndims), sizeof(size_t));
+        socket->write(reinterpret_cast<const uint8_t *>(dims.data()), sizeof(size_t)*ndims);
+        socket->write(reinterpret_cast<const uint8_t *>(&plan_id), sizeof(uint64_t));
+        socket->write(reinterpret_cast<const uint8_t *>(&threshold), sizeof(uint64_t));
+
+        for (const auto &payload : plan.payloads) {
+            if (payload.nbytes >= threshold) {
+                socket->shared_memory->write(reinterpret_cast<const uint8_t *>(payload.data), payload.nbytes);
+            } else if (payload.logical && Bits::packs(socket->bit_packing, payload.nbytes)) {
+                write_bits(socket, static_cast<const bool *>(payload.data), payload.nbytes);
+            } else {
+                socket->write_referenced(reinterpret_cast<const uint8_t *>(payload.data), payload.nbytes);
+            }
+        }
+        socket->cache.end_message();
+        socket->stats.plan_hits++;
 
-             case matlab::data::ArrayType::COMPLEX_SINGLE:
-             case matlab::data::ArrayType::COMPLEX_DOUBLE:
+        if (socket->shared_memory) {
+            socket->shared_memory->end_write();
+        }
+        socket->flush();
+    }
 
-             case matlab::data::ArrayType::COMPLEX_UINT8:
-             case matlab::data::ArrayType::COMPLEX_INT8:
-             case matlab::data::ArrayType::COMPLEX_UINT16:
-             case matlab::data::ArrayType::COMPLEX_INT16:
-             case matlab::data::ArrayType::COMPLEX_UINT32:
-             case matlab::data::ArrayType::COMPLEX_INT32:
-             case matlab::data::ArrayType::COMPLEX_UINT64:
-             case matlab::data::ArrayType::COMPLEX_INT64:
-                 return true;
+    /**
+     * Write a complete message. A message is prefixed by:
+     * - the request ID, which Julia echoes in its response;
+     * - the number of bytes of the array on the socket, such that a message can be skipped without decoding it;
+     * - the descriptor of its shared memory block, offset and advance are zero if the payloads are sent over the socket.
+     *
+     * [request_id u64][nbytes u64][offset u64][advance u64][array]
+     *
+     * Struct field names are interned per message, see Encoding::Schemas. Large primitive arrays Julia holds already
+     * are sent by digest, see Cache::ArgumentCache. Messages with a repeated layout are sent by plan, see
+     * Plans::Registry: the array of a message defining a plan is preceded by [type|PLAN][ndims][dims][plan id u64].
+     *
+     * The layout is the result of measure on arr: the sizes follow from it without walking the array again.
+     *
+     * Payloads on the socket are sent in place from the MATLAB arrays with vectored sends, see
+     * BufferedUnixDomainSocket::write_referenced. The message is flushed before returning, while arr is alive.
+     */
+    void write_message(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const uint64_t request_id, const matlab::data::Array arr, const Layout &layout) {
+        uint64_t plan_id = 0;
+        const Plans::Use use = (socket->plans.enabled && !layout.sparse && plannable(layout.plan, socket->cache)) ?
+            socket->plans.use(layout.plan.layout, plan_id) : Plans::Use::NONE;
+        if (use == Plans::Use::REFERENCE) {
+            return write_plan_message(socket, request_id, arr, layout.plan, plan_id);
+        }
 
-             // Unspported
-             default:
-                 std::u16string mattype;
-                 switch (arr.getType()) {
-                     case matlab::data::ArrayType::CHAR:
-                         mattype = u"char"; break;
-                     case matlab::data::ArrayType::OBJECT:
-                         mattype = u"object"; break;
-                     case matlab::data::ArrayType::VALUE_OBJECT:
-                         mattype = u"value object"; break;
-                     case matlab::data::ArrayType::HANDLE_OBJECT_REF:
-                         mattype = u"handle object ref"; break;
-                     case matlab::data::ArrayType::ENUM:
-                         mattype = u"enum"; break;
-                     case matlab::data::ArrayType::SPARSE_LOGICAL:
-                         mattype = u"sparse logical"; break;
-                     case matlab::data::ArrayType::SPARSE_DOUBLE:
-                         mattype = u"sparse double"; break;
-                     case matlab::data::ArrayType::SPARSE_COMPLEX_DOUBLE:
-                         mattype = u"sparse complex double"; break;
-                     default:
-                         mattype = u"unknown"; break;
-
-                 }
-                 throw matlab::engine::MATLABException("matfrostjulia:conversion:typeNotSupported", u"MATFrost does not support conversions of MATLAB type: " + mattype);
+        const std::vector<Cache::Mode> modes = cache_modes(layout, socket->cache);
+        const uint64_t threshold = socket->shared_memory ? socket->shared_memory->threshold : 0;
 
-         }
+        SharedMemory::Block block{};
+        if (socket->shared_memory) {
+            block = socket->shared_memory->begin_write(shared_memory_nbytes(layout, modes, threshold));
+            socket->stats.shared_memory_bytes_sent += block.nbytes;
+        }
+
+        const uint64_t nbytes = socket_nbytes(layout, modes, block.active, threshold, socket->bit_packing) +
+            (use == Plans::Use::DEFINE ? header_nbytes(arr) + sizeof(uint64_t) : 0);
+
+        socket->observe_message(nbytes);
+
+        socket->write(reinterpret_cast<const uint8_t *>(&request_id), sizeof(uint64_t));
+        socket->write(reinterpret_cast<const uint8_t *>(&nbytes), sizeof(uint64_t));
+        socket->write(reinterpret_cast<const uint8_t *>(&block.offset), sizeof(uint64_t));
+        socket->write(reinterpret_cast<const uint8_t *>(&block.advance), sizeof(uint64_t));
+
+        if (use == Plans::Use::DEFINE) {
+            int32_t mattype = static_cast<int32_t>(arr.getType()) | Encoding::PLAN;
+            auto dims = arr.getDimensions();
+            size_t ndims = dims.size();
+            socket->write(reinterpret_cast<const uint8_t *>(&mattype), sizeof(int32_t));
+            socket->write(reinterpret_cast<const uint8_t *>(&ndims), sizeof(size_t));
+            socket->write(reinterpret_cast<const uint8_t *>(dims.data()), sizeof(size_t)*ndims);
+            socket->write(reinterpret_cast<const uint8_t *>(&plan_id), sizeof(uint64_t));
+        }
+
+        socket->schemas.written.clear();
+        write(socket, arr);
+        socket->cache.end_message();
+
+        if (socket->shared_memory) {
+            socket->shared_memory->end_write();
+        }
+        socket->flush();
+    }
+
+    void write_message(const std::shared_ptr<Socket::BufferedUnixDomainSocket> socket, const uint64_t request_id, const matlab::data::Array arr) {
+        write_message(socket, request_id, arr, measure(arr));
     }
 
 }
@@ -22,6 +22,18 @@ classdef matfrostjulia < handle & matlab.mixin.indexing.RedefinesDot
         project           (1,1) string
         socket            (1,1) string
         timeout           (1,1) uint64
+        sharedmemory      (1,1) uint64
+        sharedmemorythreshold (1,1) uint64
+        workers           (1,1) uint64
+        argumentcache     (1,1) uint64
+        argumentcachethreshold (1,1) uint64
+        bitpackthreshold  (1,1) uint64
+        logbuffer         (1,1) uint64
+        logfile           (1,1) string
+        socketbuffer      (1,1) uint64
+        socketkernelbuffer (1,1) uint64
+        adaptivebuffers   (1,1) logical
+        standby           (1,1) uint64
     end
 
     properties (Constant)
@@ -42,15 +54,60 @@ classdef matfrostjulia < handle & matlab.mixin.indexing.RedefinesDot
                 argstruct.socket      (1,1) string = string(tempname) + ".sock"
 
                 argstruct.timeout     (1,1) uint64 = 24*60*60*1000 % 1day
+
+                argstruct.sharedmemory (1,1) uint64 = 256*2^20
+                    % Capacity in bytes of each shared memory ring used for large arrays. 0 disables shared memory.
+                argstruct.sharedmemorythreshold (1,1) uint64 = 2^20
+                    % Arrays of at least this many bytes are transferred through shared memory.
+                argstruct.workers     (1,1) uint64 {mustBePositive} = 1
+                    % Number of Julia processes. Regular calls use the first, map distributes over all of them.
+                argstruct.argumentcache (1,1) uint64 = 0
+                    % Budget in bytes of the Julia cache of large arguments. An argument Julia holds already is sent
+                    % as a short reference. 0 disables the cache.
+                argstruct.argumentcachethreshold (1,1) uint64 {mustBePositive} = 2^20
+                    % Numeric and logical arrays of at least this many bytes are cached.
+                argstruct.bitpackthreshold (1,1) uint64 = 2^16
+                    % Logical arrays of at least this many elements are sent over the socket 8 elements per byte, in
+                    % both directions. 0 disables bit packing.
+                argstruct.logbuffer   (1,1) uint64 {mustBePositive} = 2^20
+                    % Capacity in bytes of the buffer of Julia output not yet displayed. When full the oldest output
+                    % is dropped.
+                argstruct.logfile     (1,1) string = ""
+                    % If set, Julia output overflowing the buffer is appended to this file instead of dropped.
+                argstruct.socketbuffer (1,1) uint64 {mustBePositive} = 2^16
+                    % Size in bytes of the input and output buffers of each connection, at least 4096.
+                argstruct.socketkernelbuffer (1,1) uint64 = 0
+                    % Size in bytes of the kernel send and receive buffers of each connection. 0 keeps the OS default.
+                argstruct.adaptivebuffers (1,1) logical = false
+                    % Grow the buffers of a connection to the largest message sent or received, up to 4 MiB.
+                argstruct.standby     (1,1) uint64 = 0
+                    % Number of Julia processes with the same version and project started ahead of time. The next
+                    % matfrostjulia claims a process that booted already. 0 disables standby processes.
             end
             
             obj.id = uint64(randi(1e9, 'int32'));
             obj.socket = argstruct.socket;
             obj.timeout = argstruct.timeout;
             obj.project = argstruct.project;
+            obj.sharedmemory = argstruct.sharedmemory;
+            obj.sharedmemorythreshold = argstruct.sharedmemorythreshold;
+            obj.workers = argstruct.workers;
+            obj.argumentcache = argstruct.argumentcache;
+            obj.argumentcachethreshold = argstruct.argumentcachethreshold;
+            obj.bitpackthreshold = argstruct.bitpackthreshold;
+            obj.logbuffer = argstruct.logbuffer;
+            obj.logfile = argstruct.logfile;
+            obj.socketbuffer = argstruct.socketbuffer;
+            obj.socketkernelbuffer = argstruct.socketkernelbuffer;
+            obj.adaptivebuffers = argstruct.adaptivebuffers;
+            obj.standby = argstruct.standby;
 
             if isfield(argstruct, 'bindir')
-                obj.julia = """" + fullfile(bindir, "julia.exe") + """";
+                if ispc
+                    obj.julia = """" + fullfile(argstruct.bindir, "julia.exe") + """";
+                else
+                    obj.julia = """" + fullfile(argstruct.bindir, "julia") + """";
+                end
             elseif isfield(argstruct, 'version')
                 obj.julia = "julia +" + argstruct.version;
             else
@@ -61,6 +118,197 @@ classdef matfrostjulia < handle & matlab.mixin.indexing.RedefinesDot
 
         end
 
+        function request = callasync(obj, fully_qualified_name, varargin)
+            % Submit a call to Julia without waiting for the result. Returns a request handle for poll, wait and
+            % fetch. MATLAB can prepare the next call while Julia computes.
+            %
+            %   request = jl.callasync("MATFrost.Example.multiply_scalar_vector_f64", 5.0, [1.0; 4.0]);
+            %   ...
+            %   v = jl.fetch(request);
+            callstruct = obj.createcallstruct(fully_qualified_name, varargin);
+            callstruct.action = "CALL_ASYNC";
+            request = obj.mexcall(callstruct);
+        end
+
+        function done = poll(obj, request)
+            % True if the result of the request has been received. Does not block.
+            arguments
+                obj
+                request (1,1) uint64
+            end
+            done = obj.mexcall(obj.requeststruct("POLL", request));
+        end
+
+        function wait(obj, request)
+            % Block until the result of the request has been received.
+            arguments
+                obj
+                request (1,1) uint64
+            end
+            obj.mexcall(obj.requeststruct("WAIT", request));
+        end
+
+        function value = fetch(obj, request)
+            % Wait for and return the result of the request. The request handle is released afterwards.
+            % For a matfrostjuliahandle, return the Julia value it refers to. The handle stays valid.
+            arguments
+                obj
+                request (1,1)
+            end
+            if isa(request, "matfrostjuliahandle")
+                value = obj.unpackresult(obj.mexcall(obj.handlestruct("FETCH", request.id)));
+            else
+                value = obj.unpackresult(obj.mexcall(obj.requeststruct("FETCH", uint64(request))));
+            end
+        end
+
+        function h = callhandle(obj, fully_qualified_name, varargin)
+            % Call a Julia function and keep the result in Julia. Returns a matfrostjuliahandle, which can be passed
+            % as argument to later calls without transferring the value back and forth.
+            %
+            %   h = jl.callhandle("Package1.initialize", n);
+            %   for k = 1:100
+            %       hnext = jl.callhandle("Package1.step", h);
+            %       jl.release(h);
+            %       h = hnext;
+            %   end
+            %   x = jl.fetch(h);
+            callstruct = obj.createcallstruct(fully_qualified_name, varargin);
+            callstruct.callstruct = [callstruct.callstruct; {"HANDLE"}];
+            v = obj.unpackresult(obj.mexcall(callstruct));
+            h = matfrostjuliahandle(v.matfrost_handle, v.type);
+        end
+
+        function release(obj, handles)
+            % Free the Julia values of the handles. All handles are freed when the matfrostjulia object is deleted.
+            arguments
+                obj
+                handles matfrostjuliahandle
+            end
+            obj.unpackresult(obj.mexcall(obj.handlestruct("RELEASE", reshape(uint64([handles.id]), [], 1))));
+        end
+
+        function s = callstream(obj, fully_qualified_name, varargin)
+            % Call a Julia function returning an iterator, e.g. a generator or a Channel, and stream its elements.
+            % Returns a matfrostjuliastream. Every element is a chunk transferred on its own: Julia computes the next
+            % chunk while MATLAB consumes the current one, neither side holds the whole sequence.
+            %
+            %   s = jl.callstream("Package1.simulate", n);
+            %   while hasdata(s)
+            %       chunk = read(s);
+            %   end
+            callstruct = obj.createcallstruct(fully_qualified_name, varargin);
+            callstruct.callstruct = [callstruct.callstruct; {"STREAM"}];
+            v = obj.unpackresult(obj.mexcall(callstruct));
+            s = matfrostjuliastream(obj, v.matfrost_stream, v.type);
+        end
+
+        function u = openstream(obj)
+            % Open an upload: a stream of chunks pushed to Julia one at a time. Returns a matfrostjuliaupload, which
+            % is passed as argument to a Julia function taking a MATFrost.UploadStream{T}. Data larger than memory,
+            % e.g. read from a datastore, is fed to Julia without materializing it in MATLAB.
+            %
+            %   u = jl.openstream();
+            %   request = jl.callasync("Package1.total", u);
+            %   while hasdata(ds)
+            %       push(u, read(ds));
+            %   end
+            %   close(u);
+            %   total = jl.fetch(request);
+            v = obj.unpackresult(obj.mexcall(obj.actionstruct("OPEN_STREAM")));
+            u = matfrostjuliaupload(obj, v.matfrost_upload);
+        end
+
+        function results = map(obj, fully_qualified_name, argtuples, options)
+            % Call the function for every argument tuple, distributed over the Julia workers. Returns a cell array of
+            % the same size as argtuples. Each tuple is a cell array of arguments, any other value is a single argument.
+            %
+            %   jl = matfrostjulia(workers=4);
+            %   results = jl.map("MATFrost.Example.multiply_f64", {{1.0, 2.0}, {3.0, 4.0}, {5.0, 6.0}});
+            arguments
+                obj
+                fully_qualified_name (1,1) string
+                argtuples cell
+                options.signature string
+            end
+            if isfield(options, "signature")
+                signatureargs = {"signature", options.signature};
+            else
+                signatureargs = {};
+            end
+
+            callstructs = cell(size(argtuples));
+            for k = 1:numel(argtuples)
+                args = argtuples{k};
+                if ~iscell(args)
+                    args = {args};
+                end
+                c = obj.createcallstruct(fully_qualified_name, [reshape(args, 1, []), signatureargs]);
+                callstructs{k} = c.callstruct;
+            end
+
+            mapstruct = struct;
+            mapstruct.id = obj.id;
+            mapstruct.action = "MAP";
+            mapstruct.callstructs = callstructs;
+            results = cellfun(@(r) obj.unpackresult(r), obj.mexcall(mapstruct), UniformOutput=false);
+        end
+
+        function text = logs(obj)
+            % Julia output not yet displayed, one string per worker. Output is otherwise displayed at the next call.
+            text = obj.mexcall(obj.actionstruct("LOGS"));
+        end
+
+        function s = stats(obj)
+            % Counters and latency percentiles of the calls since the start or the last reset_stats, one element per
+            % worker. Every phase (serialize, send, wait, receive, deserialize) reports count, total_ms, mean_us,
+            % p50_us, p99_us and max_us. Wait includes the time Julia computes.
+            %
+            %   s = jl.stats();
+            %   s(1).wait.p99_us
+            s = obj.mexcall(obj.actionstruct("STATS"));
+        end
+
+        function reset_stats(obj)
+            % Reset the counters and latencies reported by stats.
+            obj.mexcall(obj.actionstruct("RESET_STATS"));
+        end
+
+    end
+
+    methods (Access={?matfrostjuliastream, ?matfrostjuliaupload})
+
+        function v = streamnext(obj, stream)
+            % Next chunk of the stream as struct with fields done and chunk.
+            s = obj.actionstruct("NEXT");
+            s.stream = stream;
+            v = obj.unpackresult(obj.mexcall(s));
+        end
+
+        function streamdone(obj, streams)
+            % Free the Julia iterators of the streams.
+            s = obj.actionstruct("DONE");
+            s.streams = reshape(uint64(streams), [], 1);
+            obj.unpackresult(obj.mexcall(s));
+        end
+
+        function uploadpush(obj, upload, chunk)
+            % Append the chunk to the upload. Errors of the push before are thrown here.
+            s = obj.actionstruct("PUSH");
+            s.upload = upload;
+            s.chunk = chunk;
+            previous = obj.mexcall(s);
+            if ~isempty(previous)
+                obj.unpackresult(previous);
+            end
+        end
+
+        function uploadclose(obj, upload)
+            % End the upload.
+            s = obj.actionstruct("CLOSE_STREAM");
+            s.upload = upload;
+            obj.unpackresult(obj.mexcall(s));
+        end
 
     end
 
@@ -78,13 +326,27 @@ classdef matfrostjulia < handle & matlab.mixin.indexing.RedefinesDot
 
             bootstrap = fullfile(fileparts(mfilename("fullpath")), "bootstrap.jl");
 
+            sockets = [obj.socket, obj.socket + "." + (2:double(obj.workers))];
+
             createstruct = struct;
             createstruct.id = obj.id;
             createstruct.action = "START";
             createstruct.socket = obj.socket;
             createstruct.timeout = obj.timeout;
-            createstruct.cmdline = sprintf("%s %s ""%s"" ""%s""", obj.julia, project_cmdline, bootstrap, obj.socket);
-            createstruct.socket = obj.socket;
+            createstruct.sharedmemory = obj.sharedmemory;
+            createstruct.sharedmemorythreshold = obj.sharedmemorythreshold;
+            createstruct.argumentcache = obj.argumentcache;
+            createstruct.argumentcachethreshold = obj.argumentcachethreshold;
+            createstruct.bitpackthreshold = obj.bitpackthreshold;
+            createstruct.logbuffer = obj.logbuffer;
+            createstruct.logfile = obj.logfile;
+            createstruct.socketbuffer = obj.socketbuffer;
+            createstruct.socketkernelbuffer = obj.socketkernelbuffer;
+            createstruct.adaptivebuffers = obj.adaptivebuffers;
+            createstruct.standby = obj.standby;
+            createstruct.launch = obj.julia + " " + project_cmdline + " """ + bootstrap + """";
+            createstruct.cmdline = createstruct.launch + " """ + sockets + """";
+            createstruct.socket = sockets;
             
             if obj.USE_MEXHOST
                 obj.mh.feval("matfrostjuliacall", createstruct);
@@ -93,7 +355,60 @@ classdef matfrostjulia < handle & matlab.mixin.indexing.RedefinesDot
             end
         end
 
+        function callstruct = createcallstruct(obj, fully_qualified_name, args)
+            % Remove any name-value pair for 'signature' from the call-site indices so
+            % that parseArguments only sees the real positional arguments.
+            [arguments, signature] = parseArguments(args{:});
+            % Handles are sent as reference, Julia substitutes the value. Uploads are passed as reference as well.
+            for k = 1:numel(arguments)
+                if isa(arguments{k}, "matfrostjuliahandle")
+                    arguments{k} = struct("matfrost_handle", arguments{k}.id);
+                elseif isa(arguments{k}, "matfrostjuliaupload")
+                    arguments{k} = struct("matfrost_upload", arguments{k}.id);
+                end
+            end
+            callstruct.id = obj.id;
+            callstruct.action = "CALL";
+            callmeta.fully_qualified_name = string(fully_qualified_name);
+            callmeta.signature = signature;
+            callstruct.callstruct = {callmeta; arguments(:)};
+        end
 
+        function s = actionstruct(obj, action)
+            s = struct;
+            s.id = obj.id;
+            s.action = action;
+        end
+
+        function s = handlestruct(obj, command, handles)
+            s = struct;
+            s.id = obj.id;
+            s.action = "CALL";
+            s.callstruct = {command; handles};
+        end
+
+        function s = requeststruct(obj, action, request)
+            s = struct;
+            s.id = obj.id;
+            s.action = action;
+            s.request = request;
+        end
+
+        function out = mexcall(obj, s)
+            if obj.USE_MEXHOST
+                if nargout > 0
+                    out = obj.mh.feval("matfrostjuliacall", s);
+                else
+                    obj.mh.feval("matfrostjuliacall", s);
+                end
+            else
+                if nargout > 0
+                    out = matfrostjuliacall(s);
+                else
+                    matfrostjuliacall(s);
+                end
+            end
+        end
 
         function delete(obj)
 
@@ -116,24 +431,15 @@ classdef matfrostjulia < handle & matlab.mixin.indexing.RedefinesDot
                 throw(MException("matfrostjulia:invalidCallSignature", "Call signature is missing parentheses."));
             end
             fully_qualified_name_arr = arrayfun(@(in) string(in.Name), indexOp(1:end-1));
-            % Remove any name-value pair for 'signature' from the call-site indices so
-            % that parseArguments only sees the real positional arguments.
-            [arguments, signature] = parseArguments( indexOp(end).Indices{:} );
             % This is the object being sent to MATLAB 
-            callstruct.id = obj.id;
-            callstruct.action = "CALL";
-            callmeta.fully_qualified_name = join(fully_qualified_name_arr, ".");
-            callmeta.signature = signature;
-            callstruct.callstruct = {callmeta; arguments(:)};
+            callstruct = obj.createcallstruct(join(fully_qualified_name_arr, "."), indexOp(end).Indices);
 
-            if obj.USE_MEXHOST
-                jlo = obj.mh.feval("matfrostjuliacall", callstruct);
-            else
-                jlo = matfrostjuliacall(callstruct);
-            end
-            
+            varargout{1} = obj.unpackresult(obj.mexcall(callstruct));
+        end
+
+        function value = unpackresult(~, jlo)
             if jlo.status == "SUCCESFUL"
-                varargout{1} = jlo.value;
+                value = jlo.value;
             elseif jlo.status =="ERROR"
                 v = jlo.value;
 
@@ -143,37 +449,6 @@ classdef matfrostjulia < handle & matlab.mixin.indexing.RedefinesDot
                     throw(MException("matfrostjulia:error", v))
                 end
             end
-
-            function [args, signature] = parseArguments(varargin)
-                % Elegant argument parsing using inputParser and validateSignature
-                
-                p = inputParser;p.KeepUnmatched=true;
-                addParameter(p, 'signature', [], @(x) validateSignature(x));
-                firstParameter = find(cellfun(@(x) isstring(x)&&isscalar(x)&&any(ismember(x,string(p.Parameters))), varargin),1);
-                if isempty(firstParameter)
-                    args = varargin; signature = [];
-                else
-                    parse(p, varargin{firstParameter:end});
-                    args = varargin(1:firstParameter-1);
-                    if validateSignature(p.Results.signature,numel(args))
-                        signature = p.Results.signature;
-                    end
-                end
-                
-                function ok = validateSignature(x, nArgs)
-                    if nargin>1 && numel(x) ~= nArgs
-                        throw(MException("matfrostjulia:invalidSignatureSize", ...
-                            "Cannot parse 'signature': number of signature entries (%d) does not equal number of arguments (%d).", ...
-                            numel(x), nArgs))
-                    elseif ~isstring(x)
-                        throw(MException("matfrostjulia:invalidSignature", ...
-                        "Cannot parse 'signature': all signature entries must be strings. Got: %s", ...
-                        evalc('disp(x)')))
-                    end
-                    ok = true;
-                end
-            end
-                
         end
 
         function obj = dotAssign(obj,indexOp,varargin)
@@ -186,3 +461,33 @@ classdef matfrostjulia < handle & matlab.mixin.indexing.RedefinesDot
         end
     end
 end
+
+function [args, signature] = parseArguments(varargin)
+    % Elegant argument parsing using inputParser and validateSignature
+    
+    p = inputParser;p.KeepUnmatched=true;
+    addParameter(p, 'signature', [], @(x) validateSignature(x));
+    firstParameter = find(cellfun(@(x) isstring(x)&&isscalar(x)&&any(ismember(x,string(p.Parameters))), varargin),1);
+    if isempty(firstParameter)
+        args = varargin; signature = [];
+    else
+        parse(p, varargin{firstParameter:end});
+        args = varargin(1:firstParameter-1);
+        if validateSignature(p.Results.signature,numel(args))
+            signature = p.Results.signature;
+        end
+    end
+    
+    function ok = validateSignature(x, nArgs)
+        if nargin>1 && numel(x) ~= nArgs
+            throw(MException("matfrostjulia:invalidSignatureSize", ...
+                "Cannot parse 'signature': number of signature entries (%d) does not equal number of arguments (%d).", ...
+                numel(x), nArgs))
+        elseif ~isstring(x)
+            throw(MException("matfrostjulia:invalidSignature", ...
+            "Cannot parse 'signature': all signature entries must be strings. Got: %s", ...
+            evalc('disp(x)')))
+        end
+        ok = true;
+    end
+end
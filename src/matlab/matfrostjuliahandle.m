@@ -0,0 +1,23 @@
+classdef matfrostjuliahandle
+% matfrostjuliahandle - Reference to a Julia value kept by the MATFrost server
+%
+% Returned by matfrostjulia.callhandle. Pass it as argument to later calls to use the value without transferring it,
+% matfrostjulia.fetch returns the value and matfrostjulia.release frees it. A handle is valid until it is released or
+% the matfrostjulia object is deleted. Handles belong to the first worker: they cannot be used by map over several
+% workers.
+
+    properties (SetAccess=immutable)
+        id                (1,1) uint64
+        type              (1,1) string
+            % Julia type of the value.
+    end
+
+    methods
+        function obj = matfrostjuliahandle(id, type)
+            if nargin > 0
+                obj.id = id;
+                obj.type = type;
+            end
+        end
+    end
+end
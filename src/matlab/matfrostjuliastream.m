@@ -0,0 +1,90 @@
+classdef matfrostjuliastream < handle
+% matfrostjuliastream - Elements of an iterator returned by a Julia function, streamed chunk by chunk
+%
+% Returned by matfrostjulia.callstream. Every element of the Julia iterator is a chunk, transferred as a message of
+% its own. Once a chunk is read, Julia computes the next one while MATLAB consumes it.
+%
+%   s = jl.callstream("Package1.simulate", n);
+%   while hasdata(s)
+%       chunk = read(s);
+%   end
+%
+% close, or deleting the stream, frees the Julia iterator before it is exhausted. A Julia error while computing a chunk
+% is thrown by hasdata or read, and ends the stream. Streams belong to the first worker.
+
+    properties (SetAccess=immutable)
+        id                (1,1) uint64
+        type              (1,1) string
+            % Julia type of the iterator.
+    end
+
+    properties (Access=private)
+        jl
+        chunk             = {}
+            % Chunk received by hasdata and not yet read.
+        finished          (1,1) logical = false
+    end
+
+    methods
+        function obj = matfrostjuliastream(jl, id, type)
+            obj.jl = jl;
+            obj.id = id;
+            obj.type = type;
+        end
+
+        function tf = hasdata(obj)
+            % True if the stream has another chunk. Waits for the chunk to arrive.
+            if isempty(obj.chunk) && ~obj.finished
+                try
+                    v = streamnext(obj.jl, obj.id);
+                catch e
+                    if ~any(e.identifier == ["matfrostjulia:call:cancelled", "matfrostjulia:call:timeout"])
+                        % Julia error: the stream has been removed.
+                        obj.finished = true;
+                    end
+                    rethrow(e);
+                end
+                if v.done
+                    obj.finished = true;
+                else
+                    obj.chunk = {v.chunk};
+                end
+            end
+            tf = ~isempty(obj.chunk);
+        end
+
+        function chunk = read(obj)
+            % Next chunk of the stream.
+            if ~hasdata(obj)
+                throw(MException("matfrostjulia:stream:noData", "Stream %d has no more chunks.", obj.id));
+            end
+            chunk = obj.chunk{1};
+            obj.chunk = {};
+        end
+
+        function chunks = readall(obj)
+            % All remaining chunks, as cell array.
+            chunks = {};
+            while hasdata(obj)
+                chunks{end+1, 1} = read(obj); %#ok<AGROW>
+            end
+        end
+
+        function close(obj)
+            % Free the Julia iterator. Chunks not yet read are dropped.
+            if ~obj.finished && isvalid(obj.jl)
+                streamdone(obj.jl, obj.id);
+            end
+            obj.finished = true;
+            obj.chunk = {};
+        end
+
+        function delete(obj)
+            try
+                close(obj);
+            catch
+                % The connection is gone, and the iterator with it.
+            end
+        end
+    end
+end
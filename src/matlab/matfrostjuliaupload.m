@@ -0,0 +1,59 @@
+classdef matfrostjuliaupload < handle
+% matfrostjuliaupload - Stream of chunks uploaded to Julia
+%
+% Returned by matfrostjulia.openstream. push appends a chunk, close ends the upload. Pass the upload as argument to a
+% Julia function taking a MATFrost.UploadStream{T}: it iterates over the chunks, converted to T, as they arrive. Call
+% the function with callasync before pushing to consume the chunks while they are uploaded.
+%
+%   u = jl.openstream();
+%   request = jl.callasync("Package1.total", u);
+%   for k = 1:n
+%       push(u, rand(1e6, 1));
+%   end
+%   close(u);
+%   total = jl.fetch(request);
+%
+% push returns once Julia has taken the chunk before: MATLAB prepares the next chunk while Julia receives the current
+% one. Chunks pushed while no call consumes the upload are kept by Julia until taken. Uploads belong to the first
+% worker.
+
+    properties (SetAccess=immutable)
+        id                (1,1) uint64
+    end
+
+    properties (Access=private)
+        jl
+        closed            (1,1) logical = false
+    end
+
+    methods
+        function obj = matfrostjuliaupload(jl, id)
+            obj.jl = jl;
+            obj.id = id;
+        end
+
+        function push(obj, chunk)
+            % Append a chunk to the upload.
+            if obj.closed
+                throw(MException("matfrostjulia:upload:closed", "Upload %d is closed.", obj.id));
+            end
+            uploadpush(obj.jl, obj.id, chunk);
+        end
+
+        function close(obj)
+            % End the upload. The consuming call sees the end after the last chunk.
+            if ~obj.closed && isvalid(obj.jl)
+                obj.closed = true;
+                uploadclose(obj.jl, obj.id);
+            end
+        end
+
+        function delete(obj)
+            try
+                close(obj);
+            catch
+                % The connection is gone, and the upload with it.
+            end
+        end
+    end
+end
@@ -0,0 +1,38 @@
+module _Plans
+
+using .._Types
+
+"""
+Serialization plans of repeated message layouts. Julia side of `Plans::Registry` in `plan.hpp`.
+
+A message tagged `ENCODING_PLAN` carries a plan ID and the array in full, its structure becomes the template of the
+plan. A message tagged `ENCODING_PLAN_REFERENCE` carries only the plan ID and the payloads of the primitive arrays,
+depth first; the array is a copy of the template filled with them. See `read_matfrostarray_plan!`.
+"""
+mutable struct Plans
+    templates::Vector{MATFrostArrayAbstract}
+end
+
+Plans() = Plans(MATFrostArrayAbstract[])
+
+"""
+Template of a plan: the structure of the array, primitive arrays without their values.
+"""
+function plan_template(@nospecialize(marr::MATFrostArrayAbstract))::MATFrostArrayAbstract
+    if marr isa MATFrostArrayCell
+        MATFrostArrayCell(marr.dims, MATFrostArrayAbstract[plan_template(v) for v in marr.values])
+    elseif marr isa MATFrostArrayStruct
+        MATFrostArrayStruct(marr.dims, marr.fieldnames, MATFrostArrayAbstract[plan_template(v) for v in marr.values])
+    elseif marr isa MATFrostArrayString
+        # The values handed out may be modified by the call.
+        MATFrostArrayString(marr.dims, copy(marr.values))
+    elseif marr isa MATFrostArrayPrimitive
+        empty_primitive(marr)
+    else
+        marr
+    end
+end
+
+empty_primitive(marr::MATFrostArrayPrimitive{T}) where {T} = MATFrostArrayPrimitive{T}(marr.dims, T[])
+
+end
@@ -1,15 +1,20 @@
 module _Read
 
 import ..MATFrost._Stream: read!, write!, flush!, discard!, BufferedUDS
+import ..MATFrost._SharedMemory: begin_read!, shm_read!, end_read!
+import ..MATFrost._Cache: cache_store!, cache_lookup!, end_message!
+import ..MATFrost._Plans: plan_template
+import ..MATFrost._Bits: packs, packed_nbytes, unpack_bits!
 using .._Types
 using .._Constants
 
 
 
 struct MATFrostArrayHeader
-    type :: Int32
-    dims :: Vector{Int64}
-    nel  :: Int64
+    type     :: Int32
+    encoding :: Int32
+    dims     :: Vector{Int64}
+    nel      :: Int64
 end
 
 function read_string!(socket::BufferedUDS) :: String
@@ -20,35 +25,138 @@ function read_string!(socket::BufferedUDS) :: String
 end
 
 function read_matfrostarray_header!(socket::BufferedUDS) :: MATFrostArrayHeader
-    type = read!(socket, Int32)
+    tag = read!(socket, Int32)
     ndims = read!(socket, Int64)
     dims = Int64[read!(socket, Int64) for _ in 1:ndims]
     nel  = prod(dims; init=1)
-    MATFrostArrayHeader(type, dims, nel)
+    MATFrostArrayHeader(tag & TYPE_MASK, tag & ~TYPE_MASK, dims, nel)
 end
 
 @noinline function read_matfrostarray_primitive!(socket::BufferedUDS, header::MATFrostArrayHeader, ::Type{T}) :: MATFrostArrayPrimitive{T}  where {T<:Number}
+    cached = header.encoding & (ENCODING_CACHED | ENCODING_CACHE_REFERENCE) != 0
+    digest = cached ? read!(socket, UInt64) : UInt64(0)
+    if header.encoding & ENCODING_CACHE_REFERENCE != 0
+        return MATFrostArrayPrimitive{T}(header.dims, cache_lookup!(socket.cache, digest, T, header.nel))
+    end
+
     values = Vector{T}(undef, header.nel)
-    read!(socket, values)
+    if header.encoding & ENCODING_SHARED_MEMORY != 0
+        shm_read!(socket.shm, reinterpret(Ptr{UInt8}, pointer(values)), sizeof(T)*header.nel)
+    else
+        read!(socket, values)
+    end
+    if cached
+        cache_store!(socket.cache, digest, values)
+    end
     MATFrostArrayPrimitive{T}(header.dims, values)
 end
 
+"""
+Logical array sent bit-packed: [packed_nbytes(nel) bytes], see `_Bits`.
+"""
+@noinline function read_matfrostarray_bits!(socket::BufferedUDS, header::MATFrostArrayHeader) :: MATFrostArrayPrimitive{Bool}
+    packed = Vector{UInt8}(undef, packed_nbytes(header.nel))
+    read!(socket, packed)
+    MATFrostArrayPrimitive{Bool}(header.dims, unpack_bits!(Vector{Bool}(undef, header.nel), packed))
+end
+
 @noinline function read_matfrostarray_string!(socket::BufferedUDS, header::MATFrostArrayHeader) :: MATFrostArrayString
+    if header.encoding & ENCODING_PACKED != 0
+        return read_matfrostarray_string_packed!(socket, header)
+    end
     values = String[read_string!(socket) for _ in 1:header.nel]
     MATFrostArrayString(header.dims, values)
 end
 
+"""
+String array sent packed: [offsets (nel+1)][UTF-8 blob], string i spans bytes offsets[i]+1:offsets[i+1] of the blob.
+"""
+@noinline function read_matfrostarray_string_packed!(socket::BufferedUDS, header::MATFrostArrayHeader) :: MATFrostArrayString
+    offsets = Vector{Int64}(undef, header.nel + 1)
+    read!(socket, offsets)
+    if offsets[1] != 0 || any(i -> offsets[i+1] < offsets[i], 1:header.nel)
+        error("Unrecoverable crash - MATFrost communication channel corrupted at read side")
+    end
+    blob = Vector{UInt8}(undef, offsets[end])
+    read!(socket, blob)
+    values = GC.@preserve blob String[
+        unsafe_string(pointer(blob) + offsets[i], offsets[i+1] - offsets[i]) for i in 1:header.nel
+    ]
+    MATFrostArrayString(header.dims, values)
+end
+
+"""
+Sparse matrix in compressed-column form: [nnz][colptr (cols+1)][rowval nnz][nzval nnz], indices one-based. See
+`write_matfrostarray_sparse!`.
+"""
+@noinline function read_matfrostarray_sparse!(socket::BufferedUDS, header::MATFrostArrayHeader, ::Type{T}) :: MATFrostArraySparse{T} where {T}
+    if length(header.dims) != 2
+        error("Unrecoverable crash - MATFrost communication channel corrupted at read side")
+    end
+    nnz = read!(socket, Int64)
+    colptr = Vector{Int64}(undef, header.dims[2] + 1)
+    rowval = Vector{Int64}(undef, nnz)
+    nzval = Vector{T}(undef, nnz)
+    read!(socket, colptr)
+    read!(socket, rowval)
+    read!(socket, nzval)
+    MATFrostArraySparse{T}(header.dims, colptr, rowval, nzval)
+end
+
+"""
+Field names of a struct: in full for the first struct with these field names, otherwise a reference to an earlier
+struct in the message. See `_Schemas`.
+"""
+function read_schema!(socket::BufferedUDS, header::MATFrostArrayHeader)::Vector{Symbol}
+    schemas = socket.schemas.read
+    if header.encoding & ENCODING_SCHEMA_REFERENCE != 0
+        index = read!(socket, Int64)
+        if !(0 <= index < length(schemas))
+            error("Unrecoverable crash - MATFrost communication channel corrupted at read side")
+        end
+        schemas[index+1]
+    else
+        nfields = read!(socket, Int64)
+        fns = Symbol[Symbol(read_string!(socket)) for _ in 1:nfields]
+        push!(schemas, fns)
+        fns
+    end
+end
+
 @noinline function read_matfrostarray_struct!(socket::BufferedUDS, header::MATFrostArrayHeader)::MATFrostArrayStruct
-    nfields = read!(socket, Int64)
-    fns = Symbol[Symbol(read_string!(socket)) for _ in 1:nfields]
+    fns = read_schema!(socket, header)
+
+    if header.encoding & ENCODING_COLUMNAR != 0
+        return read_matfrostarray_struct_columnar!(socket, header, fns)
+    end
     
     values = MATFrostArrayAbstract[
-        read_matfrostarray!(socket) for _ in 1:(nfields*header.nel)
+        read_matfrostarray!(socket) for _ in 1:(length(fns)*header.nel)
     ]
 
     MATFrostArrayStruct(header.dims, fns, values)
 end
 
+"""
+Struct array sent field by field, every field a cell array with the values of all elements. Values are stored element
+by element, as for a struct array sent element by element.
+"""
+@noinline function read_matfrostarray_struct_columnar!(socket::BufferedUDS, header::MATFrostArrayHeader, fns::Vector{Symbol})::MATFrostArrayStruct
+    nfields = length(fns)
+    values = Vector{MATFrostArrayAbstract}(undef, nfields*header.nel)
+    for fi in 1:nfields
+        column = read_matfrostarray!(socket)
+        if !(column isa MATFrostArrayCell) || length(column.values) != header.nel
+            error("Unrecoverable crash - MATFrost communication channel corrupted at read side")
+        end
+        for i in 1:header.nel
+            values[(i-1)*nfields + fi] = column.values[i]
+        end
+    end
+
+    MATFrostArrayStruct(header.dims, fns, values)
+end
+
 @noinline function read_matfrostarray_cell!(socket::BufferedUDS, header::MATFrostArrayHeader)::MATFrostArrayCell
     values = MATFrostArrayAbstract[
         read_matfrostarray!(socket) for _ in 1:header.nel
@@ -57,30 +165,60 @@ end
     
 end
 
+"""
+Cell array sent with the columnar encoding: a single header for all elements followed by their payloads back to back.
+See `write_matfrostarray_column!`.
+"""
+@noinline function read_matfrostarray_cell_columnar!(socket::BufferedUDS, header::MATFrostArrayHeader)::MATFrostArrayCell
+    elheader = read_matfrostarray_header!(socket)
+    if sizeof_matlab_primitive(elheader.type) == 0 || elheader.nel == 0
+        error("Unrecoverable crash - MATFrost communication channel corrupted at read side")
+    end
+    values = MATFrostArrayAbstract[
+        read_matfrostarray_value!(socket, elheader) for _ in 1:header.nel
+    ]
+    MATFrostArrayCell(header.dims, values)
+end
+
 @noinline function read_matfrostarray!(socket::BufferedUDS) :: MATFrostArrayAbstract
     header = read_matfrostarray_header!(socket)
 
-    if header.nel == 0
+    if header.encoding & (ENCODING_PLAN | ENCODING_PLAN_REFERENCE) != 0
+        return read_matfrostarray_plan!(socket, header)
+    end
+
+    if header.nel == 0 && !is_sparse(header.type)
         if header.type == STRUCT
-            nfields = read!(socket, Int64)
-            for _ in 1:nfields
-                nb = read!(socket, Int64)
-                discard!(socket, nb)
-            end
+            # Registers the schema, later structs may refer to it.
+            read_schema!(socket, header)
         end
         return MATFrostArrayEmpty()
     end
 
+    read_matfrostarray_value!(socket, header)
+end
 
+@noinline function read_matfrostarray_value!(socket::BufferedUDS, header::MATFrostArrayHeader) :: MATFrostArrayAbstract
     if header.type == STRUCT
         read_matfrostarray_struct!(socket, header)
 
+    elseif header.type == CELL && header.encoding & ENCODING_COLUMNAR != 0
+        read_matfrostarray_cell_columnar!(socket, header)
     elseif header.type == CELL
         read_matfrostarray_cell!(socket, header)
 
     elseif header.type == MATLAB_STRING
         read_matfrostarray_string!(socket, header)
         
+    elseif header.type == SPARSE_LOGICAL
+        read_matfrostarray_sparse!(socket, header, Bool)
+    elseif header.type == SPARSE_DOUBLE
+        read_matfrostarray_sparse!(socket, header, Float64)
+    elseif header.type == SPARSE_COMPLEX_DOUBLE
+        read_matfrostarray_sparse!(socket, header, Complex{Float64})
+
+    elseif header.type == LOGICAL && header.encoding & ENCODING_BIT_PACKED != 0
+        read_matfrostarray_bits!(socket, header)
     elseif header.type == LOGICAL
         read_matfrostarray_primitive!(socket, header, Bool)
 
@@ -133,6 +271,79 @@ end
 
 end
 
+"""
+Message sent by serialization plan, see `_Plans`. A plan definition is followed by the array in full, which becomes the
+template of the plan. A plan reference is followed by [threshold] and the payloads of the primitive arrays of the
+template, depth first; payloads of at least threshold bytes are in shared memory. Logical payloads on the socket are
+bit-packed if they reach the bit packing threshold, as the MEX would tag them.
+"""
+@noinline function read_matfrostarray_plan!(socket::BufferedUDS, header::MATFrostArrayHeader) :: MATFrostArrayAbstract
+    templates = socket.plans.templates
+    id = read!(socket, Int64)
+
+    if header.encoding & ENCODING_PLAN != 0
+        if id != length(templates)
+            error("Unrecoverable crash - MATFrost serialization plans out of sync")
+        end
+        marr = read_matfrostarray!(socket)
+        push!(templates, plan_template(marr))
+        return marr
+    end
+
+    if !(0 <= id < length(templates))
+        error("Unrecoverable crash - MATFrost serialization plans out of sync")
+    end
+    threshold = read!(socket, UInt64)
+    read_plan_values!(socket, templates[id+1], threshold)
+end
+
+@noinline function read_plan_values!(socket::BufferedUDS, @nospecialize(template::MATFrostArrayAbstract), threshold::UInt64) :: MATFrostArrayAbstract
+    if template isa MATFrostArrayCell
+        MATFrostArrayCell(template.dims, MATFrostArrayAbstract[read_plan_values!(socket, v, threshold) for v in template.values])
+    elseif template isa MATFrostArrayStruct
+        MATFrostArrayStruct(template.dims, template.fieldnames, MATFrostArrayAbstract[read_plan_values!(socket, v, threshold) for v in template.values])
+    elseif template isa MATFrostArrayString
+        MATFrostArrayString(template.dims, copy(template.values))
+    elseif template isa MATFrostArrayPrimitive
+        read_plan_primitive!(socket, template, threshold)
+    else
+        template
+    end
+end
+
+function read_plan_primitive!(socket::BufferedUDS, template::MATFrostArrayPrimitive{T}, threshold::UInt64) :: MATFrostArrayPrimitive{T} where {T<:Number}
+    nel = prod(template.dims; init=1)
+    values = Vector{T}(undef, nel)
+    if UInt64(sizeof(T)*nel) >= threshold
+        shm_read!(socket.shm, reinterpret(Ptr{UInt8}, pointer(values)), sizeof(T)*nel)
+    elseif T === Bool && packs(socket.bits, nel)
+        packed = Vector{UInt8}(undef, packed_nbytes(nel))
+        read!(socket, packed)
+        unpack_bits!(values, packed)
+    else
+        read!(socket, values)
+    end
+    MATFrostArrayPrimitive{T}(template.dims, values)
+end
+
+"""
+Read a complete message, see `write_message!`. Returns `(request_id, marr)`.
+"""
+function read_message!(socket::BufferedUDS) :: Tuple{UInt64, MATFrostArrayAbstract}
+    request_id = read!(socket, UInt64)
+    nbytes = read!(socket, Int64)
+    offset = read!(socket, Int64)
+    advance = read!(socket, Int64)
+
+    empty!(socket.schemas.read)
+    begin_read!(socket.shm, offset, advance)
+    marr = read_matfrostarray!(socket)
+    end_read!(socket.shm)
+    end_message!(socket.cache)
+
+    (request_id, marr)
+end
+
 
 
 end
\ No newline at end of file
@@ -0,0 +1,29 @@
+module _Schemas
+
+"""
+Struct field names interned per message. Julia side of `Encoding::Schemas` in `encoding.hpp`.
+
+The first struct with a given list of field names is sent in full: [nfields][names], and becomes the next schema.
+Later structs with the same field names are tagged with `ENCODING_SCHEMA_REFERENCE` and send only the index of the
+schema: [index].
+"""
+mutable struct Schemas
+    written::Dict{Vector{Symbol}, Int64}
+    read::Vector{Vector{Symbol}}
+end
+
+Schemas() = Schemas(Dict{Vector{Symbol}, Int64}(), Vector{Symbol}[])
+
+"""
+Look up the schema of the field names. Returns the index if written before in this message, otherwise registers the
+field names as the next schema and returns -1.
+"""
+function intern!(written::Dict{Vector{Symbol}, Int64}, fieldnames::Vector{Symbol})::Int64
+    index = get(written, fieldnames, -1)
+    if index < 0
+        written[fieldnames] = length(written)
+    end
+    index
+end
+
+end
@@ -1,9 +1,10 @@
 module _Server
 
 import ..MATFrost as MATFrost
-import ..MATFrost._Read:  read_matfrostarray!
-import ..MATFrost._Write: write_matfrostarray!
-import ..MATFrost._Stream: flush!, uds_accept, uds_bind, uds_connect, uds_listen, uds_socket, uds_read, uds_write, uds_init, uds_close, FD_TYPE, Buffer, BufferedUDS
+import ..MATFrost._Read:  read_message!
+import ..MATFrost._Write: write_message!
+import ..MATFrost._Stream: read!, flush!, uds_accept, uds_bind, uds_connect, uds_listen, uds_socket, uds_read, uds_write, uds_init, uds_close, FD_TYPE, Buffer, BufferedUDS
+import ..MATFrost._SharedMemory: open_region!
 using ..MATFrost._Types
 using ..MATFrost._Constants
 using ..MATFrost._ConvertToJulia: _ConvertToJulia
@@ -32,6 +33,79 @@ struct MATFrostResultMATLAB{T}
 end
 
 
+"""
+Functions resolved by RESOLVE, indexed by function ID. A server process serves a single connection, so the IDs are
+unique per connection.
+"""
+const resolved_functions = Tuple{Any, Type}[]
+
+"""
+Results kept server-side, indexed by handle ID. A call with a trailing "HANDLE" stores its result here and returns
+the handle instead of the value. Handles are passed back as arguments as a struct with the single field
+`matfrost_handle`. The table lives as long as the server process, i.e. the connection.
+"""
+const handles = Dict{UInt64, Any}()
+const next_handle = Ref{UInt64}(0)
+
+"""
+Iterators of streaming calls, indexed by stream ID. A call with a trailing "STREAM" keeps the iterator returned by the
+function here and returns the stream ID. Every NEXT advances the iterator by one element, a chunk, which is sent as a
+message of its own. Exhausted streams are removed, as are streams whose iteration throws.
+"""
+mutable struct Stream
+    iterator::Any
+    state::Any
+    started::Bool
+end
+
+const streams = Dict{UInt64, Stream}()
+const next_stream = Ref{UInt64}(0)
+
+"""
+Uploads, indexed by upload ID: chunks pushed by MATLAB, not yet taken by a call. OPEN_STREAM creates an upload, PUSH
+appends a chunk, CLOSE_STREAM ends it. Chunks are kept as received and converted when taken, to the element type of the
+`UploadStream` argument of the consuming call.
+"""
+mutable struct Upload
+    chunks::Vector{MATFrostArrayAbstract}
+    closed::Bool
+end
+
+const uploads = Dict{UInt64, Upload}()
+const next_upload = Ref{UInt64}(0)
+
+"""
+Argument of a Julia function consuming an upload, an iterator over its chunks converted to `T`:
+
+    total(chunks::MATFrost.UploadStream{Vector{Float64}}) = sum(sum, chunks)
+
+The call can start before the upload is complete. When it runs out of chunks, it reads the next messages from the
+connection itself, see `receive_upload!`. Iteration ends once the upload is closed and all chunks are taken.
+"""
+struct UploadStream{T}
+    id::UInt64
+end
+
+Base.IteratorSize(::Type{<:UploadStream}) = Base.SizeUnknown()
+Base.eltype(::Type{UploadStream{T}}) where T = T
+
+"""
+Connection of the server, read by calls waiting for chunks of an upload.
+"""
+const connection = Ref{Union{Nothing, BufferedUDS}}(nothing)
+
+"""
+Messages read by `receive_upload!` while a call runs. They are handled after the call, in order.
+"""
+const deferred = Tuple{UInt64, MATFrostArrayAbstract}[]
+
+"""
+Set when a call is interrupted by a cancel of the MEX, until its CANCEL marker arrives. See `end_cancel`.
+"""
+const cancelling = Ref(false)
+
+CancelledException() = MATFrostException("matfrostjulia:call:cancelled", "Call cancelled")
+
 AmbiguityError(f::Function) = MATFrostException("matfrostjulia:call:ambigiousFunction",ambiguous_method_error(f))
 """
 This function is the basis of the MATFrostServer.
@@ -48,14 +122,25 @@ function MATFrost.matfrostserve(socket_path::String)
     bufout = Buffer(Vector{UInt8}(undef, 2 << 15), 0, 0)
     
     bufuds = BufferedUDS(client_socket_fd, bufin, bufout)
-    
-    while true  
-        try 
-            callsequence(bufuds)
-        catch e
-            Base.showerror(stdout, e)
-            Base.show_backtrace(stdout, Base.catch_backtrace())
-            exit()
+    connection[] = bufuds
+
+    negotiate_shared_memory!(bufuds)
+    negotiate_cache!(bufuds)
+    negotiate_bit_packing!(bufuds)
+
+    # A cancel of the MEX interrupts the running call with SIGINT. Interrupts are only delivered while a call runs,
+    # never while reading or writing a message.
+    Base.exit_on_sigint(false)
+
+    disable_sigint() do
+        while true
+            try
+                callsequence(bufuds)
+            catch e
+                Base.showerror(stdout, e)
+                Base.show_backtrace(stdout, Base.catch_backtrace())
+                exit()
+            end
         end
     end
 end
@@ -70,42 +155,93 @@ function package_is_loaded(packagename)
     end
 end
 
+"""
+Handshake sent by the MEX right after connecting: [capacity][threshold][name]. A capacity of 0 disables shared memory.
+"""
+function negotiate_shared_memory!(socket::BufferedUDS)
+    capacity = read!(socket, Int64)
+    threshold = read!(socket, Int64)
+    name = read!(socket, String)
+    if capacity > 0
+        open_region!(socket.shm, name, capacity, threshold)
+    end
+end
+
+"""
+Handshake of the argument cache, right after the shared memory handshake: [budget]. See `_Cache`.
+"""
+function negotiate_cache!(socket::BufferedUDS)
+    socket.cache.budget = read!(socket, Int64)
+end
+
+"""
+Handshake of bit packing, right after the cache handshake: [threshold]. See `_Bits`.
+"""
+function negotiate_bit_packing!(socket::BufferedUDS)
+    socket.bits.threshold = read!(socket, Int64)
+end
+
+"""
+Messages handled:
+- `{callmeta; args}`: call by name.
+- `{function_id::Int64; args}`: call of a function resolved before.
+- `{callmeta}`: RESOLVE, returns the function ID of callmeta.
+- `{callmeta or function_id; args; "HANDLE"}`: call, keeping the result in the handle table. Returns the handle.
+- `{callmeta or function_id; args; "STREAM"}`: call, keeping the returned iterator in the stream table. Returns the
+  stream.
+- `{"FETCH"; handle::UInt64}`: returns the value of a handle.
+- `{"RELEASE"; handles::Vector{UInt64}}`: frees handles, returns the number freed.
+- `{"NEXT"; stream::UInt64}`: returns `(done, chunk)`, the next element of a stream or `done` once exhausted.
+- `{"DONE"; streams::Vector{UInt64}}`: frees streams, returns the number freed.
+- `{"OPEN_STREAM"}`: creates an upload, returns it. Passed as argument to a call as `UploadStream`.
+- `{"PUSH"; upload::UInt64; chunk}`: appends a chunk to an upload.
+- `{"CLOSE_STREAM"; upload::UInt64}`: ends an upload, no chunks can be pushed afterwards.
+- `{"CANCEL"; signalled::UInt64}`: marker written by a cancel of the MEX, see `end_cancel`.
+"""
 function callsequence(socket::BufferedUDS)
 
-    callstruct = read_matfrostarray!(socket)
+    (request_id, callstruct) = isempty(deferred) ? read_message!(socket) : popfirst!(deferred)
 
-    marr = try
+    marr = respond(callstruct)
 
-        if !(callstruct isa MATFrostArrayCell) || length(callstruct.values) != 2
-            throw("error")
-        end
-        
-        callmeta = _ConvertToJulia.convert_matfrostarray(CallMeta, callstruct.values[1])
-        syms = Symbol.(split(callmeta.fully_qualified_name,"."))
-        packagename = syms[1]
+    if marr isa MATFrostArrayAbstract
+        write_message!(socket, request_id, marr)
+        flush!(socket)
+    else
+        error("Unclear error")
+    end
 
+end
 
-        if !Base.invokelatest(package_is_loaded, packagename)
-            try
-                Main.eval(:(import $packagename))
-            catch e
-                throw(MATFrostException("matfrostjulia:call:packageNotFound", 
 """
-Package not found exception:
-
-Package: $(packagename)
+Perform the call of a message and return the response.
 """
-))
+function respond(callstruct::MATFrostArrayAbstract)
+    try
+
+        if !(callstruct isa MATFrostArrayCell) || !(1 <= length(callstruct.values) <= 3)
+            throw("error")
+        end
+
+        head = callstruct.values[1]
+
+        if head isa MATFrostArrayString && head.values == ["CANCEL"]
+            end_cancel(callstruct)
+        elseif head isa MATFrostArrayString
+            handle_command(callstruct)
+        else
+            # Only a running call can be interrupted.
+            reenable_sigint() do
+                call_function(callstruct)
             end
         end
 
-        # As packages (currently) are loaded loaded on-demand after MATFrost server has been started,
-        # the functions in those packages need to be called from a newer world age.
-        # This ofcourse is not ideal and should be treated with care.
-        Base.invokelatest(callsequence_latest_world_age, callmeta, callstruct.values[2])
+    catch e
+        if e isa InterruptException
+            cancelling[] = true
+            e = CancelledException()
+        end
 
-    catch e 
-        
         buf = IOBuffer()
         Base.showerror(buf, e)
         Base.show_backtrace(buf, Base.catch_backtrace())
@@ -119,20 +255,100 @@ Package: $(packagename)
 
         _ConvertToMATLAB.convert_matfrostarray(matfrostexceptionresult(matfe))
     end
+end
 
-    if marr isa MATFrostArrayAbstract
-        write_matfrostarray!(socket, marr)
-        flush!(socket)
+function call_function(callstruct::MATFrostArrayCell)
+    head = callstruct.values[1]
+
+    (f, Args) = if head isa MATFrostArrayPrimitive{Int64} && length(head.values) == 1
+        resolved_function(head.values[1])
     else
-        error("Unclear error")
+        load_function(_ConvertToJulia.convert_matfrostarray(CallMeta, head))
+    end
+
+    if length(callstruct.values) == 1
+        push!(resolved_functions, (f, Args))
+        _ConvertToMATLAB.convert_matfrostarray(MATFrostResultMATLAB("SUCCESFUL", "", Int64(length(resolved_functions))))
+    else
+        mode = length(callstruct.values) == 3 && callstruct.values[3] isa MATFrostArrayString &&
+            length(callstruct.values[3].values) == 1 ? callstruct.values[3].values[1] : ""
+        # As packages (currently) are loaded loaded on-demand after MATFrost server has been started,
+        # the functions in those packages need to be called from a newer world age.
+        # This ofcourse is not ideal and should be treated with care.
+        Base.invokelatest(callsequence_latest_world_age, f, Args, callstruct.values[2], mode)
     end
+end
 
+"""
+The MEX abandons the call it waits for when cancelling. If Julia runs that call, the MEX sends SIGINT and then this
+marker. The interrupted call is answered with a cancelled error, other calls run as usual. If no call was interrupted,
+the signal arrived between calls and is still pending: it is consumed here, such that it does not interrupt a call
+after the marker.
+"""
+function end_cancel(callstruct::MATFrostArrayCell)
+    signalled = length(callstruct.values) == 2 && callstruct.values[2] isa MATFrostArrayPrimitive{UInt64} &&
+        callstruct.values[2].values == [UInt64(1)]
+    if signalled && !cancelling[]
+        consume_interrupt()
+    end
+    cancelling[] = false
+    _ConvertToMATLAB.convert_matfrostarray(MATFrostResultMATLAB("SUCCESFUL", "", true))
 end
 
-function callsequence_latest_world_age(callmeta, callargs)
-    (f,Args) = getMethod(callmeta)
+"""
+Wait up to a second for the pending interrupt.
+"""
+function consume_interrupt()
+    for _ in 1:1000
+        try
+            reenable_sigint() do
+                sleep(0.001)
+            end
+        catch e
+            e isa InterruptException || rethrow()
+            return
+        end
+    end
+end
+
+"""
+Import the package of the function if needed and look up the function and its argument types.
+"""
+function load_function(callmeta::CallMeta)
+    syms = Symbol.(split(callmeta.fully_qualified_name,"."))
+    packagename = syms[1]
+
+    if !Base.invokelatest(package_is_loaded, packagename)
+        try
+            Main.eval(:(import $packagename))
+        catch e
+            throw(MATFrostException("matfrostjulia:call:packageNotFound", 
+"""
+Package not found exception:
+
+Package: $(packagename)
+"""
+))
+        end
+    end
+
+    Base.invokelatest(getMethod, callmeta)
+end
+
+function resolved_function(function_id::Int64)
+    if !(1 <= function_id <= length(resolved_functions))
+        throw(MATFrostException("matfrostjulia:call:functionNotResolved", "Function ID $(function_id) is not resolved"))
+    end
+    resolved_functions[function_id]
+end
+
+"""
+Convert the arguments, call the function and convert its result. `mode` "HANDLE" keeps the result in the handle table,
+"STREAM" keeps it in the stream table.
+"""
+function callsequence_latest_world_age(f, Args, callargs, mode::String="")
     args = try
-        _ConvertToJulia.convert_matfrostarray(Args, callargs)
+        convert_arguments(Args, callargs)
     catch e
         if e isa MATFrostConversionException
             rethrow(matfrostinputconversionexception(e))
@@ -143,7 +359,218 @@ function callsequence_latest_world_age(callmeta, callargs)
     # Call the function using invokelatest for world age safety
     out = f(args...)
 
-    _ConvertToMATLAB.convert_matfrostarray(MATFrostResultMATLAB("SUCCESFUL", "", out))
+    if mode == "HANDLE"
+        _ConvertToMATLAB.convert_matfrostarray(MATFrostResultMATLAB("SUCCESFUL", "", store_handle!(out)))
+    elseif mode == "STREAM"
+        _ConvertToMATLAB.convert_matfrostarray(MATFrostResultMATLAB("SUCCESFUL", "", store_stream!(out)))
+    else
+        _ConvertToMATLAB.convert_matfrostarray(MATFrostResultMATLAB("SUCCESFUL", "", out))
+    end
+end
+
+"""
+Convert the call arguments to Args. Arguments that are handles are taken from the handle table as is, uploads are
+passed as `UploadStream`.
+"""
+function convert_arguments(::Type{Args}, callargs::MATFrostArrayAbstract) where {Args<:Tuple}
+    if !(callargs isa MATFrostArrayCell) || !any(m -> is_handle_reference(m) || is_upload_reference(m), callargs.values)
+        return _ConvertToJulia.convert_matfrostarray(Args, callargs)
+    end
+
+    _ConvertToJulia.validate_array_dimensions(Args, callargs)
+
+    Args(ntuple(fieldcount(Args)) do i
+        T = fieldtype(Args, i)
+        marr = callargs.values[i]
+        if is_handle_reference(marr)
+            handle_value(T, marr.values[1].values[1])
+        elseif is_upload_reference(marr)
+            upload_stream(T, marr.values[1].values[1])
+        else
+            try
+                _ConvertToJulia.convert_matfrostarray(T, marr)
+            catch e
+                if e isa MATFrostConversionException
+                    push!(e.stacktrace, i)
+                end
+                rethrow(e)
+            end
+        end
+    end)
+end
+
+is_handle_reference(marr::MATFrostArrayAbstract) =
+    marr isa MATFrostArrayStruct && marr.fieldnames == [:matfrost_handle] && length(marr.values) == 1 &&
+        marr.values[1] isa MATFrostArrayPrimitive{UInt64} && length(marr.values[1].values) == 1
+
+is_upload_reference(marr::MATFrostArrayAbstract) =
+    marr isa MATFrostArrayStruct && marr.fieldnames == [:matfrost_upload] && length(marr.values) == 1 &&
+        marr.values[1] isa MATFrostArrayPrimitive{UInt64} && length(marr.values[1].values) == 1
+
+function store_handle!(value)
+    next_handle[] += 1
+    handles[next_handle[]] = value
+    (matfrost_handle=next_handle[], type=string(typeof(value)))
+end
+
+function handle_value(::Type{T}, handle::UInt64) where T
+    if !haskey(handles, handle)
+        throw(MATFrostException("matfrostjulia:handle:notFound", "Handle $(handle) not found, it has been released"))
+    end
+    value = handles[handle]
+    if !(value isa T)
+        throw(MATFrostException("matfrostjulia:handle:incompatibleType",
+            "Handle $(handle) holds a value of type $(typeof(value)), argument requires $(T)"))
+    end
+    value
+end
+
+function store_stream!(iterator)
+    next_stream[] += 1
+    streams[next_stream[]] = Stream(iterator, nothing, false)
+    (matfrost_stream=next_stream[], type=string(typeof(iterator)))
+end
+
+"""
+Advance the stream by one element. Runs in the latest world age: the iterator is defined by the called package.
+"""
+function next_chunk(id::UInt64)
+    stream = get(streams, id, nothing)
+    if stream === nothing
+        throw(MATFrostException("matfrostjulia:stream:notFound", "Stream $(id) not found, it is exhausted or closed"))
+    end
+    next = try
+        stream.started ? iterate(stream.iterator, stream.state) : iterate(stream.iterator)
+    catch
+        delete!(streams, id)
+        rethrow()
+    end
+    if next === nothing
+        delete!(streams, id)
+        return _ConvertToMATLAB.convert_matfrostarray(MATFrostResultMATLAB("SUCCESFUL", "", (done=true, chunk=Float64[])))
+    end
+    (chunk, stream.state) = next
+    stream.started = true
+    _ConvertToMATLAB.convert_matfrostarray(MATFrostResultMATLAB("SUCCESFUL", "", (done=false, chunk=chunk)))
+end
+
+"""
+Free a stream before it is exhausted. A Channel is closed, which stops the task producing into it.
+"""
+function close_stream!(id::UInt64)
+    stream = pop!(streams, id, nothing)
+    stream === nothing && return false
+    stream.iterator isa Channel && close(stream.iterator)
+    true
+end
+
+function upload_value(id::UInt64)
+    if !haskey(uploads, id)
+        throw(MATFrostException("matfrostjulia:upload:notFound", "Upload $(id) not found, it has been consumed"))
+    end
+    uploads[id]
+end
+
+function upload_stream(::Type{T}, id::UInt64) where T
+    upload_value(id)
+    if !(T <: UploadStream && isconcretetype(T))
+        throw(MATFrostException("matfrostjulia:upload:incompatibleType",
+            "Upload $(id) passed as argument of type $(T), requires MATFrost.UploadStream{T}"))
+    end
+    T(id)
+end
+
+function open_upload!()
+    next_upload[] += 1
+    uploads[next_upload[]] = Upload(MATFrostArrayAbstract[], false)
+    (matfrost_upload=next_upload[],)
+end
+
+function push_chunk!(id::UInt64, chunk::MATFrostArrayAbstract)
+    upload = upload_value(id)
+    if upload.closed
+        throw(MATFrostException("matfrostjulia:upload:closed", "Upload $(id) is closed"))
+    end
+    push!(upload.chunks, chunk)
+    Int64(length(upload.chunks))
+end
+
+function Base.iterate(s::UploadStream{T}, _=nothing) where T
+    upload = upload_value(s.id)
+    while isempty(upload.chunks) && !upload.closed
+        receive_upload!()
+    end
+    if isempty(upload.chunks)
+        delete!(uploads, s.id)
+        return nothing
+    end
+    (_ConvertToJulia.convert_matfrostarray(T, popfirst!(upload.chunks)), nothing)
+end
+
+"""
+Read the next message while a call waits for chunks of an upload. PUSH, CLOSE_STREAM and RESOLVE are handled and
+answered right away, the MEX waits for them. Other messages are deferred until the call completes. On a CANCEL marker the
+waiting call is cancelled, the marker is handled right after it, before the deferred messages.
+"""
+function receive_upload!()
+    socket = connection[]
+    if socket === nothing
+        throw(MATFrostException("matfrostjulia:upload:notConnected", "Uploads require a MATFrost connection"))
+    end
+    # Messages are never read partially.
+    disable_sigint() do
+        (request_id, callstruct) = read_message!(socket)
+        command = upload_command(callstruct)
+        resolve = callstruct isa MATFrostArrayCell && length(callstruct.values) == 1 && command == ""
+        if command == "PUSH" || command == "CLOSE_STREAM" || resolve
+            write_message!(socket, request_id, respond(callstruct))
+            flush!(socket)
+        elseif command == "CANCEL"
+            # The pending interrupt is consumed by the marker, not by a deferred call.
+            pushfirst!(deferred, (request_id, callstruct))
+            throw(CancelledException())
+        else
+            push!(deferred, (request_id, callstruct))
+        end
+    end
+end
+
+upload_command(callstruct::MATFrostArrayAbstract) =
+    callstruct isa MATFrostArrayCell && !isempty(callstruct.values) && callstruct.values[1] isa MATFrostArrayString &&
+        length(callstruct.values[1].values) == 1 ? callstruct.values[1].values[1] : ""
+
+"""
+FETCH and RELEASE of handles, NEXT and DONE of streams, OPEN_STREAM, PUSH and CLOSE_STREAM of uploads.
+"""
+function handle_command(callstruct::MATFrostArrayCell)
+    command = only(callstruct.values[1].values)
+    ids = length(callstruct.values) >= 2 && callstruct.values[2] isa MATFrostArrayPrimitive{UInt64} ?
+        callstruct.values[2].values : UInt64[]
+
+    if command == "FETCH" && length(ids) == 1
+        Base.invokelatest(_ConvertToMATLAB.convert_matfrostarray,
+            MATFrostResultMATLAB("SUCCESFUL", "", handle_value(Any, ids[1])))
+    elseif command == "RELEASE"
+        released = count(id -> haskey(handles, id) && (delete!(handles, id); true), ids)
+        _ConvertToMATLAB.convert_matfrostarray(MATFrostResultMATLAB("SUCCESFUL", "", Int64(released)))
+    elseif command == "NEXT" && length(ids) == 1
+        # Computing a chunk can take as long as a call, it can be interrupted as well.
+        reenable_sigint() do
+            Base.invokelatest(next_chunk, ids[1])
+        end
+    elseif command == "DONE"
+        closed = count(close_stream!, ids)
+        _ConvertToMATLAB.convert_matfrostarray(MATFrostResultMATLAB("SUCCESFUL", "", Int64(closed)))
+    elseif command == "OPEN_STREAM"
+        _ConvertToMATLAB.convert_matfrostarray(MATFrostResultMATLAB("SUCCESFUL", "", open_upload!()))
+    elseif command == "PUSH" && length(ids) == 1 && length(callstruct.values) == 3
+        _ConvertToMATLAB.convert_matfrostarray(MATFrostResultMATLAB("SUCCESFUL", "", push_chunk!(ids[1], callstruct.values[3])))
+    elseif command == "CLOSE_STREAM" && length(ids) == 1
+        upload_value(ids[1]).closed = true
+        _ConvertToMATLAB.convert_matfrostarray(MATFrostResultMATLAB("SUCCESFUL", "", true))
+    else
+        throw(MATFrostException("matfrostjulia:handle:invalidCommand", "Invalid handle command: $(command)"))
+    end
 end
 
 
@@ -0,0 +1,197 @@
+module _SharedMemory
+
+"""
+Shared-memory data plane for bulk payloads. Julia side of `sharedmemory.hpp`.
+
+The region contains two rings. Ring 0 carries MATLAB -> Julia payloads, ring 1 carries Julia -> MATLAB payloads.
+All shared memory payloads of a message live in a single block reserved before the message is written.
+"""
+
+const HEADER_SIZE = 64
+
+const FILE_MAP_ALL_ACCESS = UInt32(0x000F001F)
+
+const O_RDWR = Cint(2)
+const PROT_READ = Cint(1)
+const PROT_WRITE = Cint(2)
+const MAP_SHARED = Cint(1)
+
+mutable struct Block
+    offset::Int64
+    advance::Int64
+    cursor::Int64
+    active::Bool
+end
+
+Block() = Block(0, 0, 0, false)
+
+mutable struct SharedMemoryRegion
+    handle::Ptr{Cvoid}
+    base::Ptr{UInt8}
+    capacity::Int64
+    threshold::Int64
+    write_ring::Int64
+    read_ring::Int64
+    write_block::Block
+    read_block::Block
+end
+
+"""
+Disabled region; all payloads are sent over the socket.
+"""
+SharedMemoryRegion() = SharedMemoryRegion(C_NULL, C_NULL, 0, typemax(Int64), 1, 0, Block(), Block())
+
+enabled(shm::SharedMemoryRegion) = shm.capacity > 0
+
+head_pointer(shm::SharedMemoryRegion, ring::Int64) = reinterpret(Ptr{UInt64}, shm.base + 8 + 16*ring)
+tail_pointer(shm::SharedMemoryRegion, ring::Int64) = reinterpret(Ptr{UInt64}, shm.base + 16 + 16*ring)
+data_pointer(shm::SharedMemoryRegion, ring::Int64) = shm.base + HEADER_SIZE + ring*shm.capacity
+
+@static if Sys.iswindows()
+
+function open_region!(shm::SharedMemoryRegion, name::String, capacity::Int64, threshold::Int64)
+    size = HEADER_SIZE + 2*capacity
+
+    handle = @ccall "kernel32".OpenFileMappingA(
+        FILE_MAP_ALL_ACCESS::UInt32,
+        Cint(0)::Cint,
+        name::Cstring)::Ptr{Cvoid}
+
+    if handle == C_NULL
+        throw("Cannot open shared memory $(name)")
+    end
+
+    base = @ccall "kernel32".MapViewOfFile(
+        handle::Ptr{Cvoid},
+        FILE_MAP_ALL_ACCESS::UInt32,
+        UInt32(0)::UInt32,
+        UInt32(0)::UInt32,
+        Csize_t(size)::Csize_t)::Ptr{UInt8}
+
+    if base == C_NULL
+        @ccall "kernel32".CloseHandle(handle::Ptr{Cvoid})::Cint
+        throw("Cannot map shared memory $(name)")
+    end
+
+    shm.handle = handle
+    shm.base = base
+    shm.capacity = capacity
+    shm.threshold = threshold
+    shm
+end
+
+else # POSIX
+
+function open_region!(shm::SharedMemoryRegion, name::String, capacity::Int64, threshold::Int64)
+    size = HEADER_SIZE + 2*capacity
+
+    # Objects created by shm_open(3) live in /dev/shm on Linux.
+    fd = @ccall open(("/dev/shm" * name)::Cstring, O_RDWR::Cint; Cint(0)::Cint)::Cint
+
+    if fd < 0
+        throw("Cannot open shared memory $(name)")
+    end
+
+    base = @ccall mmap(
+        C_NULL::Ptr{Cvoid},
+        Csize_t(size)::Csize_t,
+        (PROT_READ | PROT_WRITE)::Cint,
+        MAP_SHARED::Cint,
+        fd::Cint,
+        Int64(0)::Int64)::Ptr{UInt8}
+
+    @ccall close(fd::Cint)::Cint
+
+    if base == reinterpret(Ptr{UInt8}, typemax(UInt))
+        throw("Cannot map shared memory $(name)")
+    end
+
+    shm.base = base
+    shm.capacity = capacity
+    shm.threshold = threshold
+    shm
+end
+
+end
+
+"""
+Reserve a contiguous block of `nb` bytes for the next outgoing message. Stays inactive if the ring is full.
+"""
+function begin_write!(shm::SharedMemoryRegion, nb::Int64)
+    blk = shm.write_block
+    blk.offset = 0
+    blk.advance = 0
+    blk.cursor = 0
+    blk.active = false
+
+    if !enabled(shm) || nb == 0 || nb > shm.capacity
+        return blk
+    end
+
+    h = Int64(unsafe_load(head_pointer(shm, shm.write_ring)))
+    t = Int64(unsafe_load(tail_pointer(shm, shm.write_ring)))
+
+    pos = h % shm.capacity
+    pad = pos + nb > shm.capacity ? shm.capacity - pos : 0
+
+    if pad + nb > shm.capacity - (h - t)
+        return blk
+    end
+
+    blk.offset = pad > 0 ? 0 : pos
+    blk.advance = pad + nb
+    blk.active = true
+
+    Threads.atomic_fence()
+    unsafe_store!(head_pointer(shm, shm.write_ring), UInt64(h + pad + nb))
+    blk
+end
+
+writes(shm::SharedMemoryRegion, nb::Int64) = shm.write_block.active && nb >= shm.threshold
+
+function shm_write!(shm::SharedMemoryRegion, data::Ptr{UInt8}, nb::Int64)
+    blk = shm.write_block
+    unsafe_copyto!(data_pointer(shm, shm.write_ring) + blk.offset + blk.cursor, data, nb)
+    blk.cursor += nb
+    nothing
+end
+
+function end_write!(shm::SharedMemoryRegion)
+    shm.write_block.active = false
+    nothing
+end
+
+function begin_read!(shm::SharedMemoryRegion, offset::Int64, advance::Int64)
+    blk = shm.read_block
+    blk.offset = offset
+    blk.advance = advance
+    blk.cursor = 0
+    blk.active = advance > 0
+    blk
+end
+
+function shm_read!(shm::SharedMemoryRegion, data::Ptr{UInt8}, nb::Int64)
+    blk = shm.read_block
+    if !blk.active
+        error("Unrecoverable crash - MATFrost shared memory block not available")
+    end
+    unsafe_copyto!(data, data_pointer(shm, shm.read_ring) + blk.offset + blk.cursor, nb)
+    blk.cursor += nb
+    nothing
+end
+
+"""
+Hand the consumed block back to the writer on the other side.
+"""
+function end_read!(shm::SharedMemoryRegion)
+    blk = shm.read_block
+    if blk.active
+        Threads.atomic_fence()
+        ptail = tail_pointer(shm, shm.read_ring)
+        unsafe_store!(ptail, unsafe_load(ptail) + UInt64(blk.advance))
+    end
+    blk.active = false
+    nothing
+end
+
+end
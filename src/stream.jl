@@ -2,6 +2,12 @@
 
 module _Stream
 
+import ..MATFrost._SharedMemory: SharedMemoryRegion
+import ..MATFrost._Schemas: Schemas
+import ..MATFrost._Cache: ArgumentCache
+import ..MATFrost._Plans: Plans
+import ..MATFrost._Bits: BitPacking
+
 function read! end
 function write! end
 function flush! end
@@ -10,15 +16,17 @@ const AF_UNIX = Cint(1)
 const SOCK_STREAM = Cint(1)
 const SOMAXCONN = Cint(0x7fffffff)
 
+function memcpy_mat(pdest::Ptr{UInt8}, psrc::Ptr{UInt8}, nb::Integer)
+    @ccall memcpy(pdest::Ptr{UInt8}, psrc::Ptr{UInt8}, nb::Csize_t)::Cvoid
+end
+
+@static if Sys.iswindows()
+
 const FD_TYPE = UInt64
 const INVALID_SOCKET = UInt64(0)
 
 const SOCKADDR_UN = @NamedTuple{sun_family::UInt16, sun_path::NTuple{256,UInt8}}
 
-function memcpy_mat(pdest::Ptr{UInt8}, psrc::Ptr{UInt8}, nb::Integer)
-    @ccall memcpy(pdest::Ptr{UInt8}, psrc::Ptr{UInt8}, nb::Csize_t)::Cvoid
-end
-
 function uds_socket()
     fd = @ccall "Ws2_32.dll".socket(
         AF_UNIX::Cint, 
@@ -145,6 +153,131 @@ function uds_close(socket_fd::FD_TYPE)
         socket_fd::FD_TYPE)::Cint
 end
 
+else # POSIX
+
+const FD_TYPE = Cint
+const INVALID_SOCKET = Cint(-1)
+
+const SOCKADDR_UN = @NamedTuple{sun_family::UInt16, sun_path::NTuple{108,UInt8}}
+
+const MSG_NOSIGNAL = Sys.islinux() ? Cint(0x4000) : Cint(0)
+
+function sockaddr_un(path::String)
+    pathu8 = transcode(UInt8, path)
+
+    if length(pathu8) >= 108
+        throw("Socket path too long: $(path)")
+    end
+
+    sun_path = ntuple(Val{108}()) do i
+        if i <= length(pathu8)
+            pathu8[i]
+        else
+            UInt8(0)
+        end
+    end
+
+    Ref{SOCKADDR_UN}(SOCKADDR_UN((UInt16(AF_UNIX), sun_path)))
+end
+
+function uds_socket()
+    fd = @ccall socket(
+        AF_UNIX::Cint,
+        SOCK_STREAM::Cint,
+        Int32(0)::Cint)::FD_TYPE
+
+    if fd != INVALID_SOCKET
+        return fd
+    end
+
+    throw("Cannot start socket")
+end
+
+function uds_init()
+end
+
+function uds_bind(socket_fd::FD_TYPE, path::String)
+    rc = @ccall bind(
+        socket_fd::FD_TYPE,
+        sockaddr_un(path)::Ref{SOCKADDR_UN},
+        Cuint(sizeof(SOCKADDR_UN))::Cuint)::Cint
+
+    if rc != 0
+        throw("Cannot bind to socket $(path)")
+    end
+end
+
+function uds_connect(socket_fd::FD_TYPE, path::String)
+    @ccall connect(
+        socket_fd::FD_TYPE,
+        sockaddr_un(path)::Ref{SOCKADDR_UN},
+        Cuint(sizeof(SOCKADDR_UN))::Cuint)::Cint
+end
+
+function uds_listen(socket_fd::FD_TYPE)
+    rc = @ccall listen(
+        socket_fd::FD_TYPE,
+        SOMAXCONN::Cint)::Cint
+
+    if rc != 0
+        throw("Cannot listen to socket")
+    end
+end
+
+function uds_accept(socket_fd::FD_TYPE)
+    client_fd = @ccall accept(
+        socket_fd::FD_TYPE,
+        C_NULL::Ptr{Cvoid},
+        C_NULL::Ptr{Cvoid})::FD_TYPE
+
+    if client_fd != INVALID_SOCKET
+        return client_fd
+    end
+
+    throw("Error at accepting client socket")
+end
+
+function uds_read(socket_fd::FD_TYPE, data::Ptr{UInt8}, nb::Int64)
+    while true
+        rc = @ccall recv(
+            socket_fd::FD_TYPE,
+            data::Ptr{UInt8},
+            Csize_t(nb)::Csize_t,
+            Cint(0)::Cint)::Cssize_t
+        if rc > 0
+            return Int64(rc)
+        elseif rc < 0 && Libc.errno() == Libc.EINTR
+            continue
+        else
+            error("Server killed")
+        end
+    end
+end
+
+function uds_write(socket_fd::FD_TYPE, data::Ptr{UInt8}, nb::Int64)
+    while true
+        sent = @ccall send(
+            socket_fd::FD_TYPE,
+            data::Ptr{UInt8},
+            Csize_t(nb)::Csize_t,
+            MSG_NOSIGNAL::Cint)::Cssize_t
+        if sent > 0
+            return Int64(sent)
+        elseif sent < 0 && Libc.errno() == Libc.EINTR
+            continue
+        else
+            error("Server killed")
+        end
+    end
+end
+
+function uds_close(socket_fd::FD_TYPE)
+    @ccall close(
+        socket_fd::FD_TYPE)::Cint
+end
+
+end
+
 
 mutable struct Buffer
     data::Vector{UInt8}
@@ -156,8 +289,16 @@ struct BufferedUDS
     socket_fd::FD_TYPE
     input::Buffer
     output::Buffer
+    shm::SharedMemoryRegion
+    schemas::Schemas
+    cache::ArgumentCache
+    plans::Plans
+    bits::BitPacking
 end
 
+BufferedUDS(socket_fd, input::Buffer, output::Buffer) = BufferedUDS(socket_fd, input, output, SharedMemoryRegion())
+BufferedUDS(socket_fd, input::Buffer, output::Buffer, shm::SharedMemoryRegion) = BufferedUDS(socket_fd, input, output, shm, Schemas(), ArgumentCache(), Plans(), BitPacking())
+
 @noinline function flush!(socket::BufferedUDS)  
     out = socket.output
     while (out.available > out.position) 
@@ -1,6 +1,6 @@
 module _Types
 
-export MATFrostArrayAbstract, MATFrostArrayEmpty, MATFrostArrayPrimitive, MATFrostArrayString, MATFrostArrayCell, MATFrostArrayStruct, MATFrostException, MATFrostConversionException
+export MATFrostArrayAbstract, MATFrostArrayEmpty, MATFrostArrayPrimitive, MATFrostArrayString, MATFrostArrayCell, MATFrostArrayStruct, MATFrostArraySparse, MATFrostException, MATFrostConversionException
 
 abstract type MATFrostArrayAbstract end
 
@@ -28,6 +28,17 @@ struct MATFrostArrayStruct <: MATFrostArrayAbstract
     values::Vector{MATFrostArrayAbstract}
 end
 
+"""
+Sparse matrix in compressed-column form, one-based as `SparseMatrixCSC`. MATLAB only has sparse logical, double and
+complex double matrices.
+"""
+struct MATFrostArraySparse{T<:Union{Bool,Float64,Complex{Float64}}} <: MATFrostArrayAbstract
+    dims::Vector{Int64}
+    colptr::Vector{Int64}
+    rowval::Vector{Int64}
+    nzval::Vector{T}
+end
+
 struct MATFrostException <: Exception 
     id::String
     message::String
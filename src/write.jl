@@ -3,6 +3,9 @@ module _Write
 
 
 import ..MATFrost._Stream: read!, write!, flush!, BufferedUDS
+import ..MATFrost._SharedMemory: begin_write!, writes, shm_write!, end_write!
+import ..MATFrost._Schemas: intern!
+import ..MATFrost._Bits: BitPacking, packs, packed_nbytes, pack_bits
 
 using .._Constants
 using .._Types
@@ -15,47 +18,258 @@ using .._Types
 end
 
 @noinline function write_matfrostarray_primitive!(socket::BufferedUDS, marr::MATFrostArrayPrimitive{T}) where {T<: Number}
-    write!(socket, matlab_type(T))
+    nb = sizeof(T)*length(marr.values)
+    shared = writes(socket.shm, nb)
+
+    write!(socket, shared ? matlab_type(T) | ENCODING_SHARED_MEMORY : matlab_type(T))
+    write!(socket, length(marr.dims))
+    for dim in marr.dims
+        write!(socket, dim)
+    end
+    if shared
+        shm_write!(socket.shm, reinterpret(Ptr{UInt8}, pointer(marr.values)), nb)
+    else
+        write!(socket, marr.values)
+    end
+end
+
+"""
+Logical arrays of at least the negotiated number of elements are sent bit-packed, see `_Bits`:
+
+[LOGICAL|BIT_PACKED][ndims][dims][packed_nbytes(nel) bytes]
+
+Arrays placed in shared memory keep one byte per element.
+"""
+@noinline function write_matfrostarray_logical!(socket::BufferedUDS, marr::MATFrostArrayPrimitive{Bool})
+    nel = length(marr.values)
+    if !packs(socket.bits, nel) || writes(socket.shm, nel)
+        return write_matfrostarray_primitive!(socket, marr)
+    end
+
+    write!(socket, LOGICAL | ENCODING_BIT_PACKED)
     write!(socket, length(marr.dims))
     for dim in marr.dims
         write!(socket, dim)
     end
-    write!(socket, marr.values)
+    write!(socket, pack_bits(marr.values))
 end
 
+"""
+String arrays are sent as every string as [nbytes][UTF-8]. Arrays of at least `PACKED_MIN_STRINGS` strings are tagged
+`MATLAB_STRING | ENCODING_PACKED` and send an offsets table and all strings back to back instead:
+
+[MATLAB_STRING|PACKED][ndims][dims][offsets (nel+1)][UTF-8 blob]
+"""
 @noinline function write_matfrostarray_string!(socket::BufferedUDS, marr::MATFrostArrayString)
-    write!(socket, MATLAB_STRING)
+    packed = length(marr.values) >= PACKED_MIN_STRINGS
+    write!(socket, packed ? MATLAB_STRING | ENCODING_PACKED : MATLAB_STRING)
     write!(socket, length(marr.dims))
     for dim in marr.dims
         write!(socket, dim)
     end
+    if !packed
+        for s in marr.values
+            write!(socket, s)
+        end
+        return
+    end
+
+    offset = 0
+    write!(socket, offset)
     for s in marr.values
-        write!(socket, s)
+        offset += ncodeunits(s)
+        write!(socket, offset)
+    end
+    for s in marr.values
+        GC.@preserve s write!(socket, pointer(s), ncodeunits(s))
     end
 end
 
-@noinline function write_matfrostarray_cell!(socket::BufferedUDS, marr::MATFrostArrayCell)
-    write!(socket, CELL)
+"""
+Sparse matrices are sent in compressed-column form, the layout of `SparseMatrixCSC`:
+
+[type][ndims=2][rows][cols][nnz][colptr (cols+1)][rowval nnz][nzval nnz]
+
+Sparse matrices are never placed in shared memory.
+"""
+@noinline function write_matfrostarray_sparse!(socket::BufferedUDS, marr::MATFrostArraySparse{T}) where {T}
+    write!(socket, matlab_type(marr))
     write!(socket, length(marr.dims))
     for dim in marr.dims
         write!(socket, dim)
     end
+    write!(socket, length(marr.nzval))
+    write!(socket, marr.colptr)
+    write!(socket, marr.rowval)
+    write!(socket, marr.nzval)
+end
+
+"""
+Whether the column, the elements of a cell array or the values of a single struct field, is sent with the columnar
+encoding: at least two non-empty primitive arrays, all of the same type and dimensions.
+"""
+function columnar(@nospecialize(column::AbstractVector{MATFrostArrayAbstract}))::Bool
+    if length(column) < 2
+        return false
+    end
+    first = column[1]
+    if !(first isa MATFrostArrayPrimitive) || isempty(first.values)
+        return false
+    end
+    for v in column
+        if typeof(v) !== typeof(first) || v.dims != first.dims
+            return false
+        end
+    end
+    true
+end
+
+"""
+Payload bytes of a columnar column.
+"""
+function column_nbytes(@nospecialize(column::AbstractVector{MATFrostArrayAbstract}))::Int64
+    first = column[1]
+    sizeof_matlab_primitive(matlab_type_nospecialize(first)) * length(first.values) * length(column)
+end
+
+"""
+Columns of a struct array, one per field. Empty if the struct array is sent element by element: a struct array is sent
+by column if it has at least two elements and at least one of its fields is columnar.
+"""
+function struct_columns(marr::MATFrostArrayStruct)
+    nfields = length(marr.fieldnames)
+    if nfields == 0 || prod(marr.dims; init=1) < 2
+        return SubArray[]
+    end
+    columns = SubArray[view(marr.values, fi:nfields:length(marr.values)) for fi in 1:nfields]
+    any(columnar, columns) ? columns : SubArray[]
+end
+
+@noinline function write_column_values!(socket::BufferedUDS, ::Type{T}, @nospecialize(column::AbstractVector{MATFrostArrayAbstract}), shared::Bool) where {T<:Number}
+    for v in column
+        values = (v::MATFrostArrayPrimitive{T}).values
+        if shared
+            shm_write!(socket.shm, reinterpret(Ptr{UInt8}, pointer(values)), sizeof(T)*length(values))
+        else
+            write!(socket, values)
+        end
+    end
+end
+
+"""
+Write a column as a cell array of dimensions `dims`. A columnar column is tagged `CELL | ENCODING_COLUMNAR` and
+followed by a single header for all elements and their payloads back to back:
+
+[CELL|COLUMNAR][ndims][dims][type][elem ndims][elem dims][payload 1]...[payload n]
+
+The payloads go to shared memory as a whole. Other columns are sent as a regular cell array.
+"""
+@noinline function write_matfrostarray_column!(socket::BufferedUDS, dims::Vector{Int64}, @nospecialize(column::AbstractVector{MATFrostArrayAbstract}))
+    col = columnar(column)
+
+    write!(socket, col ? CELL | ENCODING_COLUMNAR : CELL)
+    write!(socket, length(dims))
+    for dim in dims
+        write!(socket, dim)
+    end
 
-    for v in marr.values
-        write_matfrostarray!(socket, v)
+    if !col
+        for v in column
+            write_matfrostarray!(socket, v)
+        end
+        return
+    end
+
+    first = column[1]
+    shared = writes(socket.shm, column_nbytes(column))
+
+    write!(socket, shared ? matlab_type_nospecialize(first) | ENCODING_SHARED_MEMORY : matlab_type_nospecialize(first))
+    write!(socket, length(first.dims))
+    for dim in first.dims
+        write!(socket, dim)
+    end
+
+    if first isa MATFrostArrayPrimitive{Bool}
+        write_column_values!(socket, Bool, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Float64}
+        write_column_values!(socket, Float64, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Float32}
+        write_column_values!(socket, Float32, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Complex{Float64}}
+        write_column_values!(socket, Complex{Float64}, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Complex{Float32}}
+        write_column_values!(socket, Complex{Float32}, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Int8}
+        write_column_values!(socket, Int8, column, shared)
+    elseif first isa MATFrostArrayPrimitive{UInt8}
+        write_column_values!(socket, UInt8, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Int16}
+        write_column_values!(socket, Int16, column, shared)
+    elseif first isa MATFrostArrayPrimitive{UInt16}
+        write_column_values!(socket, UInt16, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Int32}
+        write_column_values!(socket, Int32, column, shared)
+    elseif first isa MATFrostArrayPrimitive{UInt32}
+        write_column_values!(socket, UInt32, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Int64}
+        write_column_values!(socket, Int64, column, shared)
+    elseif first isa MATFrostArrayPrimitive{UInt64}
+        write_column_values!(socket, UInt64, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Complex{Int8}}
+        write_column_values!(socket, Complex{Int8}, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Complex{UInt8}}
+        write_column_values!(socket, Complex{UInt8}, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Complex{Int16}}
+        write_column_values!(socket, Complex{Int16}, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Complex{UInt16}}
+        write_column_values!(socket, Complex{UInt16}, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Complex{Int32}}
+        write_column_values!(socket, Complex{Int32}, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Complex{UInt32}}
+        write_column_values!(socket, Complex{UInt32}, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Complex{Int64}}
+        write_column_values!(socket, Complex{Int64}, column, shared)
+    elseif first isa MATFrostArrayPrimitive{Complex{UInt64}}
+        write_column_values!(socket, Complex{UInt64}, column, shared)
+    else
+        error("Unrecoverable crash - MATFrost communication channel corrupted at write side")
     end
 end
 
+@noinline function write_matfrostarray_cell!(socket::BufferedUDS, marr::MATFrostArrayCell)
+    write_matfrostarray_column!(socket, marr.dims, marr.values)
+end
+
+"""
+Struct arrays are sent element by element, values in field order per element. Struct arrays with columnar fields are
+tagged `STRUCT | ENCODING_COLUMNAR` and sent field by field instead: every field as a column, see
+`write_matfrostarray_column!`.
+"""
 @noinline function write_matfrostarray_struct!(socket::BufferedUDS, marr::MATFrostArrayStruct)
-    write!(socket, STRUCT)
+    schema = intern!(socket.schemas.written, marr.fieldnames)
+    columns = struct_columns(marr)
+
+    tag = schema >= 0 ? STRUCT | ENCODING_SCHEMA_REFERENCE : STRUCT
+    write!(socket, isempty(columns) ? tag : tag | ENCODING_COLUMNAR)
     write!(socket, length(marr.dims))
     for dim in marr.dims
         write!(socket, dim)
     end
 
-    write!(socket, length(marr.fieldnames))
-    for fn in marr.fieldnames
-        write!(socket, String(fn))
+    if schema >= 0
+        write!(socket, schema)
+    else
+        write!(socket, length(marr.fieldnames))
+        for fn in marr.fieldnames
+            write!(socket, String(fn))
+        end
+    end
+
+    if !isempty(columns)
+        for column in columns
+            write_matfrostarray_column!(socket, marr.dims, column)
+        end
+        return
     end
 
     for v in marr.values
@@ -76,8 +290,15 @@ end
     elseif marr isa MATFrostArrayString
         write_matfrostarray_string!(socket, marr)
         
+    elseif marr isa MATFrostArraySparse{Bool}
+        write_matfrostarray_sparse!(socket, marr)
+    elseif marr isa MATFrostArraySparse{Float64}
+        write_matfrostarray_sparse!(socket, marr)
+    elseif marr isa MATFrostArraySparse{Complex{Float64}}
+        write_matfrostarray_sparse!(socket, marr)
+
     elseif marr isa MATFrostArrayPrimitive{Bool}
-        write_matfrostarray_primitive!(socket, marr)
+        write_matfrostarray_logical!(socket, marr)
 
     elseif marr isa MATFrostArrayPrimitive{Float64}
         write_matfrostarray_primitive!(socket, marr)
@@ -129,5 +350,127 @@ end
 
 end
 
+function column_shared_memory_nbytes(@nospecialize(column::AbstractVector{MATFrostArrayAbstract}), threshold::Int64)::Int64
+    if columnar(column)
+        nb = column_nbytes(column)
+        return nb >= threshold ? nb : 0
+    end
+    nb = 0
+    for v in column
+        nb += shared_memory_nbytes(v, threshold)
+    end
+    nb
+end
+
+"""
+Total number of payload bytes placed in shared memory. Must mirror the decision in `write_matfrostarray_primitive!`
+and `write_matfrostarray_column!`.
+"""
+function shared_memory_nbytes(@nospecialize(marr::MATFrostArrayAbstract), threshold::Int64)::Int64
+    if marr isa MATFrostArrayPrimitive
+        nb = sizeof(eltype(marr.values))*length(marr.values)
+        nb >= threshold ? nb : 0
+    elseif marr isa MATFrostArrayCell
+        column_shared_memory_nbytes(marr.values, threshold)
+    elseif marr isa MATFrostArrayStruct
+        columns = struct_columns(marr)
+        nb = 0
+        for column in columns
+            nb += column_shared_memory_nbytes(column, threshold)
+        end
+        if !isempty(columns)
+            return nb
+        end
+        for v in marr.values
+            nb += shared_memory_nbytes(v, threshold)
+        end
+        nb
+    else
+        0
+    end
+end
+
+header_nbytes(dims) = sizeof(Int32) + sizeof(Int64) + sizeof(Int64)*length(dims)
+
+function column_socket_nbytes(dims::Vector{Int64}, @nospecialize(column::AbstractVector{MATFrostArrayAbstract}), shared::Bool, threshold::Int64, bits::BitPacking, written::Dict{Vector{Symbol}, Int64})::Int64
+    nb = header_nbytes(dims)
+    if columnar(column)
+        payload = column_nbytes(column)
+        return nb + header_nbytes(column[1].dims) + ((shared && payload >= threshold) ? 0 : payload)
+    end
+    for v in column
+        nb += socket_nbytes(v, shared, threshold, bits, written)
+    end
+    nb
+end
+
+"""
+Number of bytes `write_matfrostarray!` puts on the socket, given whether a shared memory block is available and the
+bit packing threshold.
+Must mirror `write_matfrostarray!`, `written` tracks the struct schemas as `write_matfrostarray!` would.
+"""
+function socket_nbytes(@nospecialize(marr::MATFrostArrayAbstract), shared::Bool, threshold::Int64, bits::BitPacking, written::Dict{Vector{Symbol}, Int64})::Int64
+    if marr isa MATFrostArrayEmpty
+        header_nbytes(1)
+    elseif marr isa MATFrostArrayPrimitive
+        nb = sizeof(eltype(marr.values))*length(marr.values)
+        if shared && nb >= threshold
+            header_nbytes(marr.dims)
+        elseif marr isa MATFrostArrayPrimitive{Bool} && packs(bits, nb)
+            header_nbytes(marr.dims) + packed_nbytes(nb)
+        else
+            header_nbytes(marr.dims) + nb
+        end
+    elseif marr isa MATFrostArrayString
+        nb = header_nbytes(marr.dims) + (length(marr.values) >= PACKED_MIN_STRINGS ? sizeof(Int64) : 0)
+        for s in marr.values
+            nb += sizeof(Int64) + sizeof(s)
+        end
+        nb
+    elseif marr isa MATFrostArraySparse
+        header_nbytes(marr.dims) + sizeof(Int64) + sizeof(marr.colptr) + sizeof(marr.rowval) + sizeof(marr.nzval)
+    elseif marr isa MATFrostArrayCell
+        column_socket_nbytes(marr.dims, marr.values, shared, threshold, bits, written)
+    elseif marr isa MATFrostArrayStruct
+        nb = header_nbytes(marr.dims) + sizeof(Int64)
+        if intern!(written, marr.fieldnames) < 0
+            for fn in marr.fieldnames
+                nb += sizeof(Int64) + sizeof(String(fn))
+            end
+        end
+        columns = struct_columns(marr)
+        if !isempty(columns)
+            for column in columns
+                nb += column_socket_nbytes(marr.dims, column, shared, threshold, bits, written)
+            end
+            return nb
+        end
+        for v in marr.values
+            nb += socket_nbytes(v, shared, threshold, bits, written)
+        end
+        nb
+    else
+        error("Unrecoverable crash - MATFrost communication channel corrupted at write side")
+    end
+end
+
+"""
+Write a complete message: [request_id][nbytes][shm offset][shm advance][array]. `nbytes` is the number of bytes of the
+array on the socket, such that a message can be skipped without decoding it. Struct field names are interned per
+message, see `_Schemas`.
+"""
+function write_message!(socket::BufferedUDS, request_id::UInt64, @nospecialize(marr::MATFrostArrayAbstract))
+    blk = begin_write!(socket.shm, shared_memory_nbytes(marr, socket.shm.threshold))
+
+    write!(socket, request_id)
+    write!(socket, socket_nbytes(marr, blk.active, socket.shm.threshold, socket.bits, Dict{Vector{Symbol}, Int64}()))
+    write!(socket, blk.offset)
+    write!(socket, blk.advance)
+    empty!(socket.schemas.written)
+    write_matfrostarray!(socket, marr)
+
+    end_write!(socket.shm)
+end
+
 
 end
\ No newline at end of file
@@ -1,5 +1,7 @@
 module MATFrostTest
 
+using SparseArrays
+import MATFrost
 
 export compute_measure
 elementwise_addition_f64(c::Float64, x::Vector{Float64}) = c .+ x
@@ -16,6 +18,8 @@ function sum_vector_of_vector_f64(vs::Vector{Vector{Float64}}) :: Float64
     acc
 end
 
+identity_vector_of_vector_f64(vs::Vector{Vector{Float64}}) = vs
+
 struct CompositeNumberType
     v1::Int64
     v2::Int32
@@ -41,6 +45,8 @@ function largest_population_vector(ps::Vector{SimplePopulationType})
     mp
 end
 
+identity_population_vector(ps::Vector{SimplePopulationType}) = ps
+
 
 struct Nest1
     v1::Float64
@@ -139,11 +145,71 @@ matfrost_xor(b1::Bool, b2::Bool) = xor(b1, b2)
 
 matfrost_elementwise_xor(v1::Vector{Bool}, v2::Vector{Bool}) = Vector{Bool}(xor.(v1, v2))
 
+identity_matrix_bool(m::Matrix{Bool}) = m
+
+count_true(v::Vector{Bool}) = count(v)
+
 
 repeat_string(s::String, num::Int64) = reduce(*, (s for _ in 1:num))
 
 concat_strings(s::Vector{String}) = reduce(*, s)
 
+identity_vector_string(s::Vector{String}) = s
+
+string_ncodeunits(s::Vector{String}) = ncodeunits.(s)
+
+# Prints n numbered lines to stdout, more than fits the pipe to MATLAB for large n.
+function print_lines(n::Int64) :: Int64
+    for i in 1:n
+        println("MATFrostTest line ", i)
+    end
+    flush(stdout)
+    n
+end
+
+# Identifies the Julia worker process handling a call. The argument is ignored.
+worker_process_id(::Float64) = Int64(getpid())
+
+# Streams 1:n in chunks of at most chunk elements.
+stream_chunks(n::Int64, chunk::Int64) = (collect(Float64, i:min(i + chunk - 1, n)) for i in 1:chunk:n)
+
+# Streams chunks produced by a task, the k-th chunk holds k copies of k.
+stream_channel(n::Int64) = Channel{Vector{Int64}}(1) do ch
+    for k in 1:n
+        put!(ch, fill(k, k))
+    end
+end
+
+# Streams 1.0, 2.0, ... and fails at chunk n.
+stream_failing(n::Int64) = (k < n ? Float64(k) : error("Stream failed at chunk $(k)") for k in 1:n)
+
+# Consumes an upload: the sum of all elements and the number of chunks.
+function upload_total(chunks::MATFrost.UploadStream{Vector{Float64}}) :: Vector{Float64}
+    total = 0.0
+    n = 0
+    for chunk in chunks
+        total += sum(chunk)
+        n += 1
+    end
+    [total, n]
+end
+
+upload_concat(prefix::String, chunks::MATFrost.UploadStream{String}) = prefix * join(chunks)
+
+# Takes s seconds, to be cancelled.
+function sleep_seconds(s::Float64) :: Float64
+    sleep(s)
+    s
+end
+
+
+# Sparse matrices, sent in compressed-column form.
+identity_sparse_f64(A::SparseMatrixCSC{Float64, Int64}) = A
+identity_sparse_bool(A::SparseMatrixCSC{Bool, Int64}) = A
+identity_sparse_complex_f64(A::SparseMatrixCSC{ComplexF64, Int64}) = A
+sparse_matrix_vector_f64(A::SparseMatrixCSC{Float64, Int64}, x::Vector{Float64}) = A * x
+sparse_laplacian_1d(n::Int64) = spdiagm(-1 => fill(-1.0, n-1), 0 => fill(2.0, n), 1 => fill(-1.0, n-1))
+sparse_nnz(A::SparseMatrixCSC{Float64, Int64}) = Int64(nnz(A))
 
 double_scalar_f32(v::Float32) = v+v
 double_scalar_f64(v::Float64) = v+v
@@ -0,0 +1,101 @@
+module BitPackingTest
+
+using Test
+
+using MATFrost._Stream: BufferedUDS, Buffer, write!
+using MATFrost._Read: read_message!
+using MATFrost._Write: write_message!
+using MATFrost._Bits: pack_bits, unpack_bits!, packed_nbytes
+using MATFrost._Types
+using MATFrost._Constants
+
+function roundtrip(marr; threshold=64)
+    buffer = Buffer(Vector{UInt8}(undef, 2 << 16), 0, 0)
+    stream = BufferedUDS(C_NULL, buffer, buffer)
+    stream.bits.threshold = threshold
+
+    write_message!(stream, UInt64(1), marr)
+    tag = reinterpret(Int32, buffer.data[33:36])[1]
+    @test reinterpret(Int64, buffer.data[9:16])[1] == buffer.available - 32
+
+    (_, result) = read_message!(stream)
+    @test buffer.available == buffer.position
+    (tag, result, buffer.available - 32)
+end
+
+@testset "BitPacking-Kernels" begin
+    for nel in [0:130; 1000; 4097]
+        values = rand(Bool, nel)
+        packed = pack_bits(values)
+        @test length(packed) == packed_nbytes(nel)
+        @test packed == reinterpret(UInt8, BitVector(values).chunks)[1:packed_nbytes(nel)]
+        @test unpack_bits!(Vector{Bool}(undef, nel), packed) == values
+    end
+end
+
+@testset "BitPacking-Roundtrip" begin
+    values = rand(Bool, 300, 7)
+    (tag, result, nb) = roundtrip(MATFrostArrayPrimitive{Bool}([300, 7], vec(values)))
+    @test tag == LOGICAL | ENCODING_BIT_PACKED
+    @test nb == sizeof(Int32) + 3*sizeof(Int64) + packed_nbytes(2100)
+    @test result isa MATFrostArrayPrimitive{Bool}
+    @test result.dims == [300, 7]
+    @test result.values == vec(values)
+end
+
+@testset "BitPacking-BelowThreshold" begin
+    values = rand(Bool, 63)
+    (tag, result, nb) = roundtrip(MATFrostArrayPrimitive{Bool}([63], values))
+    @test tag == LOGICAL
+    @test nb == sizeof(Int32) + 2*sizeof(Int64) + 63
+    @test result.values == values
+
+    # A threshold of 0 disables bit packing.
+    values = rand(Bool, 1000)
+    (tag, result, _) = roundtrip(MATFrostArrayPrimitive{Bool}([1000], values); threshold=0)
+    @test tag == LOGICAL
+    @test result.values == values
+end
+
+@testset "BitPacking-Nested" begin
+    mask = rand(Bool, 65)
+    marr = MATFrostArrayCell([1, 3], MATFrostArrayAbstract[
+        MATFrostArrayPrimitive{Bool}([65], mask),
+        MATFrostArrayPrimitive{Bool}([2], [true, false]),
+        MATFrostArrayPrimitive{Float64}([1], [1.5])])
+    (_, result, _) = roundtrip(marr)
+    @test result.values[1].values == mask
+    @test result.values[2].values == [true, false]
+    @test result.values[3].values == [1.5]
+end
+
+@testset "BitPacking-PlanReference" begin
+    # The MEX packs logical payloads of plan references without a tag, Julia follows the negotiated threshold.
+    buffer = Buffer(Vector{UInt8}(undef, 2 << 16), 0, 0)
+    stream = BufferedUDS(C_NULL, buffer, buffer)
+    stream.bits.threshold = 64
+
+    mask = rand(Bool, 100)
+    write!(stream, UInt64(1)); write!(stream, Int64(0)); write!(stream, Int64(0)); write!(stream, Int64(0))
+    write!(stream, LOGICAL | ENCODING_PLAN)
+    write!(stream, Int64[1, 100])
+    write!(stream, Int64(0))
+    write!(stream, LOGICAL | ENCODING_BIT_PACKED)
+    write!(stream, Int64[1, 100])
+    write!(stream, pack_bits(mask))
+    (_, result) = read_message!(stream)
+    @test result.values == mask
+
+    mask = rand(Bool, 100)
+    write!(stream, UInt64(2)); write!(stream, Int64(0)); write!(stream, Int64(0)); write!(stream, Int64(0))
+    write!(stream, LOGICAL | ENCODING_PLAN_REFERENCE)
+    write!(stream, Int64[1, 100])
+    write!(stream, Int64(0))
+    write!(stream, typemax(UInt64))
+    write!(stream, pack_bits(mask))
+    (_, result) = read_message!(stream)
+    @test buffer.available == buffer.position
+    @test result.values == mask
+end
+
+end
@@ -0,0 +1,83 @@
+module CacheTest
+
+using Test
+
+using MATFrost._Stream: BufferedUDS, Buffer, write!
+using MATFrost._Read: read_message!
+using MATFrost._Types
+using MATFrost._Constants
+
+"""
+Message as the MEX writes it, with a cell array of primitive arrays given as (encoding, digest, values).
+"""
+function write_cached_message!(stream::BufferedUDS, arrays)
+    write!(stream, UInt64(1))
+    write!(stream, Int64(0))
+    write!(stream, Int64(0))
+    write!(stream, Int64(0))
+
+    write!(stream, CELL)
+    write!(stream, Int64[2, 1, length(arrays)])
+    for (encoding, digest, values) in arrays
+        write!(stream, DOUBLE | encoding)
+        write!(stream, Int64[2, length(values), 1])
+        write!(stream, digest)
+        if encoding == ENCODING_CACHED
+            write!(stream, values)
+        end
+    end
+end
+
+@testset "Cache-StoreAndReference" begin
+    buffer = Buffer(Vector{UInt8}(undef, 2 << 16), 0, 0)
+    stream = BufferedUDS(C_NULL, buffer, buffer)
+    stream.cache.budget = 1 << 20
+
+    table = collect(1.0:1000.0)
+    write_cached_message!(stream, [(ENCODING_CACHED, UInt64(42), table), (ENCODING_CACHE_REFERENCE, UInt64(42), table)])
+    (_, result) = read_message!(stream)
+    @test buffer.available == buffer.position
+    @test result.values[1].values == table
+    @test result.values[2].values == table
+
+    # Every array is a copy, modifying an argument leaves the cache intact.
+    @test result.values[1].values !== result.values[2].values
+    result.values[1].values[1] = -1.0
+
+    write_cached_message!(stream, [(ENCODING_CACHE_REFERENCE, UInt64(42), table)])
+    (_, result) = read_message!(stream)
+    @test result.values[1].values == table
+    @test length(stream.cache.entries) == 1
+end
+
+@testset "Cache-Eviction" begin
+    buffer = Buffer(Vector{UInt8}(undef, 2 << 16), 0, 0)
+    stream = BufferedUDS(C_NULL, buffer, buffer)
+    a = fill(1.0, 100)
+    b = fill(2.0, 100)
+    c = fill(3.0, 100)
+    stream.cache.budget = 2 * sizeof(a)
+
+    write_cached_message!(stream, [(ENCODING_CACHED, UInt64(1), a)])
+    read_message!(stream)
+    write_cached_message!(stream, [(ENCODING_CACHED, UInt64(2), b)])
+    read_message!(stream)
+    # Touch a: b becomes the least recently used.
+    write_cached_message!(stream, [(ENCODING_CACHE_REFERENCE, UInt64(1), a)])
+    read_message!(stream)
+    write_cached_message!(stream, [(ENCODING_CACHED, UInt64(3), c)])
+    read_message!(stream)
+
+    @test sort(collect(keys(stream.cache.entries))) == UInt64[1, 3]
+    @test stream.cache.total == 2 * sizeof(a)
+
+    # Used in the same message: evicted in order of digest.
+    write_cached_message!(stream, [(ENCODING_CACHED, UInt64(8), a), (ENCODING_CACHED, UInt64(6), b), (ENCODING_CACHED, UInt64(7), c)])
+    read_message!(stream)
+    @test sort(collect(keys(stream.cache.entries))) == UInt64[7, 8]
+
+    write_cached_message!(stream, [(ENCODING_CACHE_REFERENCE, UInt64(1), a)])
+    @test_throws ErrorException read_message!(stream)
+end
+
+end
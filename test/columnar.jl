@@ -0,0 +1,90 @@
+module ColumnarTest
+
+using Test
+
+using MATFrost._Stream: BufferedUDS, Buffer
+using MATFrost._Read: read_message!
+using MATFrost._Write: write_message!
+using MATFrost._Types
+using MATFrost._Constants
+
+function record(i)
+    MATFrostArrayAbstract[
+        MATFrostArrayPrimitive{Float64}([1, 1], [Float64(i)]),
+        MATFrostArrayString([1, 1], ["Record$(i)"]),
+        MATFrostArrayPrimitive{Int32}([1, 3], Int32[i, 2i, 3i])]
+end
+
+function roundtrip(marr)
+    buffer = Buffer(Vector{UInt8}(undef, 2 << 16), 0, 0)
+    stream = BufferedUDS(C_NULL, buffer, buffer)
+
+    write_message!(stream, UInt64(1), marr)
+    tag = reinterpret(Int32, buffer.data[33:36])[1]
+    @test reinterpret(Int64, buffer.data[9:16])[1] == buffer.available - 32
+
+    (_, result) = read_message!(stream)
+    @test buffer.available == buffer.position
+    (tag, result)
+end
+
+@testset "Columnar-StructArray" begin
+    n = 50
+    values = MATFrostArrayAbstract[]
+    for i in 1:n
+        append!(values, record(i))
+    end
+    marr = MATFrostArrayStruct([1, n], [:x, :name, :v], values)
+
+    (tag, result) = roundtrip(marr)
+    @test tag & TYPE_MASK == STRUCT
+    @test tag & ENCODING_COLUMNAR != 0
+
+    @test result.dims == [1, n]
+    @test result.fieldnames == [:x, :name, :v]
+    @test length(result.values) == 3n
+    for i in 1:n
+        @test result.values[3(i-1)+1].values == [Float64(i)]
+        @test result.values[3(i-1)+2].values == ["Record$(i)"]
+        @test result.values[3(i-1)+3].dims == [1, 3]
+        @test result.values[3(i-1)+3].values == Int32[i, 2i, 3i]
+    end
+end
+
+@testset "Columnar-Cell" begin
+    marr = MATFrostArrayCell([2, 2], MATFrostArrayAbstract[
+        MATFrostArrayPrimitive{Complex{Float64}}([2, 1], [Complex(i, -i), Complex(0.0, i)]) for i in 1:4])
+
+    (tag, result) = roundtrip(marr)
+    @test tag == CELL | ENCODING_COLUMNAR
+    @test result.dims == [2, 2]
+    for i in 1:4
+        @test result.values[i] isa MATFrostArrayPrimitive{Complex{Float64}}
+        @test result.values[i].values == [Complex(i, -i), Complex(0.0, i)]
+    end
+end
+
+@testset "Columnar-NotHomogeneous" begin
+    # Element types differ: regular cell array.
+    marr = MATFrostArrayCell([1, 2], MATFrostArrayAbstract[
+        MATFrostArrayPrimitive{Float64}([1, 1], [1.0]), MATFrostArrayPrimitive{Float32}([1, 1], [2.0f0])])
+    (tag, result) = roundtrip(marr)
+    @test tag == CELL
+    @test result.values[2].values == [2.0f0]
+
+    # Single struct: element by element, also if its values happen to be homogeneous.
+    marr = MATFrostArrayStruct([1, 1], [:a, :b], MATFrostArrayAbstract[
+        MATFrostArrayPrimitive{Float64}([1, 1], [1.0]), MATFrostArrayPrimitive{Float64}([1, 1], [2.0])])
+    (tag, result) = roundtrip(marr)
+    @test tag == STRUCT
+    @test result.values[2].values == [2.0]
+
+    # Struct array without columnar fields.
+    marr = MATFrostArrayStruct([1, 2], [:name], MATFrostArrayAbstract[
+        MATFrostArrayString([1, 1], ["a"]), MATFrostArrayString([1, 1], ["b"])])
+    (tag, result) = roundtrip(marr)
+    @test tag == STRUCT
+    @test result.values[2].values == ["b"]
+end
+
+end
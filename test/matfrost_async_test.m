@@ -0,0 +1,59 @@
+classdef matfrost_async_test < matfrost_abstract_test
+% Unit test for matfrostjulia asynchronous calls: callasync, poll, wait and fetch.
+
+    methods(Test, TestTags="async function call")
+        function callasync_fetch(tc)
+            request = tc.mjl.callasync("MATFrostTest.elementwise_addition_f64", 2.0, [1.0, 2.0, 3.0]);
+            res = tc.mjl.fetch(request);
+            tc.verifyEqual(res, [3.0, 4.0, 5.0]');
+        end
+
+        function callasync_signature(tc)
+            request = tc.mjl.callasync("MATFrostTest.multiple_method_definitions", 23.0, signature="Float64");
+            tc.verifyEqual(tc.mjl.fetch(request), 46.0);
+        end
+
+        function multiple_requests_fetched_out_of_order(tc)
+            requests = arrayfun(@(k) tc.mjl.callasync("MATFrostTest.repeat_string", "ab", int64(k), signature=["String","Int64"]), 1:5);
+            for k = 5:-1:1
+                tc.verifyEqual(tc.mjl.fetch(requests(k)), string(repmat('ab', 1, k)));
+            end
+        end
+
+        function poll_after_wait(tc)
+            request = tc.mjl.callasync("MATFrostTest.elementwise_addition_f64", 1.0, [1.0, 2.0]);
+            tc.mjl.wait(request);
+            tc.verifyTrue(tc.mjl.poll(request));
+            tc.verifyEqual(tc.mjl.fetch(request), [2.0, 3.0]');
+        end
+
+        function synchronous_call_between_async(tc)
+            request = tc.mjl.callasync("MATFrostTest.elementwise_addition_f64", 1.0, [1.0, 2.0]);
+            res = tc.mjl.MATFrostTest.elementwise_addition_f64(2.0, [1.0, 2.0]);
+            tc.verifyEqual(res, [3.0, 4.0]');
+            tc.verifyEqual(tc.mjl.fetch(request), [2.0, 3.0]');
+        end
+
+        function deep_pipeline(tc)
+            % Requests and responses together exceed the socket buffers: neither side may block on writing.
+            x = (1:1e5)';
+            requests = arrayfun(@(k) tc.mjl.callasync("MATFrostTest.elementwise_addition_f64", double(k), x), 1:64);
+            for k = 64:-1:1
+                tc.verifyEqual(tc.mjl.fetch(requests(k)), x + k);
+            end
+        end
+    end
+
+    methods(Test, TestTags="ErrorHandling")
+        function error_raised_on_fetch(tc)
+            request = tc.mjl.callasync("MATFrostTest.function_does_not_exist");
+            tc.verifyError(@() tc.mjl.fetch(request), 'matfrostjulia:call:functionNotFound');
+        end
+
+        function fetch_twice(tc)
+            request = tc.mjl.callasync("MATFrostTest.elementwise_addition_f64", 1.0, [1.0, 2.0]);
+            tc.mjl.fetch(request);
+            tc.verifyError(@() tc.mjl.fetch(request), 'matfrostjulia:request:notFound');
+        end
+    end
+end
@@ -0,0 +1,32 @@
+classdef matfrost_bitpacking_test < matfrost_abstract_test
+% Unit test for large logical arrays, sent bit-packed.
+
+    methods(Test, TestTags="bitpacking")
+        function logical_matrix_roundtrip(tc)
+            % Beyond the default threshold of 2^16 elements, in both directions.
+            m = rand(1000, 301) > 0.5;
+            tc.verifyEqual(tc.mjl.MATFrostTest.identity_matrix_bool(m), m);
+        end
+
+        function logical_sizes_around_threshold(tc)
+            for n = [2^16-1, 2^16, 2^16+1, 2^16+7]
+                v = mod(1:n, 3)' == 0;
+                tc.verifyEqual(tc.mjl.MATFrostTest.count_true(v), int64(nnz(v)));
+            end
+        end
+
+        function logical_small_unchanged(tc)
+            v = [true; false; true];
+            w = [false; false; true];
+            tc.verifyEqual(tc.mjl.MATFrostTest.matfrost_elementwise_xor(v, w), [true; false; false]);
+        end
+
+        function logical_repeated_calls(tc)
+            % Repeated calls are sent by plan, logical payloads are packed as well.
+            for k = 1:4
+                m = rand(500, 200) > 0.3;
+                tc.verifyEqual(tc.mjl.MATFrostTest.identity_matrix_bool(m), m);
+            end
+        end
+    end
+end
@@ -0,0 +1,36 @@
+classdef matfrost_buffers_test < matfrost_abstract_test
+% Unit test for configured and adaptive socket buffer sizes.
+
+    properties
+        bjl
+    end
+
+    methods(TestClassSetup)
+        function setup_buffers(tc, julia_version)
+            tc.bjl = matfrostjulia(version=julia_version, project=tc.environment, ...
+                socketbuffer=4096, socketkernelbuffer=2^16, adaptivebuffers=true, sharedmemory=0);
+        end
+    end
+
+    methods(Test, TestTags="socket buffers")
+        function small_values(tc)
+            tc.verifyEqual(tc.bjl.MATFrostTest.elementwise_addition_f64(1.0, [1.0; 2.0]), [2.0; 3.0]);
+        end
+
+        function growing_values(tc)
+            % Messages beyond the buffer sizes, the buffers grow between calls.
+            for n = 2.^(10:2:20)
+                x = rand(n, 1);
+                tc.verifyEqual(tc.bjl.MATFrostTest.elementwise_addition_f64(2.0, x), x + 2.0);
+            end
+        end
+
+        function many_elements(tc)
+            populations = struct("name", arrayfun(@(k) "City" + k, 1:5000, UniformOutput=false), ...
+                "population", num2cell(int64(1:5000)));
+            res = tc.bjl.MATFrostTest.identity_population_vector(populations');
+            tc.verifyEqual(res, populations');
+        end
+    end
+
+end
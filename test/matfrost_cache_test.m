@@ -0,0 +1,54 @@
+classdef matfrost_cache_test < matfrost_abstract_test
+% Unit test for the argument cache: large arguments Julia holds already are sent by reference.
+
+    properties
+        cjl
+    end
+
+    methods(TestClassSetup)
+        function setup_cache(tc, julia_version)
+            tc.cjl = matfrostjulia(version=julia_version, project=tc.environment, ...
+                argumentcache=64*2^20, argumentcachethreshold=2^16);
+        end
+    end
+
+    methods(Test, TestTags="argument cache")
+        function repeated_argument(tc)
+            x = (1:2^16)';
+            tc.cjl.reset_stats();
+            for k = 1:3
+                tc.verifyEqual(tc.cjl.MATFrostTest.elementwise_addition_f64(double(k), x), x + k);
+            end
+            s = tc.cjl.stats();
+            tc.verifyEqual(s(1).cache_misses, uint64(1));
+            tc.verifyEqual(s(1).cache_hits, uint64(2));
+            tc.verifyEqual(s(1).cache_bytes_saved, uint64(2*8*2^16));
+        end
+
+        function modified_argument(tc)
+            x = rand(2^16, 1);
+            tc.cjl.MATFrostTest.elementwise_addition_f64(1.0, x);
+            tc.cjl.reset_stats();
+            x(end) = -1.0;
+            tc.verifyEqual(tc.cjl.MATFrostTest.elementwise_addition_f64(1.0, x), x + 1.0);
+            s = tc.cjl.stats();
+            tc.verifyEqual(s(1).cache_misses, uint64(1));
+            tc.verifyEqual(s(1).cache_hits, uint64(0));
+        end
+
+        function same_argument_twice(tc)
+            % Second occurrence in the same call is a reference to the first.
+            x = rand(2^14, 1);
+            v = tc.cjl.MATFrostTest.sum_vector_of_vector_f64({x; x});
+            tc.verifyEqual(v, 2*sum(x), RelTol=1e-12);
+        end
+
+        function small_arguments_not_cached(tc)
+            tc.cjl.reset_stats();
+            tc.cjl.MATFrostTest.elementwise_addition_f64(1.0, [1.0; 2.0]);
+            s = tc.cjl.stats();
+            tc.verifyEqual(s(1).cache_misses + s(1).cache_hits, uint64(0));
+        end
+    end
+
+end
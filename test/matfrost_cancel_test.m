@@ -0,0 +1,58 @@
+classdef matfrost_cancel_test < matfrost_abstract_test
+% Unit test for cancellation: a timed out call is cancelled, the Julia process is kept.
+
+    properties
+        tjl
+        tpool
+    end
+
+    methods(TestClassSetup)
+        function setup_cancel(tc, julia_version)
+            tc.tjl = matfrostjulia(version=julia_version, project=tc.environment, timeout=2000);
+            tc.tpool = matfrostjulia(version=julia_version, project=tc.environment, workers=2, timeout=2000);
+        end
+    end
+
+    methods(Test, TestTags="cancel")
+        function timeout_keeps_process(tc)
+            tc.assumeFalse(ispc, "Julia calls cannot be interrupted on Windows");
+            pid = tc.tjl.MATFrostTest.worker_process_id(0.0);
+            tc.verifyError(@() tc.tjl.MATFrostTest.sleep_seconds(30.0), "matfrostjulia:call:timeout");
+            tc.verifyEqual(tc.tjl.MATFrostTest.worker_process_id(0.0), pid);
+            tc.verifyEqual(tc.tjl.MATFrostTest.double_scalar_f64(2.0), 4.0);
+        end
+
+        function responses_to_other_calls_do_not_time_out(tc)
+            % Fetching the last call reads the responses to all calls before it. The timeout counts elapsed time, not
+            % responses read: far more than timeout/100ms responses are read well within the timeout.
+            n = 200;
+            requests = arrayfun(@(k) tc.tjl.callasync("MATFrostTest.double_scalar_f64", double(k)), 1:n);
+            tc.verifyEqual(tc.tjl.fetch(requests(n)), 2.0 * n);
+            for k = 1:n-1
+                tc.verifyEqual(tc.tjl.fetch(requests(k)), 2.0 * k);
+            end
+        end
+
+        function cancel_keeps_pending_calls(tc)
+            % Only the timed out call is cancelled, the asynchronous call before it completes as usual.
+            tc.assumeFalse(ispc, "Julia calls cannot be interrupted on Windows");
+            pid = tc.tjl.MATFrostTest.worker_process_id(0.0);
+            request = tc.tjl.callasync("MATFrostTest.sleep_seconds", 1.0);
+            tc.verifyError(@() tc.tjl.MATFrostTest.sleep_seconds(30.0), "matfrostjulia:call:timeout");
+            tc.verifyEqual(tc.tjl.fetch(request), 1.0);
+            tc.verifyEqual(tc.tjl.MATFrostTest.worker_process_id(0.0), pid);
+        end
+
+        function map_timeout_resolving_keeps_pool(tc)
+            % sleep_seconds is not resolved yet on any worker: the map resolves it on both workers before sending the
+            % first call. The timed out map leaves no call running, the workers take new calls right away.
+            tc.assumeFalse(ispc, "Julia calls cannot be interrupted on Windows");
+            pids = tc.tpool.map("MATFrostTest.worker_process_id", num2cell(zeros(1, 20)));
+            tc.verifyError(@() tc.tpool.map("MATFrostTest.sleep_seconds", num2cell(30.0*ones(1, 6))), "matfrostjulia:call:timeout");
+            tc.verifyEqual(tc.tpool.map("MATFrostTest.sleep_seconds", num2cell(0.1*ones(1, 4))), num2cell(0.1*ones(1, 4)));
+            pids_after = tc.tpool.map("MATFrostTest.worker_process_id", num2cell(zeros(1, 20)));
+            tc.verifyEqual(unique([pids_after{:}]), unique([pids{:}]));
+        end
+    end
+
+end
@@ -0,0 +1,30 @@
+classdef matfrost_columnar_test < matfrost_abstract_test
+% Unit test for the columnar encoding of struct arrays and homogeneous cell arrays.
+
+    methods(Test, TestTags="columnar")
+        function struct_array_roundtrip(tc)
+            populations = struct("name", arrayfun(@(k) "City" + k, 1:500, UniformOutput=false), ...
+                "population", num2cell(int64(1:500)));
+            res = tc.mjl.MATFrostTest.identity_population_vector(populations');
+            tc.verifyEqual(res, populations');
+        end
+
+        function struct_array_largest(tc)
+            populations = struct("name", {"A", "B", "C"}, "population", {int64(3), int64(30), int64(7)});
+            res = tc.mjl.MATFrostTest.largest_population_vector(populations');
+            tc.verifyEqual(res, struct("name", "B", "population", int64(30)));
+        end
+
+        function homogeneous_cell_roundtrip(tc)
+            vs = arrayfun(@(k) [k; 2*k; 3*k], (1:200)', UniformOutput=false);
+            tc.verifyEqual(tc.mjl.MATFrostTest.sum_vector_of_vector_f64(vs), 6*sum(1:200));
+            tc.verifyEqual(tc.mjl.MATFrostTest.identity_vector_of_vector_f64(vs), vs);
+        end
+
+        function mixed_shape_cell_roundtrip(tc)
+            vs = {[1.0; 2.0]; 3.0; [4.0; 5.0; 6.0]};
+            tc.verifyEqual(tc.mjl.MATFrostTest.identity_vector_of_vector_f64(vs), vs);
+        end
+    end
+
+end
@@ -0,0 +1,43 @@
+classdef matfrost_handles_test < matfrost_abstract_test
+% Unit test for matfrostjulia handles: callhandle, fetch and release.
+
+    methods(Test, TestTags="handles")
+        function chained_calls(tc)
+            h1 = tc.mjl.callhandle("MATFrostTest.elementwise_addition_f64", 1.0, [1.0; 2.0; 3.0]);
+            tc.verifyClass(h1, "matfrostjuliahandle");
+            tc.verifyEqual(h1.type, "Vector{Float64}");
+
+            h2 = tc.mjl.callhandle("MATFrostTest.elementwise_addition_f64", 2.0, h1);
+            tc.verifyEqual(tc.mjl.fetch(h2), [4.0; 5.0; 6.0]);
+            tc.verifyEqual(tc.mjl.fetch(h1), [2.0; 3.0; 4.0]);
+
+            % Regular calls accept handles as well.
+            tc.verifyEqual(tc.mjl.MATFrostTest.elementwise_addition_f64(1.0, h2), [5.0; 6.0; 7.0]);
+
+            tc.mjl.release([h1, h2]);
+        end
+
+        function async_call_with_handle(tc)
+            h = tc.mjl.callhandle("MATFrostTest.elementwise_addition_f64", 0.0, [1.0; 2.0]);
+            request = tc.mjl.callasync("MATFrostTest.elementwise_addition_f64", 1.0, h);
+            tc.verifyEqual(tc.mjl.fetch(request), [2.0; 3.0]);
+            tc.mjl.release(h);
+        end
+    end
+
+    methods(Test, TestTags="ErrorHandling")
+        function released_handle(tc)
+            h = tc.mjl.callhandle("MATFrostTest.elementwise_addition_f64", 1.0, [1.0; 2.0]);
+            tc.mjl.release(h);
+            tc.verifyError(@() tc.mjl.fetch(h), 'matfrostjulia:handle:notFound');
+            tc.verifyError(@() tc.mjl.MATFrostTest.elementwise_addition_f64(1.0, h), 'matfrostjulia:handle:notFound');
+        end
+
+        function incompatible_handle_type(tc)
+            h = tc.mjl.callhandle("MATFrostTest.elementwise_addition_f64", 1.0, [1.0; 2.0]);
+            tc.verifyError(@() tc.mjl.MATFrostTest.repeat_string(h, int64(2)), 'matfrostjulia:handle:incompatibleType');
+            tc.mjl.release(h);
+        end
+    end
+
+end
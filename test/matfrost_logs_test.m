@@ -0,0 +1,23 @@
+classdef matfrost_logs_test < matfrost_abstract_test
+% Unit test for the Julia output: drained while Julia computes, retrieved with logs.
+
+    methods(Test, TestTags="logging")
+        function heavy_output_does_not_block(tc)
+            % Far more output than the pipe holds.
+            tc.verifyEqual(tc.mjl.MATFrostTest.print_lines(int64(200000)), int64(200000));
+        end
+
+        function logs_while_computing(tc)
+            tc.mjl.logs();
+            request = tc.mjl.callasync("MATFrostTest.print_lines", int64(3));
+            pause(1);
+            % Printed while MATLAB was not calling into MATFrost: kept until retrieved.
+            text = tc.mjl.logs();
+            tc.verifyEqual(size(text), [1, 1]);
+            tc.verifySubstring(text, "MATFrostTest line 3");
+            tc.verifyEqual(tc.mjl.fetch(request), int64(3));
+            tc.verifyEqual(tc.mjl.logs(), "");
+        end
+    end
+
+end
@@ -0,0 +1,59 @@
+classdef matfrost_map_test < matfrost_abstract_test
+% Unit test for matfrostjulia map: scatter/gather of calls over a pool of Julia workers.
+
+    properties
+        pool
+    end
+
+    methods(TestClassSetup)
+        function setup_pool(tc, julia_version)
+            tc.pool = matfrostjulia(version=julia_version, project=tc.environment, workers=3);
+        end
+    end
+
+    methods(Test, TestTags="map")
+        function map_single_worker(tc)
+            res = tc.mjl.map("MATFrostTest.elementwise_addition_f64", {{1.0, [1.0; 2.0]}, {2.0, [1.0; 2.0]}});
+            tc.verifyEqual(res, {[2.0; 3.0], [3.0; 4.0]});
+        end
+
+        function map_preserves_order_and_shape(tc)
+            argtuples = arrayfun(@(k) {double(k), [1.0; 2.0]}, reshape(1:60, 3, 20), UniformOutput=false);
+            res = tc.pool.map("MATFrostTest.elementwise_addition_f64", argtuples);
+            tc.verifySize(res, [3, 20]);
+            for k = 1:60
+                tc.verifyEqual(res{k}, k + [1.0; 2.0]);
+            end
+        end
+
+        function map_non_cell_tuple_is_single_argument(tc)
+            res = tc.pool.map("MATFrostTest.double_scalar_f64", {1.0, 2.0, 3.0});
+            tc.verifyEqual(res, {2.0, 4.0, 6.0});
+        end
+
+        function map_signature(tc)
+            res = tc.pool.map("MATFrostTest.multiple_method_definitions", {23.0, 1.0}, signature="Float64");
+            tc.verifyEqual(res, {46.0, 2.0});
+        end
+
+        function map_uses_all_workers(tc)
+            pids = tc.pool.map("MATFrostTest.worker_process_id", num2cell(ones(1, 300)));
+            tc.verifyNumElements(unique([pids{:}]), 3);
+        end
+
+        function map_empty(tc)
+            res = tc.pool.map("MATFrostTest.double_scalar_f64", {});
+            tc.verifyEmpty(res);
+        end
+
+        function regular_call_on_pool(tc)
+            tc.verifyEqual(tc.pool.MATFrostTest.double_scalar_f64(3.0), 6.0);
+        end
+    end
+
+    methods(Test, TestTags="ErrorHandling")
+        function map_error_raised(tc)
+            tc.verifyError(@() tc.mjl.map("MATFrostTest.double_scalar_f64", {1.0, "a"}), 'matfrostjulia:conversion:incompatibleDatatypes');
+        end
+    end
+end
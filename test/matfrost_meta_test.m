@@ -7,6 +7,8 @@ classdef matfrost_meta_test < matfrost_abstract_test
         end
 
         function missing_function_test(tc)          
+            tc.verifyError(@() tc.mjl.MATFrostTest.function_does_not_exist(), 'matfrostjulia:call:functionNotFound');
+            % Functions failing to resolve are not cached.
             tc.verifyError(@() tc.mjl.MATFrostTest.function_does_not_exist(), 'matfrostjulia:call:functionNotFound');
             tc.verifyError(@() tc.mjl.MATFrostTest.ModuleDoesNotExist.function_does_not_exist(), 'matfrostjulia:call:functionNotFound');
         end
@@ -68,6 +70,14 @@ classdef matfrost_meta_test < matfrost_abstract_test
             tc.verifyEqual(res, "foo_7");
         end
 
+        function resolved_function_per_signature(tc)
+            % Functions are resolved once per name and signature, repeated calls go by function ID.
+            for k = 1:3
+                tc.verifyEqual(tc.mjl.MATFrostTest.multiple_method_definitions(23.0, signature="Float64"), 46.0);
+                tc.verifyEqual(tc.mjl.MATFrostTest.multiple_method_definitions(int64(3), signature="Int64"), int64(5));
+            end
+        end
+
         function point_addition_test(tc)
             % Create two Julia Point objects
             p1 = tc.mjl.MATFrostTest.Point(int64(1), int64(2),signature=["Int64","Int64"]);
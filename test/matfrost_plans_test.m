@@ -0,0 +1,33 @@
+classdef matfrost_plans_test < matfrost_abstract_test
+% Unit test for serialization plans: repeated calls with arguments of the same layout are sent by plan.
+
+    methods(Test, TestTags="plans")
+        function repeated_layout(tc)
+            tc.mjl.MATFrostTest.elementwise_addition_f64(0.0, [0.0; 0.0; 0.0]);
+            tc.mjl.reset_stats();
+            for k = 1:5
+                x = rand(3, 1);
+                tc.verifyEqual(tc.mjl.MATFrostTest.elementwise_addition_f64(double(k), x), x + k);
+            end
+            s = tc.mjl.stats();
+            tc.verifyGreaterThanOrEqual(s(1).plan_hits, uint64(4));
+        end
+
+        function nested_layout(tc)
+            for k = 1:5
+                vs = {rand(2, 1); rand(4, 1); k*ones(3, 1)};
+                tc.verifyEqual(tc.mjl.MATFrostTest.sum_vector_of_vector_f64(vs), sum(vs{1}) + sum(vs{2}) + 3*k, RelTol=1e-12);
+            end
+        end
+
+        function changed_dimensions(tc)
+            for n = 1:6
+                x = rand(n, 1);
+                tc.verifyEqual(tc.mjl.MATFrostTest.elementwise_addition_f64(1.0, x), x + 1.0);
+                tc.verifyEqual(tc.mjl.MATFrostTest.elementwise_addition_f64(2.0, x), x + 2.0);
+                tc.verifyEqual(tc.mjl.MATFrostTest.elementwise_addition_f64(3.0, x), x + 3.0);
+            end
+        end
+    end
+
+end
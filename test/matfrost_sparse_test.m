@@ -0,0 +1,56 @@
+classdef matfrost_sparse_test < matfrost_abstract_test
+% Unit test for sparse matrices, sent in compressed-column form.
+
+    methods(Test, TestTags="sparse")
+        function sparse_double_roundtrip(tc)
+            A = sprandn(2000, 1000, 0.01);
+            res = tc.mjl.MATFrostTest.identity_sparse_f64(A);
+            tc.verifyTrue(issparse(res));
+            tc.verifyEqual(res, A);
+        end
+
+        function sparse_logical_roundtrip(tc)
+            A = sprand(300, 200, 0.05) > 0.5;
+            res = tc.mjl.MATFrostTest.identity_sparse_bool(A);
+            tc.verifyTrue(issparse(res) && islogical(res));
+            tc.verifyEqual(res, A);
+        end
+
+        function sparse_complex_roundtrip(tc)
+            A = sprandn(100, 50, 0.1) + 1i*sprandn(100, 50, 0.1);
+            res = tc.mjl.MATFrostTest.identity_sparse_complex_f64(A);
+            tc.verifyTrue(issparse(res));
+            tc.verifyEqual(res, A);
+        end
+
+        function sparse_empty_and_zero(tc)
+            tc.verifyEqual(tc.mjl.MATFrostTest.identity_sparse_f64(sparse(0, 5)), sparse(0, 5));
+            tc.verifyEqual(tc.mjl.MATFrostTest.identity_sparse_f64(sparse(4, 3)), sparse(4, 3));
+        end
+
+        function sparse_large_matrix_vector(tc)
+            % Dense, this matrix would take 80 GB.
+            n = 100000;
+            A = spdiags([-ones(n,1), 2*ones(n,1), -ones(n,1)], -1:1, n, n);
+            x = (1:n)';
+            tc.verifyEqual(tc.mjl.MATFrostTest.sparse_matrix_vector_f64(A, x), A*x, AbsTol=1e-9);
+            tc.verifyEqual(tc.mjl.MATFrostTest.sparse_nnz(A), int64(nnz(A)));
+        end
+
+        function sparse_from_julia(tc)
+            n = 1000;
+            res = tc.mjl.MATFrostTest.sparse_laplacian_1d(int64(n));
+            tc.verifyTrue(issparse(res));
+            tc.verifyEqual(res, spdiags([-ones(n,1), 2*ones(n,1), -ones(n,1)], -1:1, n, n));
+        end
+
+        function sparse_repeated_calls(tc)
+            % Same dimensions, different nonzeros: a sparse matrix is never sent by serialization plan.
+            for k = 1:4
+                A = sprandn(50, 50, 0.02*k);
+                tc.verifyEqual(tc.mjl.MATFrostTest.identity_sparse_f64(A), A);
+            end
+        end
+    end
+
+end
@@ -0,0 +1,27 @@
+classdef matfrost_standby_test < matfrost_abstract_test
+% Unit test for standby Julia processes: sessions claim processes started ahead of time.
+
+    properties
+        sjl1
+        sjl2
+    end
+
+    methods(TestClassSetup)
+        function setup_standby(tc, julia_version)
+            tc.sjl1 = matfrostjulia(version=julia_version, project=tc.environment, standby=1);
+            % Claims the process started along with the first session.
+            tc.sjl2 = matfrostjulia(version=julia_version, project=tc.environment, standby=1);
+        end
+    end
+
+    methods(Test, TestTags="standby")
+        function claimed_processes(tc)
+            pid1 = tc.sjl1.MATFrostTest.worker_process_id(0.0);
+            pid2 = tc.sjl2.MATFrostTest.worker_process_id(0.0);
+            tc.verifyNotEqual(pid1, pid2);
+            tc.verifyEqual(tc.sjl1.MATFrostTest.double_scalar_f64(2.0), 4.0);
+            tc.verifyEqual(tc.sjl2.MATFrostTest.double_scalar_f64(3.0), 6.0);
+        end
+    end
+
+end
@@ -0,0 +1,48 @@
+classdef matfrost_stats_test < matfrost_abstract_test
+% Unit test for matfrostjulia call statistics: stats and reset_stats.
+
+    methods(Test, TestTags="statistics")
+        function counters_after_calls(tc)
+            tc.mjl.reset_stats();
+            for k = 1:3
+                tc.mjl.MATFrostTest.elementwise_addition_f64(double(k), [1.0, 2.0]);
+            end
+            s = tc.mjl.stats();
+
+            % The first call of a function also resolves it: one extra request.
+            tc.verifyGreaterThanOrEqual(s(1).requests, uint64(3));
+            tc.verifyEqual(s(1).responses, s(1).requests);
+            tc.verifyGreaterThan(s(1).bytes_sent, uint64(0));
+            tc.verifyGreaterThan(s(1).bytes_received, uint64(0));
+            for phase = ["serialize", "send", "wait", "receive", "deserialize"]
+                tc.verifyGreaterThanOrEqual(s(1).(phase).count, uint64(3), phase);
+                tc.verifyGreaterThanOrEqual(s(1).(phase).max_us, s(1).(phase).p50_us, phase);
+            end
+        end
+
+        function counters_after_async_calls(tc)
+            tc.mjl.reset_stats();
+            requests = arrayfun(@(k) tc.mjl.callasync("MATFrostTest.elementwise_addition_f64", double(k), [1.0, 2.0]), 1:4);
+            for k = 1:4
+                tc.mjl.fetch(requests(k));
+            end
+            s = tc.mjl.stats();
+
+            tc.verifyGreaterThanOrEqual(s(1).requests, uint64(4));
+            tc.verifyEqual(s(1).responses, s(1).requests);
+            tc.verifyEqual(s(1).deserialize.count, s(1).responses);
+        end
+
+        function reset(tc)
+            tc.mjl.MATFrostTest.elementwise_addition_f64(1.0, [1.0, 2.0]);
+            tc.mjl.reset_stats();
+            s = tc.mjl.stats();
+
+            tc.verifyEqual(s(1).requests, uint64(0));
+            tc.verifyEqual(s(1).bytes_sent, uint64(0));
+            tc.verifyEqual(s(1).wait.count, uint64(0));
+            tc.verifyEqual(s(1).wait.p99_us, 0.0);
+        end
+    end
+
+end
@@ -0,0 +1,56 @@
+classdef matfrost_streaming_test < matfrost_abstract_test
+% Unit test for streaming calls: callstream, hasdata, read and close.
+
+    methods(Test, TestTags="streaming")
+        function chunks_in_order(tc)
+            s = tc.mjl.callstream("MATFrostTest.stream_chunks", int64(10), int64(4));
+            tc.verifyClass(s, "matfrostjuliastream");
+
+            tc.verifyTrue(hasdata(s));
+            tc.verifyEqual(read(s), [1.0; 2.0; 3.0; 4.0]);
+            tc.verifyEqual(read(s), [5.0; 6.0; 7.0; 8.0]);
+            tc.verifyEqual(read(s), [9.0; 10.0]);
+            tc.verifyFalse(hasdata(s));
+            tc.verifyError(@() read(s), 'matfrostjulia:stream:noData');
+        end
+
+        function empty_stream(tc)
+            s = tc.mjl.callstream("MATFrostTest.stream_chunks", int64(0), int64(4));
+            tc.verifyFalse(hasdata(s));
+            tc.verifyEqual(readall(s), {});
+        end
+
+        function channel(tc)
+            s = tc.mjl.callstream("MATFrostTest.stream_channel", int64(3));
+            tc.verifyEqual(readall(s), {int64(1); int64([2; 2]); int64([3; 3; 3])});
+        end
+
+        function calls_between_chunks(tc)
+            % The chunk computed ahead is kept while other calls are made.
+            s = tc.mjl.callstream("MATFrostTest.stream_chunks", int64(6), int64(3));
+            tc.verifyEqual(read(s), [1.0; 2.0; 3.0]);
+            tc.verifyEqual(tc.mjl.MATFrostTest.repeat_string("a", int64(3)), "aaa");
+            tc.verifyEqual(read(s), [4.0; 5.0; 6.0]);
+            tc.verifyFalse(hasdata(s));
+        end
+
+        function close_early(tc)
+            s = tc.mjl.callstream("MATFrostTest.stream_channel", int64(1000));
+            tc.verifyEqual(read(s), int64(1));
+            close(s);
+            tc.verifyFalse(hasdata(s));
+            tc.verifyEqual(tc.mjl.MATFrostTest.repeat_string("b", int64(2)), "bb");
+        end
+    end
+
+    methods(Test, TestTags="ErrorHandling")
+        function failing_stream(tc)
+            s = tc.mjl.callstream("MATFrostTest.stream_failing", int64(3));
+            tc.verifyEqual(read(s), 1.0);
+            tc.verifyEqual(read(s), 2.0);
+            tc.verifyError(@() read(s), 'matfrostjulia:call:call');
+            tc.verifyFalse(hasdata(s));
+        end
+    end
+
+end
@@ -0,0 +1,22 @@
+classdef matfrost_strings_test < matfrost_abstract_test
+% Unit test for string arrays, sent packed as UTF-8.
+
+    methods(Test, TestTags="strings")
+        function string_array_roundtrip(tc)
+            s = "item_" + string(1:10000)';
+            tc.verifyEqual(tc.mjl.MATFrostTest.identity_vector_string(s), s);
+        end
+
+        function string_array_mixed_scripts(tc)
+            s = ["Straße"; "東京"; "teststring_😀_"; ""; "ascii_only_and_long_enough_for_a_vector_block"; "ÅÄÖ"];
+            tc.verifyEqual(tc.mjl.MATFrostTest.identity_vector_string(s), s);
+            tc.verifyEqual(tc.mjl.MATFrostTest.string_ncodeunits(s), int64([7; 6; 16; 0; 45; 6]));
+        end
+
+        function string_array_unpaired_surrogate(tc)
+            % An unpaired surrogate is not valid UTF-16, it arrives in Julia as U+FFFD.
+            s = ["a" + char(55357) + "b"; "c"];
+            tc.verifyEqual(tc.mjl.MATFrostTest.identity_vector_string(s), ["a" + char(65533) + "b"; "c"]);
+        end
+    end
+end
@@ -0,0 +1,66 @@
+classdef matfrost_upload_test < matfrost_abstract_test
+% Unit test for uploads: openstream, push, close and calls consuming an upload.
+
+    methods(Test, TestTags="upload")
+        function consume_while_uploading(tc)
+            u = tc.mjl.openstream();
+            tc.verifyClass(u, "matfrostjuliaupload");
+
+            request = tc.mjl.callasync("MATFrostTest.upload_total", u);
+            for k = 1:10
+                push(u, k * ones(1000, 1));
+            end
+            close(u);
+            tc.verifyEqual(tc.mjl.fetch(request), [55000.0; 10.0]);
+        end
+
+        function consume_after_upload(tc)
+            % Chunks pushed before the call are kept by Julia.
+            u = tc.mjl.openstream();
+            push(u, "ab");
+            push(u, "cd");
+            close(u);
+            tc.verifyEqual(tc.mjl.MATFrostTest.upload_concat("x", u), "xabcd");
+        end
+
+        function empty_upload(tc)
+            u = tc.mjl.openstream();
+            close(u);
+            tc.verifyEqual(tc.mjl.MATFrostTest.upload_total(u), [0.0; 0.0]);
+        end
+
+        function calls_during_upload(tc)
+            % Calls submitted while the upload is consumed are answered after the consuming call.
+            u = tc.mjl.openstream();
+            request = tc.mjl.callasync("MATFrostTest.upload_total", u);
+            push(u, [1.0; 2.0]);
+            other = tc.mjl.callasync("MATFrostTest.repeat_string", "a", int64(2));
+            push(u, [3.0; 4.0]);
+            close(u);
+            tc.verifyEqual(tc.mjl.fetch(request), [10.0; 2.0]);
+            tc.verifyEqual(tc.mjl.fetch(other), "aa");
+        end
+    end
+
+    methods(Test, TestTags="ErrorHandling")
+        function push_after_close(tc)
+            u = tc.mjl.openstream();
+            close(u);
+            tc.verifyError(@() push(u, 1.0), 'matfrostjulia:upload:closed');
+        end
+
+        function consumed_upload(tc)
+            u = tc.mjl.openstream();
+            close(u);
+            tc.mjl.MATFrostTest.upload_total(u);
+            tc.verifyError(@() tc.mjl.MATFrostTest.upload_total(u), 'matfrostjulia:upload:notFound');
+        end
+
+        function incompatible_argument(tc)
+            u = tc.mjl.openstream();
+            close(u);
+            tc.verifyError(@() tc.mjl.MATFrostTest.elementwise_addition_f64(1.0, u), 'matfrostjulia:upload:incompatibleType');
+        end
+    end
+
+end
@@ -0,0 +1,90 @@
+module PlansTest
+
+using Test
+
+using MATFrost._Stream: BufferedUDS, Buffer, write!
+using MATFrost._Read: read_message!
+using MATFrost._Write: write_matfrostarray!
+using MATFrost._Types
+using MATFrost._Constants
+
+function call(x::Vector{Float64}, n::Int32)
+    meta = MATFrostArrayStruct([1], [:name, :x], MATFrostArrayAbstract[
+        MATFrostArrayString([1], ["fn"]),
+        MATFrostArrayPrimitive{Float64}([length(x), 1], x)])
+    MATFrostArrayCell([1, 3], MATFrostArrayAbstract[meta, MATFrostArrayPrimitive{Int32}([1], [n]), MATFrostArrayEmpty()])
+end
+
+function write_prefix!(stream::BufferedUDS, nbytes)
+    write!(stream, UInt64(1))
+    write!(stream, Int64(nbytes))
+    write!(stream, Int64(0))
+    write!(stream, Int64(0))
+end
+
+"""
+Message defining plan id, as the MEX writes it: [CELL|PLAN][ndims][dims][id] followed by the array in full.
+"""
+function write_plan_definition!(stream::BufferedUDS, id, marr)
+    write_prefix!(stream, 0)
+    write!(stream, CELL | ENCODING_PLAN)
+    write!(stream, Int64[2, 1, 3])
+    write!(stream, Int64(id))
+    empty!(stream.schemas.written)
+    write_matfrostarray!(stream, marr)
+end
+
+"""
+Message by reference to plan id: [CELL|PLAN_REFERENCE][ndims][dims][id][threshold][payloads].
+"""
+function write_plan_reference!(stream::BufferedUDS, id, x::Vector{Float64}, n::Int32)
+    write_prefix!(stream, 0)
+    write!(stream, CELL | ENCODING_PLAN_REFERENCE)
+    write!(stream, Int64[2, 1, 3])
+    write!(stream, Int64(id))
+    write!(stream, typemax(UInt64))
+    write!(stream, x)
+    write!(stream, n)
+end
+
+@testset "Plans-DefineAndReference" begin
+    buffer = Buffer(Vector{UInt8}(undef, 2 << 16), 0, 0)
+    stream = BufferedUDS(C_NULL, buffer, buffer)
+
+    write_plan_definition!(stream, 0, call([1.0, 2.0, 3.0], Int32(1)))
+    (_, result) = read_message!(stream)
+    @test buffer.available == buffer.position
+    @test result.values[1].values[2].values == [1.0, 2.0, 3.0]
+    @test length(stream.plans.templates) == 1
+
+    # Modifying the values handed out leaves the template intact.
+    result.values[1].values[1].values[1] = "modified"
+
+    for k in 2:4
+        x = [k, 2k, 3k] .* 1.0
+        write_plan_reference!(stream, 0, x, Int32(k))
+        (_, result) = read_message!(stream)
+        @test buffer.available == buffer.position
+        @test result.values[1].fieldnames == [:name, :x]
+        @test result.values[1].values[1].values == ["fn"]
+        @test result.values[1].values[2].dims == [3, 1]
+        @test result.values[1].values[2].values == x
+        @test result.values[2].values == Int32[k]
+        @test result.values[3] isa MATFrostArrayEmpty
+    end
+end
+
+@testset "Plans-OutOfSync" begin
+    buffer = Buffer(Vector{UInt8}(undef, 2 << 16), 0, 0)
+    stream = BufferedUDS(C_NULL, buffer, buffer)
+
+    write_plan_reference!(stream, 0, [1.0, 2.0, 3.0], Int32(1))
+    @test_throws ErrorException read_message!(stream)
+
+    buffer.position = 0
+    buffer.available = 0
+    write_plan_definition!(stream, 1, call([1.0], Int32(1)))
+    @test_throws ErrorException read_message!(stream)
+end
+
+end
@@ -5,6 +5,14 @@ include("readwrite.jl")
 include("read.jl")
 include("composites.jl")
 include("server.jl")
+include("sharedmemory.jl")
+include("schemas.jl")
+include("columnar.jl")
+include("cache.jl")
+include("plans.jl")
+include("sparse.jl")
+include("strings.jl")
+include("bitpacking.jl")
 include("converttomatlab.jl")
 
 # include("primitives.jl")
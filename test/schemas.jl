@@ -0,0 +1,55 @@
+module SchemasTest
+
+using Test
+
+using MATFrost._Stream: BufferedUDS, Buffer
+using MATFrost._Read: read_message!
+using MATFrost._Write: write_message!
+using MATFrost._Types
+
+function city(name, population)
+    MATFrostArrayStruct([1], [:name, :population], MATFrostArrayAbstract[
+        MATFrostArrayString([1], [name]),
+        MATFrostArrayPrimitive{Int64}([1], [population])])
+end
+
+function count_occurrences(data::Vector{UInt8}, pattern::String)
+    p = Vector{UInt8}(pattern)
+    count(i -> data[i:i+length(p)-1] == p, 1:length(data)-length(p)+1)
+end
+
+@testset "Schemas-Roundtrip" begin
+    buffer = Buffer(Vector{UInt8}(undef, 2 << 16), 0, 0)
+    stream = BufferedUDS(C_NULL, buffer, buffer)
+
+    cities = MATFrostArrayAbstract[city("City$(i)", Int64(i)) for i in 1:100]
+    nested = MATFrostArrayStruct([1], [:population, :name], MATFrostArrayAbstract[
+        MATFrostArrayPrimitive{Int64}([1], [7]), MATFrostArrayString([1], ["Nested"])])
+    marr = MATFrostArrayCell([102], MATFrostArrayAbstract[cities..., nested, city("Last", Int64(0))])
+
+    write_message!(stream, UInt64(1), marr)
+
+    # Field names are sent once per distinct list of field names.
+    @test count_occurrences(buffer.data[1:buffer.available], "population") == 2
+    @test reinterpret(Int64, buffer.data[9:16])[1] == buffer.available - 32
+
+    (_, result) = read_message!(stream)
+    @test buffer.available == buffer.position
+    @test length(result.values) == 102
+    for i in 1:100
+        @test result.values[i].fieldnames == [:name, :population]
+        @test result.values[i].values[1].values == ["City$(i)"]
+        @test result.values[i].values[2].values == [i]
+    end
+    @test result.values[101].fieldnames == [:population, :name]
+    @test result.values[102].fieldnames == [:name, :population]
+    @test result.values[102].values[1].values == ["Last"]
+
+    # Schemas do not carry over to the next message.
+    write_message!(stream, UInt64(2), city("Again", Int64(1)))
+    @test count_occurrences(buffer.data[buffer.position+1:buffer.available], "population") == 1
+    (_, result) = read_message!(stream)
+    @test result.fieldnames == [:name, :population]
+end
+
+end
@@ -47,4 +47,149 @@ end
         @test e.message == "Function not found exception:\nFunction MATFrost.nonExistentFunction \n"
         @test e.id == "matfrostjulia:call:functionNotFound"
     end
-end
\ No newline at end of file
+end
+@testset "MATFrost._Server.resolved_function" begin
+    callMeta = MATFrost._Server.CallMeta("MATFrost._Server.getMethod")
+    (f, Args) = MATFrost._Server.load_function(callMeta)
+    push!(MATFrost._Server.resolved_functions, (f, Args))
+    function_id = length(MATFrost._Server.resolved_functions)
+
+    @test MATFrost._Server.resolved_function(function_id) == (f, Tuple{MATFrost._Server.CallMeta})
+
+    @test_throws MATFrost._Types.MATFrostException MATFrost._Server.resolved_function(function_id + 1)
+    try
+        MATFrost._Server.resolved_function(0)
+    catch e
+        @test e.id == "matfrostjulia:call:functionNotResolved"
+    end
+
+    pop!(MATFrost._Server.resolved_functions)
+end
+@testset "MATFrost._Server.handles" begin
+    S = MATFrost._Server
+    T = MATFrost._Types
+
+    ref = S.store_handle!([1.0, 2.0, 3.0])
+    @test ref.type == "Vector{Float64}"
+    handle = ref.matfrost_handle
+    reference = T.MATFrostArrayStruct([1], [:matfrost_handle], T.MATFrostArrayAbstract[T.MATFrostArrayPrimitive{UInt64}([1], [handle])])
+
+    # Handle and regular argument mixed.
+    callargs = T.MATFrostArrayCell([2, 1], T.MATFrostArrayAbstract[reference, T.MATFrostArrayPrimitive{Float64}([1], [2.0])])
+    args = S.convert_arguments(Tuple{Vector{Float64}, Float64}, callargs)
+    @test args[1] === S.handles[handle]
+    @test args[2] == 2.0
+
+    err = try S.convert_arguments(Tuple{Vector{Int64}, Float64}, callargs) catch e e end
+    @test err isa T.MATFrostException
+    @test err.id == "matfrostjulia:handle:incompatibleType"
+
+    fetchcall = T.MATFrostArrayCell([2, 1], T.MATFrostArrayAbstract[T.MATFrostArrayString([1], ["FETCH"]), T.MATFrostArrayPrimitive{UInt64}([1], [handle])])
+    result = S.handle_command(fetchcall)
+    @test result.values[3].values == [1.0, 2.0, 3.0]
+
+    releasecall = T.MATFrostArrayCell([2, 1], T.MATFrostArrayAbstract[T.MATFrostArrayString([1], ["RELEASE"]), T.MATFrostArrayPrimitive{UInt64}([2], [handle, handle + 1000])])
+    result = S.handle_command(releasecall)
+    @test result.values[3].values == [1]
+    @test !haskey(S.handles, handle)
+
+    err = try S.convert_arguments(Tuple{Vector{Float64}, Float64}, callargs) catch e e end
+    @test err.id == "matfrostjulia:handle:notFound"
+end
+@testset "MATFrost._Server.cancel" begin
+    S = MATFrost._Server
+    T = MATFrost._Types
+
+    releasecall = T.MATFrostArrayCell([2, 1], T.MATFrostArrayAbstract[T.MATFrostArrayString([1], ["RELEASE"]), T.MATFrostArrayPrimitive{UInt64}([1], UInt64[0])])
+    marker = T.MATFrostArrayCell([2, 1], T.MATFrostArrayAbstract[T.MATFrostArrayString([1], ["CANCEL"]), T.MATFrostArrayPrimitive{UInt64}([1], UInt64[0])])
+
+    @test S.respond(releasecall).values[1].values == ["SUCCESFUL"]
+
+    # After an interrupted call, other calls up to the marker run as usual.
+    S.cancelling[] = true
+    result = S.respond(releasecall)
+    @test result.values[1].values == ["SUCCESFUL"]
+    @test S.respond(marker).values[1].values == ["SUCCESFUL"]
+    @test !S.cancelling[]
+    @test S.respond(releasecall).values[1].values == ["SUCCESFUL"]
+
+    # A marker without a preceding interrupt is a no-op.
+    @test S.respond(marker).values[1].values == ["SUCCESFUL"]
+end
+@testset "MATFrost._Server.streams" begin
+    S = MATFrost._Server
+    T = MATFrost._Types
+
+    nextcall(id) = T.MATFrostArrayCell([2, 1], T.MATFrostArrayAbstract[T.MATFrostArrayString([1], ["NEXT"]), T.MATFrostArrayPrimitive{UInt64}([1], [id])])
+    donecall(ids) = T.MATFrostArrayCell([2, 1], T.MATFrostArrayAbstract[T.MATFrostArrayString([1], ["DONE"]), T.MATFrostArrayPrimitive{UInt64}([length(ids)], ids)])
+    # NEXT enables interrupts, as the server loop does this outside of disable_sigint.
+    next!(id) = disable_sigint(() -> S.handle_command(nextcall(id)))
+
+    ref = S.store_stream!(([Float64(k)] for k in 1:2))
+    id = ref.matfrost_stream
+
+    # Chunks are sent as (done, chunk) one at a time, the stream is removed when exhausted.
+    for k in 1:2
+        result = next!(id)
+        @test result.values[3].values[1].values == [false]
+        @test result.values[3].values[2].values == [Float64(k)]
+    end
+    result = next!(id)
+    @test result.values[3].values[1].values == [true]
+    @test !haskey(S.streams, id)
+
+    err = try next!(id) catch e e end
+    @test err isa T.MATFrostException
+    @test err.id == "matfrostjulia:stream:notFound"
+
+    # A failing iteration ends the stream.
+    id = S.store_stream!((k < 2 ? k : error("failed") for k in 1:3)).matfrost_stream
+    @test next!(id).values[3].values[2].values == [1]
+    @test_throws ErrorException next!(id)
+    @test !haskey(S.streams, id)
+
+    # DONE closes a Channel, which stops its producer.
+    ch = Channel{Int64}(1) do c
+        for k in 1:1000
+            put!(c, k)
+        end
+    end
+    id = S.store_stream!(ch).matfrost_stream
+    @test next!(id).values[3].values[2].values == [1]
+    result = S.handle_command(donecall([id, id + 1000]))
+    @test result.values[3].values == [1]
+    @test !isopen(ch)
+    @test !haskey(S.streams, id)
+end
+@testset "MATFrost._Server.uploads" begin
+    S = MATFrost._Server
+    T = MATFrost._Types
+
+    command(name, args...) = T.MATFrostArrayCell([1 + length(args), 1], T.MATFrostArrayAbstract[T.MATFrostArrayString([1], [name]), args...])
+    id = S.handle_command(command("OPEN_STREAM")).values[3].values[1].values[1]
+    @test haskey(S.uploads, id)
+
+    for k in 1:3
+        chunk = T.MATFrostArrayPrimitive{Float64}([2], [Float64(k), Float64(k)])
+        @test S.handle_command(command("PUSH", T.MATFrostArrayPrimitive{UInt64}([1], [id]), chunk)).values[1].values == ["SUCCESFUL"]
+    end
+    @test S.handle_command(command("CLOSE_STREAM", T.MATFrostArrayPrimitive{UInt64}([1], [id]))).values[1].values == ["SUCCESFUL"]
+
+    err = try S.push_chunk!(id, T.MATFrostArrayPrimitive{Float64}([1], [0.0])) catch e e end
+    @test err.id == "matfrostjulia:upload:closed"
+
+    # Uploads are passed as UploadStream, chunks are converted to its element type when taken.
+    reference = T.MATFrostArrayStruct([1], [:matfrost_upload], T.MATFrostArrayAbstract[T.MATFrostArrayPrimitive{UInt64}([1], [id])])
+    callargs = T.MATFrostArrayCell([1, 1], T.MATFrostArrayAbstract[reference])
+
+    err = try S.convert_arguments(Tuple{Vector{Float64}}, callargs) catch e e end
+    @test err.id == "matfrostjulia:upload:incompatibleType"
+
+    (chunks,) = S.convert_arguments(Tuple{MATFrost.UploadStream{Vector{Float64}}}, callargs)
+    @test collect(chunks) == [[1.0, 1.0], [2.0, 2.0], [3.0, 3.0]]
+
+    # A consumed upload is removed.
+    @test !haskey(S.uploads, id)
+    err = try S.convert_arguments(Tuple{MATFrost.UploadStream{Vector{Float64}}}, callargs) catch e e end
+    @test err.id == "matfrostjulia:upload:notFound"
+end
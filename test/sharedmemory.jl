@@ -0,0 +1,101 @@
+module SharedMemoryTest
+
+using Test
+
+using MATFrost._Stream: BufferedUDS, Buffer
+using MATFrost._SharedMemory: SharedMemoryRegion, Block, HEADER_SIZE, begin_write!, end_read!, begin_read!
+using MATFrost._Read: read_message!
+using MATFrost._Write: write_message!
+using MATFrost._Types
+
+"""
+Loopback region: a single ring backed by a Julia vector, written and read by the same side.
+"""
+function loopback_region(capacity, threshold)
+    mem = zeros(UInt8, HEADER_SIZE + 2*capacity)
+    shm = SharedMemoryRegion(C_NULL, pointer(mem), capacity, threshold, 0, 0, Block(), Block())
+    (mem, shm)
+end
+
+@testset "SharedMemory-Roundtrip" begin
+    (mem, shm) = loopback_region(1 << 16, 1024)
+    GC.@preserve mem begin
+        buffer = Buffer(Vector{UInt8}(undef, 2 << 16), 0, 0)
+        stream = BufferedUDS(C_NULL, buffer, buffer, shm)
+
+        large = MATFrostArrayPrimitive{Float64}([256, 4], rand(1024))
+        small = MATFrostArrayPrimitive{Int32}([3], Int32[1, 2, 3])
+        marr = MATFrostArrayCell([2], MATFrostArrayAbstract[large, small])
+
+        write_message!(stream, UInt64(7), marr)
+
+        # Payload of the large array is not in the socket stream.
+        @test buffer.available < 200
+
+        (request_id, result) = read_message!(stream)
+        @test request_id == 7
+        @test result.values[1].values == large.values
+        @test result.values[1].dims == large.dims
+        @test result.values[2].values == small.values
+        @test buffer.available == buffer.position
+    end
+end
+
+@testset "SharedMemory-RingFull" begin
+    (mem, shm) = loopback_region(4096, 1024)
+    GC.@preserve mem begin
+        blk = begin_write!(shm, 3000)
+        @test blk.active
+        @test blk.offset == 0
+
+        # Not released yet, insufficient space.
+        @test !begin_write!(shm, 3000).active
+
+        begin_read!(shm, 0, 3000)
+        end_read!(shm)
+
+        # Wraps around to the start of the ring.
+        blk = begin_write!(shm, 3000)
+        @test blk.active
+        @test blk.offset == 0
+        @test blk.advance == 4096
+    end
+end
+
+@testset "SharedMemory-Fallback" begin
+    (mem, shm) = loopback_region(1024, 512)
+    GC.@preserve mem begin
+        buffer = Buffer(Vector{UInt8}(undef, 2 << 16), 0, 0)
+        stream = BufferedUDS(C_NULL, buffer, buffer, shm)
+
+        large = MATFrostArrayPrimitive{Float64}([512], rand(512))
+        write_message!(stream, UInt64(1), large)
+        @test buffer.available > sizeof(large.values)
+
+        (_, result) = read_message!(stream)
+        @test result.values == large.values
+    end
+end
+
+@testset "SharedMemory-MessageLength" begin
+    (mem, shm) = loopback_region(1 << 16, 1024)
+    GC.@preserve mem begin
+        buffer = Buffer(Vector{UInt8}(undef, 2 << 16), 0, 0)
+        stream = BufferedUDS(C_NULL, buffer, buffer, shm)
+
+        marr = MATFrostArrayStruct([1], [:a, :bc], MATFrostArrayAbstract[
+            MATFrostArrayPrimitive{Float64}([256, 4], rand(1024)),
+            MATFrostArrayString([2], ["x", "äb"])])
+
+        write_message!(stream, UInt64(3), marr)
+
+        # [request_id][nbytes][offset][advance] followed by exactly nbytes of array.
+        nbytes = reinterpret(Int64, buffer.data[9:16])[1]
+        @test nbytes == buffer.available - 32
+
+        (request_id, _) = read_message!(stream)
+        @test request_id == 3
+    end
+end
+
+end
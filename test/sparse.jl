@@ -0,0 +1,83 @@
+module SparseTest
+
+using Test
+using SparseArrays
+
+using MATFrost._Stream: BufferedUDS, Buffer
+using MATFrost._Read: read_message!
+using MATFrost._Write: write_message!
+using MATFrost._Types
+using MATFrost._Constants
+using MATFrost._ConvertToJulia: _ConvertToJulia
+using MATFrost._ConvertToMATLAB: _ConvertToMATLAB
+
+function roundtrip(marr)
+    buffer = Buffer(Vector{UInt8}(undef, 2 << 16), 0, 0)
+    stream = BufferedUDS(C_NULL, buffer, buffer)
+
+    write_message!(stream, UInt64(1), marr)
+    tag = reinterpret(Int32, buffer.data[33:36])[1]
+    @test reinterpret(Int64, buffer.data[9:16])[1] == buffer.available - 32
+
+    (_, result) = read_message!(stream)
+    @test buffer.available == buffer.position
+    (tag, result)
+end
+
+@testset "Sparse-Roundtrip" begin
+    A = sprandn(200, 100, 0.05)
+    marr = _ConvertToMATLAB.convert_matfrostarray(A)
+    @test marr isa MATFrostArraySparse{Float64}
+
+    (tag, result) = roundtrip(marr)
+    @test tag == SPARSE_DOUBLE
+    @test result isa MATFrostArraySparse{Float64}
+    @test _ConvertToJulia.convert_matfrostarray(SparseMatrixCSC{Float64, Int64}, result) == A
+end
+
+@testset "Sparse-ElementTypes" begin
+    B = sprand(30, 40, 0.1) .> 0.5
+    (tag, result) = roundtrip(_ConvertToMATLAB.convert_matfrostarray(B))
+    @test tag == SPARSE_LOGICAL
+    @test _ConvertToJulia.convert_matfrostarray(SparseMatrixCSC{Bool, Int64}, result) == B
+
+    C = sprandn(ComplexF64, 20, 10, 0.2)
+    (tag, result) = roundtrip(_ConvertToMATLAB.convert_matfrostarray(C))
+    @test tag == SPARSE_COMPLEX_DOUBLE
+    @test _ConvertToJulia.convert_matfrostarray(SparseMatrixCSC{ComplexF64, Int64}, result) == C
+
+    # MATLAB has no sparse integer or single matrices.
+    I32 = sparse(Int32[1, 3], Int32[2, 2], Float32[1.5, -2], 4, 3)
+    marr = _ConvertToMATLAB.convert_matfrostarray(I32)
+    @test marr isa MATFrostArraySparse{Float64}
+    @test marr.colptr == [1, 1, 3, 3]
+    @test marr.rowval == [1, 3]
+    @test marr.nzval == [1.5, -2.0]
+end
+
+@testset "Sparse-Empty" begin
+    for A in (spzeros(0, 5), spzeros(4, 3))
+        (_, result) = roundtrip(_ConvertToMATLAB.convert_matfrostarray(A))
+        @test result isa MATFrostArraySparse{Float64}
+        @test result.dims == [size(A)...]
+        @test _ConvertToJulia.convert_matfrostarray(SparseMatrixCSC{Float64, Int64}, result) == A
+    end
+end
+
+@testset "Sparse-InCell" begin
+    As = [sprandn(10, 10, 0.3) for _ in 1:3]
+    marr = _ConvertToMATLAB.convert_matfrostarray(As)
+    @test marr isa MATFrostArrayCell
+    (_, result) = roundtrip(marr)
+    @test _ConvertToJulia.convert_matfrostarray(Vector{SparseMatrixCSC{Float64, Int64}}, result) == As
+end
+
+@testset "Sparse-Incompatible" begin
+    marr = MATFrostArrayPrimitive{Float64}([2, 2], [1.0, 0.0, 0.0, 1.0])
+    @test_throws MATFrostConversionException _ConvertToJulia.convert_matfrostarray(SparseMatrixCSC{Float64, Int64}, marr)
+    sarr = MATFrostArraySparse{Float64}([2, 2], [1, 2, 3], [1, 2], [1.0, 1.0])
+    @test_throws MATFrostConversionException _ConvertToJulia.convert_matfrostarray(SparseMatrixCSC{Bool, Int64}, sarr)
+    @test_throws MATFrostConversionException _ConvertToJulia.convert_matfrostarray(SparseMatrixCSC{Float64, Int32}, sarr)
+end
+
+end
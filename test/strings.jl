@@ -0,0 +1,65 @@
+module StringsTest
+
+using Test
+
+using MATFrost._Stream: BufferedUDS, Buffer
+using MATFrost._Read: read_message!
+using MATFrost._Write: write_message!
+using MATFrost._Types
+using MATFrost._Constants
+
+function roundtrip(marr)
+    buffer = Buffer(Vector{UInt8}(undef, 2 << 16), 0, 0)
+    stream = BufferedUDS(C_NULL, buffer, buffer)
+
+    write_message!(stream, UInt64(1), marr)
+    tag = reinterpret(Int32, buffer.data[33:36])[1]
+    @test reinterpret(Int64, buffer.data[9:16])[1] == buffer.available - 32
+
+    (_, result) = read_message!(stream)
+    @test buffer.available == buffer.position
+    (tag, result)
+end
+
+@testset "Strings-Packed" begin
+    values = ["item_$(i)" for i in 1:1000]
+    (tag, result) = roundtrip(MATFrostArrayString([1, 1000], values))
+    @test tag == MATLAB_STRING | ENCODING_PACKED
+    @test result isa MATFrostArrayString
+    @test result.dims == [1, 1000]
+    @test result.values == values
+end
+
+@testset "Strings-Scalar-Unpacked" begin
+    (tag, result) = roundtrip(MATFrostArrayString([1, 1], ["scalar"]))
+    @test tag == MATLAB_STRING
+    @test result.values == ["scalar"]
+end
+
+@testset "Strings-Empty" begin
+    (_, result) = roundtrip(MATFrostArrayString([0, 3], String[]))
+    @test result.dims == [0, 3]
+    @test isempty(result.values)
+
+    values = ["", "a", "", "", "bc", ""]
+    (tag, result) = roundtrip(MATFrostArrayString([2, 3], values))
+    @test tag == MATLAB_STRING | ENCODING_PACKED
+    @test result.values == values
+end
+
+@testset "Strings-Unicode" begin
+    values = ["Straße", "東京", "😀 emoji", "ascii_only_and_long_enough_for_a_vector_block", "ÅÄÖ"]
+    (tag, result) = roundtrip(MATFrostArrayString([5, 1], values))
+    @test tag == MATLAB_STRING | ENCODING_PACKED
+    @test result.values == values
+end
+
+@testset "Strings-Nbytes" begin
+    # roundtrip checks the nbytes of the message prefix against the bytes written.
+    for values in (["a"], ["a", "bc"], ["", "東京", "x"^100])
+        (_, result) = roundtrip(MATFrostArrayString([length(values)], values))
+        @test result.values == values
+    end
+end
+
+end